@@ -1,5 +1,9 @@
+#define _GNU_SOURCE // For fopencookie in the export benchmark
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
 
 struct Date
 {
@@ -17,10 +21,41 @@ void printFullYearCalendar(int year);
 const char *getDayName(int dayOfWeek);
 void saveCalendarToFile(int month, int year);
 void saveFullYearCalendarToFile(int year);
+int runExportBenchmark(int iterations);
+void initDayTables();
+int runQueryServer();
+int runSocketServer(const char *path);
+int runQueryBenchmark(long total);
+int runVerification();
+int runKernelBenchmark(long calls, int threads);
+int cpuCount();
 
-int main()
+int main(int argc, char *argv[])
 {
     int choice;
+
+    initDayTables();
+
+    // Date query service: --serve reads queries from stdin, --serve-socket PATH listens locally
+    if (argc > 1 && strcmp(argv[1], "--serve") == 0)
+        return runQueryServer();
+    if (argc > 2 && strcmp(argv[1], "--serve-socket") == 0)
+        return runSocketServer(argv[2]);
+    // --bench-queries [count]: queries per second for each query type
+    if (argc > 1 && strcmp(argv[1], "--bench-queries") == 0)
+        return runQueryBenchmark(argc > 2 ? atol(argv[2]) : 100000000L);
+
+    // --verify: every date of several 400-year cycles against a reference
+    if (argc > 1 && strcmp(argv[1], "--verify") == 0)
+        return runVerification();
+    // --bench-kernels [calls] [threads]: ns per call of each date kernel, as CSV
+    if (argc > 1 && strcmp(argv[1], "--bench-kernels") == 0)
+        return runKernelBenchmark(argc > 2 ? atol(argv[2]) : 20000000L, argc > 3 ? atoi(argv[3]) : cpuCount());
+
+    // --bench-export [iterations]: full-year export, old fprintf exporter vs grid renderer
+    if (argc > 1 && strcmp(argv[1], "--bench-export") == 0)
+        return runExportBenchmark(argc > 2 ? atoi(argv[2]) : 20000);
+
     while (1)
     {
         printf("\n==== Simple Calendar App ====\n");
@@ -58,7 +93,10 @@ int main()
             int month, year;
             printf("Enter month and year (MM YYYY): ");
             scanf("%d %d", &month, &year);
-            printMonthCalendar(month, year);
+            if (month < 1 || month > 12)
+                printf("Invalid month. Please enter 1-12.\n");
+            else
+                printMonthCalendar(month, year);
         }
         else if (choice == 4)
         {
@@ -67,17 +105,15 @@ int main()
             scanf("%d", &year);
             printFullYearCalendar(year);
         }
-        else if (choice == 5)
-        {
-            printf("Exiting... Goodbye!\n");
-            break;
-        }
-        else if (choice == 6)
+        else if (choice == 5 || choice == 6)
         {
             int month, year;
             printf("Enter month and year (MM YYYY): ");
             scanf("%d %d", &month, &year);
-            saveCalendarToFile(month, year);
+            if (month < 1 || month > 12)
+                printf("Invalid month. Please enter 1-12.\n");
+            else
+                saveCalendarToFile(month, year);
         }
         else if (choice == 7)
         {
@@ -86,6 +122,11 @@ int main()
             scanf("%d", &year);
             saveFullYearCalendarToFile(year);
         }
+        else if (choice == 8)
+        {
+            printf("Exiting... Goodbye!\n");
+            break;
+        }
         else
         {
             printf("Invalid choice. Please try again.\n");
@@ -110,18 +151,21 @@ int getDaysInMonth(int month, int year)
     return daysInMonth[month - 1];
 }
 
-// Zeller’s Congruence Algorithm to get weekday
+// Zeller’s Congruence Algorithm to get weekday. Divisions round down and the
+// arithmetic is 64-bit, so years before 1 (year 0 = 1 BC) and at the ends of
+// the int range work too.
 int getDayOfWeek(int d, int m, int y)
 {
+    long long year = y;
     if (m < 3)
     {
         m += 12;
-        y -= 1;
+        year -= 1;
     }
-    int k = y % 100;
-    int j = y / 100;
-    int f = d + 13 * (m + 1) / 5 + k + k / 4 + j / 4 + 5 * j;
-    return f % 7; // 0 = Saturday, 1 = Sunday, ..., 6 = Friday
+    long long j = year >= 0 ? year / 100 : (year - 99) / 100;
+    long long k = year - 100 * j;                       // 0 .. 99
+    long long f = d + 13 * (m + 1) / 5 + k + k / 4 + (j >= 0 ? j / 4 : (j - 3) / 4) + 5 * j;
+    return (int)((f % 7 + 7) % 7); // 0 = Saturday, 1 = Sunday, ..., 6 = Friday
 }
 
 // Convert day number to name
@@ -133,98 +177,204 @@ const char *getDayName(int dayOfWeek)
     return days[dayOfWeek];
 }
 
-// Print calendar for a specific month
-void printMonthCalendar(int month, int year)
+// Sizes of the buffers the renderers write into: a month never needs more than
+// MONTH_BUFFER_SIZE bytes (title, weekday header and six weeks of five-wide cells)
+#define MONTH_BUFFER_SIZE 512
+#define YEAR_BUFFER_SIZE (12 * MONTH_BUFFER_SIZE)
+
+// Cell widths of the two layouts
+#define SCREEN_CELL_WIDTH 5
+#define FILE_CELL_WIDTH 4
+
+const char *monthNames[] = {
+    "January", "February", "March", "April", "May", "June",
+    "July", "August", "September", "October", "November", "December"};
+
+// "00" to "99", so two-digit numbers are copied instead of formatted
+static const char twoDigits[201] =
+    "00010203040506070809101112131415161718192021222324"
+    "25262728293031323334353637383940414243444546474849"
+    "50515253545556575859606162636465666768697071727374"
+    "75767778798081828384858687888990919293949596979899";
+
+// Append a string; returns the new length
+size_t appendText(char *out, size_t len, const char *text)
+{
+    while (*text)
+        out[len++] = *text++;
+    return len;
+}
+
+// Append an integer of any size (years), two digits at a time
+size_t appendNumber(char *out, size_t len, long long n)
 {
-    const char *months[] = {
-        "January", "February", "March", "April", "May", "June",
-        "July", "August", "September", "October", "November", "December"};
+    char digits[24];
+    int count = 0;
+    unsigned long long v = n < 0 ? 0ULL - (unsigned long long)n : (unsigned long long)n;
+    if (n < 0)
+        out[len++] = '-';
+    while (v >= 100)
+    {
+        int pair = (int)(v % 100) * 2;
+        digits[count++] = twoDigits[pair + 1];
+        digits[count++] = twoDigits[pair];
+        v /= 100;
+    }
+    if (v >= 10)
+    {
+        digits[count++] = twoDigits[v * 2 + 1];
+        digits[count++] = twoDigits[v * 2];
+    }
+    else
+        digits[count++] = (char)('0' + v);
+    while (count > 0)
+        out[len++] = digits[--count];
+    return len;
+}
 
-    printf("\n  ===== %s %d =====\n", months[month - 1], year);
-    printf("  Sun  Mon  Tue  Wed  Thu  Fri  Sat\n");
+// Render the weekday header and the day grid of one month, cells right-aligned
+// to cellWidth, each week on its own line. Returns the new length.
+size_t renderMonthGrid(char *out, size_t len, int month, int year, int cellWidth)
+{
+    static const char *weekdays[] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+    for (int i = 0; i < 7; i++)
+    {
+        for (int pad = 3; pad < cellWidth; pad++)
+            out[len++] = ' ';
+        len = appendText(out, len, weekdays[i]);
+    }
+    out[len++] = '\n';
 
-    int startDay = (getDayOfWeek(1, month, year) - 1) % 7;
+    // getDayOfWeek counts from Saturday (0); columns start on Sunday
+    int column = (getDayOfWeek(1, month, year) + 6) % 7;
     int days = getDaysInMonth(month, year);
-
-    int i;
-    for (i = 0; i < startDay; i++)
-        printf("     "); // Print empty slots
+    for (int i = 0; i < column * cellWidth; i++)
+        out[len++] = ' ';
 
     for (int d = 1; d <= days; d++)
     {
-        printf("%5d", d);
-        if (++i % 7 == 0)
-            printf("\n");
+        for (int pad = 2; pad < cellWidth; pad++)
+            out[len++] = ' ';
+        out[len++] = d < 10 ? ' ' : twoDigits[d * 2];
+        out[len++] = twoDigits[d * 2 + 1];
+        if (++column == 7 || d == days)
+        {
+            out[len++] = '\n';
+            column = 0;
+        }
     }
-    printf("\n");
+    return len;
 }
 
-// Print calendar for full year
-void printFullYearCalendar(int year)
+// Render "===== Month Year =====" followed by the month grid
+size_t renderMonth(char *out, size_t len, int month, int year, int cellWidth, const char *indent)
+{
+    len = appendText(out, len, indent);
+    len = appendText(out, len, "===== ");
+    len = appendText(out, len, monthNames[month - 1]);
+    out[len++] = ' ';
+    len = appendNumber(out, len, year);
+    len = appendText(out, len, " =====\n");
+    return renderMonthGrid(out, len, month, year, cellWidth);
+}
+
+// Render all twelve months, separated by blank lines
+size_t renderYear(char *out, size_t len, int year, int cellWidth, const char *indent)
 {
     for (int month = 1; month <= 12; month++)
     {
-        printMonthCalendar(month, year);
+        out[len++] = '\n';
+        len = renderMonth(out, len, month, year, cellWidth, indent);
     }
+    return len;
+}
+
+// Send a rendered buffer to a stream in a single write
+int writeBuffer(FILE *fp, const char *buf, size_t len)
+{
+    fflush(fp);                       // Anything already queued goes first
+    setvbuf(fp, NULL, _IONBF, 0);     // Unbuffered: fwrite becomes one write call
+    return fwrite(buf, 1, len, fp) == len;
+}
+
+// Save a rendered buffer as a new file; returns 1 on success
+int saveBuffer(const char *filename, const char *buf, size_t len)
+{
+    FILE *fp = fopen(filename, "w");
+    if (!fp)
+        return 0;
+    int ok = writeBuffer(fp, buf, len);
+    return fclose(fp) == 0 && ok;
+}
+
+// Print calendar for a specific month
+void printMonthCalendar(int month, int year)
+{
+    char buf[MONTH_BUFFER_SIZE];
+    size_t len = 0;
+    buf[len++] = '\n';
+    len = renderMonth(buf, len, month, year, SCREEN_CELL_WIDTH, "  ");
+    fflush(stdout);
+    fwrite(buf, 1, len, stdout);
+    fflush(stdout);
+}
+
+// Print calendar for full year
+void printFullYearCalendar(int year)
+{
+    static char buf[YEAR_BUFFER_SIZE];
+    size_t len = renderYear(buf, 0, year, SCREEN_CELL_WIDTH, "  ");
+    fflush(stdout);
+    fwrite(buf, 1, len, stdout);
+    fflush(stdout);
 }
 
 // Save calendar for a specific month to a file
 // This function creates a text file with the calendar for the specified month and year.
 void saveCalendarToFile(int month, int year)
 {
-    FILE *fp;
     char filename[50];
     sprintf(filename, "calendar_%02d_%d.txt", month, year);
-    fp = fopen(filename, "w");
 
-    if (!fp)
+    char buf[MONTH_BUFFER_SIZE];
+    size_t len = appendText(buf, 0, "Calendar for ");
+    buf[len++] = twoDigits[month * 2];
+    buf[len++] = twoDigits[month * 2 + 1];
+    buf[len++] = '/';
+    len = appendNumber(buf, len, year);
+    buf[len++] = '\n';
+    len = renderMonthGrid(buf, len, month, year, FILE_CELL_WIDTH);
+
+    if (!saveBuffer(filename, buf, len))
     {
         printf("Failed to save calendar!\n");
         return;
     }
-
-    fprintf(fp, "Calendar for %02d/%d\n", month, year);
-    fprintf(fp, "Sun Mon Tue Wed Thu Fri Sat\n");
-
-    int startDay = (getDayOfWeek(1, month, year) + 6) % 7;
-    int days = getDaysInMonth(month, year);
-
-    int i;
-    for (i = 0; i < startDay; i++)
-        fprintf(fp, "    ");
-
-    for (int d = 1; d <= days; d++)
-    {
-        fprintf(fp, "%4d", d);
-        i++;
-        if (i % 7 == 0)
-            fprintf(fp, "\n");
-    }
-
-    fclose(fp);
     printf("Calendar saved to %s ✅\n", filename);
 }
 
 void saveFullYearCalendarToFile(int year)
 {
-    FILE *fp;
     char filename[50];
     sprintf(filename, "calendar_year_%d.txt", year);
-    fp = fopen(filename, "w");
 
-    if (!fp)
+    static char buf[YEAR_BUFFER_SIZE];
+    size_t len = renderYear(buf, 0, year, FILE_CELL_WIDTH, "");
+    if (!saveBuffer(filename, buf, len))
     {
         printf("Failed to save calendar!\n");
         return;
     }
+    printf("Full year calendar saved to %s ✅\n", filename);
+}
 
-    const char *months[] = {
-        "January", "February", "March", "April", "May", "June",
-        "July", "August", "September", "October", "November", "December"};
-
+// The year exporter as it was before the grid renderer (one fprintf per cell),
+// kept for the benchmark
+void legacyYearExport(FILE *fp, int year)
+{
     for (int month = 1; month <= 12; month++)
     {
-        fprintf(fp, "\n===== %s %d =====\n", months[month - 1], year);
+        fprintf(fp, "\n===== %s %d =====\n", monthNames[month - 1], year);
         fprintf(fp, " Sun Mon Tue Wed Thu Fri Sat\n");
 
         int startDay = (getDayOfWeek(1, month, year) - 1) % 7;
@@ -243,7 +393,1036 @@ void saveFullYearCalendarToFile(int year)
         }
         fprintf(fp, "\n");
     }
+}
+
+// Seconds elapsed since start
+double secondsSince(clock_t start)
+{
+    return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
 
+#ifdef __GLIBC__
+// Stream that counts the write calls stdio would make
+ssize_t countWrites(void *cookie, const char *buf, size_t size)
+{
+    (void)buf;
+    (*(long *)cookie)++;
+    return size;
+}
+
+// Write calls made by the old exporter with the given stdio buffering
+long legacyWriteCount(int year, int mode)
+{
+    long writes = 0;
+    cookie_io_functions_t io = {NULL, countWrites, NULL, NULL};
+    FILE *fp = fopencookie(&writes, "w", io);
+    setvbuf(fp, NULL, mode, BUFSIZ);
+    legacyYearExport(fp, year);
     fclose(fp);
-    printf("Full year calendar saved to %s ✅\n", filename);
+    return writes;
+}
+#endif
+
+// Full-year export: time per export to a file, and write calls per export
+int runExportBenchmark(int iterations)
+{
+    const char *path = "calendar_bench.tmp";
+    static char buf[YEAR_BUFFER_SIZE];
+    size_t len = 0;
+
+    clock_t start = clock();
+    for (int i = 0; i < iterations; i++)
+    {
+        FILE *fp = fopen(path, "w");
+        if (!fp)
+        {
+            printf("Cannot write %s\n", path);
+            return 1;
+        }
+        legacyYearExport(fp, 1900 + i % 400);
+        fclose(fp);
+    }
+    double legacyFile = secondsSince(start);
+
+    start = clock();
+    for (int i = 0; i < iterations; i++)
+    {
+        len = renderYear(buf, 0, 1900 + i % 400, FILE_CELL_WIDTH, "");
+        saveBuffer(path, buf, len);
+    }
+    double gridFile = secondsSince(start);
+    remove(path);
+
+    // Formatting alone, without the file system
+    FILE *sink = fopen("/dev/null", "w");
+    start = clock();
+    for (int i = 0; i < iterations && sink; i++)
+        legacyYearExport(sink, 1900 + i % 400);
+    double legacyFormat = secondsSince(start);
+    if (sink)
+        fclose(sink);
+
+    start = clock();
+    unsigned long checksum = 0;
+    for (int i = 0; i < iterations; i++)
+        checksum += renderYear(buf, 0, 1900 + i % 400, FILE_CELL_WIDTH, "");
+    double gridFormat = secondsSince(start);
+
+    printf("Full-year export, %d iterations (%zu bytes each)\n", iterations, len);
+    printf("%-22s %12s %12s\n", "", "fprintf", "grid buffer");
+    printf("%-22s %9.2f us %9.2f us\n", "export to file", legacyFile * 1e6 / iterations, gridFile * 1e6 / iterations);
+    printf("%-22s %9.2f us %9.2f us\n", "formatting only", legacyFormat * 1e6 / iterations, gridFormat * 1e6 / iterations);
+#ifdef __GLIBC__
+    printf("%-22s %12ld %12d\n", "writes (file)", legacyWriteCount(2025, _IOFBF), 1);
+    printf("%-22s %12ld %12d\n", "writes (terminal)", legacyWriteCount(2025, _IOLBF), 1);
+#endif
+    printf("(checksum %lu)\n", checksum);
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Serial day numbers and the query service
+// ---------------------------------------------------------------------------
+
+// A serial day number counts days from 1970-01-01 (day 0); earlier dates are
+// negative. Converting either way is a handful of arithmetic operations and
+// one table lookup, so date questions reduce to integer arithmetic.
+#define DAYS_PER_400_YEARS 146097
+#define DAYS_BEFORE_1970 719162   // From 0001-01-01 to 1970-01-01
+
+// Days before each month (index 0..12) in common and leap years,
+// filled from getDaysInMonth by initDayTables
+int monthStart[2][13];
+
+void initDayTables()
+{
+    for (int leap = 0; leap < 2; leap++)
+    {
+        int year = leap ? 2000 : 2001;
+        monthStart[leap][0] = 0;
+        for (int m = 1; m <= 12; m++)
+            monthStart[leap][m] = monthStart[leap][m - 1] + getDaysInMonth(m, year);
+    }
+}
+
+// Years are shifted by a multiple of 400 before dividing so the divisions are
+// unsigned (cheap multiplies) yet still correct for every int year
+#define YEAR_SHIFT 4000000000LL
+#define DAYS_SHIFT (YEAR_SHIFT / 400 * DAYS_PER_400_YEARS)
+
+// Days from 0001-01-01 to January 1st of year y + 1 (y years into a cycle)
+static inline long long daysBeforeYear(long long y)
+{
+    unsigned long long u = (unsigned long long)(y + YEAR_SHIFT);
+    return (long long)(365 * u + u / 4 - u / 100 + u / 400) - DAYS_SHIFT;
+}
+
+// Serial day number of a date
+static inline long long dateToSerial(int year, int month, int day)
+{
+    return daysBeforeYear(year - 1LL) + monthStart[isLeapYear(year)][month - 1] + day - 1 - DAYS_BEFORE_1970;
+}
+
+// Date of a serial day number
+static inline struct Date serialToDate(long long serial)
+{
+    long long n = serial + DAYS_BEFORE_1970;       // Days since 0001-01-01
+    unsigned long long shifted = (unsigned long long)(n + DAYS_SHIFT);
+    long long cycle = (long long)(shifted / DAYS_PER_400_YEARS) - YEAR_SHIFT / 400;
+    long long rest = (long long)(shifted % DAYS_PER_400_YEARS); // 0 .. 146096
+
+    // Estimate the year within the 400-year cycle, then correct by at most one
+    long long y = rest * 400 / DAYS_PER_400_YEARS;
+    if (daysBeforeYear(y) > rest)
+        y--;
+    else if (daysBeforeYear(y + 1) <= rest)
+        y++;
+
+    struct Date date;
+    date.year = (int)(cycle * 400 + y + 1);
+    int dayOfYear = (int)(rest - daysBeforeYear(y));
+    const int *starts = monthStart[isLeapYear(date.year)];
+    int m = dayOfYear >> 5;                        // Months are 28-31 days: m is at most one short
+    if (dayOfYear >= starts[m + 1])
+        m++;
+    date.month = m + 1;
+    date.day = dayOfYear - starts[m] + 1;
+    return date;
+}
+
+// Day of week of a serial day number, 0 = Saturday like getDayOfWeek
+static inline int serialDayOfWeek(long long serial)
+{
+    return (int)((serial % 7 + 12) % 7);           // 1970-01-01 was a Thursday (5)
+}
+
+// Date of the nth (1-5, or -1 for the last) weekday (0 = Sunday .. 6 = Saturday)
+// of a month; day is 0 when the month has no such day
+static inline struct Date nthWeekday(int year, int month, int n, int weekday)
+{
+    struct Date date = {0, month, year};
+    int days = getDaysInMonth(month, year);
+    long long first = dateToSerial(year, month, 1);
+    int firstSunday0 = (serialDayOfWeek(first) + 6) % 7;
+    int day;
+    if (n < 0)
+    {
+        int lastSunday0 = (firstSunday0 + days - 1) % 7;
+        day = days - (lastSunday0 - weekday + 7) % 7;
+    }
+    else
+        day = 1 + (weekday - firstSunday0 + 7) % 7 + 7 * (n - 1);
+    date.day = day >= 1 && day <= days ? day : 0;
+    return date;
+}
+
+// ISO 8601 week of a date: week-numbering year, week (1-53) and weekday (1 = Monday)
+static inline struct Date isoWeek(int year, int month, int day)
+{
+    long long serial = dateToSerial(year, month, day);
+    int isoWeekday = (int)((serial % 7 + 10) % 7) + 1;    // 1970-01-01 was a Thursday (4)
+    long long thursday = serial - isoWeekday + 4;               // The week belongs to its Thursday's year
+    struct Date result;
+    result.year = serialToDate(thursday).year;
+    result.month = (int)((thursday - dateToSerial(result.year, 1, 1)) / 7 + 1);
+    result.day = isoWeekday;
+    return result;
+}
+
+// Queries answered by the service, in binary form
+enum
+{
+    QUERY_WEEKDAY,      // date -> value: day of week (0 = Saturday)
+    QUERY_BETWEEN,      // date, other -> value: days from date to other
+    QUERY_NTH_WEEKDAY,  // date.year, date.month, n, weekday -> result: the date
+    QUERY_ISO_WEEK,     // date -> result: ISO year, week and weekday
+    QUERY_TO_SERIAL,    // date -> value: serial day number
+    QUERY_FROM_SERIAL,  // value -> result: the date
+    QUERY_COUNT
+};
+
+struct Query
+{
+    int op;
+    struct Date date;
+    struct Date other;
+    int n, weekday;
+    long long value;
+};
+
+struct Answer
+{
+    long long value;
+    struct Date result;
+};
+
+// Answer a batch of queries
+void answerQueries(const struct Query *queries, struct Answer *answers, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        const struct Query *q = &queries[i];
+        struct Answer *a = &answers[i];
+        switch (q->op)
+        {
+        case QUERY_WEEKDAY:
+            a->value = serialDayOfWeek(dateToSerial(q->date.year, q->date.month, q->date.day));
+            break;
+        case QUERY_BETWEEN:
+            a->value = dateToSerial(q->other.year, q->other.month, q->other.day)
+                     - dateToSerial(q->date.year, q->date.month, q->date.day);
+            break;
+        case QUERY_NTH_WEEKDAY:
+            a->result = nthWeekday(q->date.year, q->date.month, q->n, q->weekday);
+            break;
+        case QUERY_ISO_WEEK:
+            a->result = isoWeek(q->date.year, q->date.month, q->date.day);
+            break;
+        case QUERY_TO_SERIAL:
+            a->value = dateToSerial(q->date.year, q->date.month, q->date.day);
+            break;
+        case QUERY_FROM_SERIAL:
+            a->result = serialToDate(q->value);
+            break;
+        }
+    }
+}
+
+// Valid calendar date?
+int isValidDate(int year, int month, int day)
+{
+    return month >= 1 && month <= 12 && day >= 1 && day <= getDaysInMonth(month, year);
+}
+
+// Years the text protocol accepts: one short of the int range at both ends, so
+// an ISO week year (which can be the next or previous year) still fits in an int
+#define QUERY_YEAR_MIN (-2147483647LL)
+#define QUERY_YEAR_MAX 2147483646LL
+
+// Parse an optionally negative integer, skipping leading blanks. Values too
+// long to hold stop growing at 10^18, far outside every accepted range.
+const char *parseNumber(const char *p, const char *end, long long *value)
+{
+    while (p < end && (*p == ' ' || *p == '\t'))
+        p++;
+    int negative = p < end && *p == '-';
+    p += negative;
+    if (p >= end || *p < '0' || *p > '9')
+        return NULL;
+    long long v = 0;
+    while (p < end && *p >= '0' && *p <= '9')
+    {
+        if (v < 100000000000000000LL)
+            v = v * 10 + (*p - '0');
+        p++;
+    }
+    *value = negative ? -v : v;
+    return p;
+}
+
+// Append YYYY-MM-DD
+size_t appendDate(char *out, size_t len, struct Date date)
+{
+    len = appendNumber(out, len, date.year);
+    out[len++] = '-';
+    out[len++] = twoDigits[date.month * 2];
+    out[len++] = twoDigits[date.month * 2 + 1];
+    out[len++] = '-';
+    out[len++] = twoDigits[date.day * 2];
+    out[len++] = twoDigits[date.day * 2 + 1];
+    return len;
+}
+
+// Answer one text request line, appending the reply line to out:
+//   weekday Y M D          -> Sunday
+//   between Y M D Y M D    -> 358
+//   nth Y M N WEEKDAY      -> 2025-11-27   (N = 1..5 or -1 for last, WEEKDAY 0 = Sunday)
+//   isoweek Y M D          -> 2026-W01-1
+//   serial Y M D           -> 20254
+//   date SERIAL            -> 2025-06-15
+size_t answerLine(const char *line, const char *end, char *out, size_t len)
+{
+    static const struct { const char *name; int op, args; } commands[] = {
+        {"weekday", QUERY_WEEKDAY, 3}, {"between", QUERY_BETWEEN, 6}, {"nth", QUERY_NTH_WEEKDAY, 4},
+        {"isoweek", QUERY_ISO_WEEK, 3}, {"serial", QUERY_TO_SERIAL, 3}, {"date", QUERY_FROM_SERIAL, 1}};
+
+    const char *p = line;
+    while (p < end && *p != ' ')
+        p++;
+    int c = 0, count = (int)(sizeof(commands) / sizeof(commands[0]));
+    while (c < count && (strlen(commands[c].name) != (size_t)(p - line)
+                         || memcmp(commands[c].name, line, p - line) != 0))
+        c++;
+    if (c == count)
+        return appendText(out, len, "error unknown query\n");
+
+    long long v[6];
+    for (int i = 0; i < commands[c].args; i++)
+    {
+        p = parseNumber(p, end, &v[i]);
+        if (!p)
+            return appendText(out, len, "error expected a number\n");
+    }
+
+    // Every result has to fit in an int: check before anything is narrowed
+    if (commands[c].op == QUERY_FROM_SERIAL)
+    {
+        if (v[0] < dateToSerial((int)QUERY_YEAR_MIN, 1, 1) || v[0] > dateToSerial((int)QUERY_YEAR_MAX, 12, 31))
+            return appendText(out, len, "error out of range\n");
+    }
+    else
+    {
+        for (int i = 0; i < commands[c].args; i++)
+        {
+            if (v[i] < QUERY_YEAR_MIN || v[i] > QUERY_YEAR_MAX)
+                return appendText(out, len, "error out of range\n");
+        }
+    }
+
+    struct Query q;
+    struct Answer a;
+    q.op = commands[c].op;
+    q.date.year = (int)v[0];
+    q.date.month = (int)v[1];
+    q.date.day = (int)v[2];
+    if (q.op == QUERY_FROM_SERIAL)
+        q.value = v[0];
+    else if (q.op == QUERY_NTH_WEEKDAY)
+    {
+        q.n = (int)v[2];
+        q.weekday = (int)v[3];
+        if (q.date.month < 1 || q.date.month > 12 || q.n == 0 || q.n < -1 || q.n > 5 || q.weekday < 0 || q.weekday > 6)
+            return appendText(out, len, "error invalid arguments\n");
+    }
+    else if (!isValidDate(q.date.year, q.date.month, q.date.day))
+        return appendText(out, len, "error invalid date\n");
+    if (q.op == QUERY_BETWEEN)
+    {
+        q.other.year = (int)v[3];
+        q.other.month = (int)v[4];
+        q.other.day = (int)v[5];
+        if (!isValidDate(q.other.year, q.other.month, q.other.day))
+            return appendText(out, len, "error invalid date\n");
+    }
+    answerQueries(&q, &a, 1);
+
+    switch (q.op)
+    {
+    case QUERY_WEEKDAY:
+        len = appendText(out, len, getDayName((int)a.value));
+        break;
+    case QUERY_BETWEEN:
+    case QUERY_TO_SERIAL:
+        len = appendNumber(out, len, a.value);
+        break;
+    case QUERY_NTH_WEEKDAY:
+        if (a.result.day == 0)
+            return appendText(out, len, "none\n");
+        len = appendDate(out, len, a.result);
+        break;
+    case QUERY_ISO_WEEK:
+        len = appendNumber(out, len, a.result.year);
+        len = appendText(out, len, "-W");
+        out[len++] = twoDigits[a.result.month * 2];
+        out[len++] = twoDigits[a.result.month * 2 + 1];
+        out[len++] = '-';
+        out[len++] = (char)('0' + a.result.day);
+        break;
+    case QUERY_FROM_SERIAL:
+        len = appendDate(out, len, a.result);
+        break;
+    }
+    out[len++] = '\n';
+    return len;
+}
+
+// Longest request line, and longest reply
+#define QUERY_LINE_MAX 256
+#define QUERY_REPLY_MAX 32
+// Bytes read (and replies written) per batch
+#define QUERY_BATCH_SIZE 65536
+
+// Answer every complete line in in[0..len), appending replies to out. Returns
+// the number of input bytes consumed (a trailing partial line is left over).
+size_t answerBatch(const char *in, size_t len, char *out, size_t *outLen)
+{
+    size_t pos = 0;
+    while (pos < len)
+    {
+        const char *line = in + pos;
+        const char *nl = memchr(line, '\n', len - pos);
+        if (!nl)
+            break;
+        const char *end = nl > line && nl[-1] == '\r' ? nl - 1 : nl;
+        if (end - line > QUERY_LINE_MAX)
+            *outLen = appendText(out, *outLen, "error line too long\n");
+        else if (end > line)
+            *outLen = answerLine(line, end, out, *outLen);
+        pos = nl + 1 - in;
+    }
+    return pos;
+}
+
+#ifdef _WIN32
+#include <io.h>     // For read, write on Windows
+#else
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <signal.h>
+#endif
+
+// Write all of buf to a file descriptor
+int writeAll(int fd, const char *buf, size_t len)
+{
+    while (len > 0)
+    {
+        long n = write(fd, buf, (unsigned)len);
+        if (n <= 0)
+            return 0;
+        buf += n;
+        len -= n;
+    }
+    return 1;
+}
+
+// Per-connection buffers: pending request bytes and the replies for one batch
+struct QueryConnection
+{
+    int fd;
+    size_t pending;
+    size_t outStart, outEnd;  // Replies in out[] not written yet
+    char in[QUERY_BATCH_SIZE];
+    char out[QUERY_BATCH_SIZE / 2 * QUERY_REPLY_MAX]; // Every line is at least 2 bytes
+};
+
+// Read what is available on a connection and answer it into out[outStart..outEnd).
+// Returns 0 at end of input.
+int readQueries(struct QueryConnection *c)
+{
+    long n = read(c->fd, c->in + c->pending, (unsigned)(sizeof(c->in) - c->pending));
+    if (n < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK))
+        return 1;
+    if (n <= 0)
+        return 0;
+    c->pending += n;
+    size_t outLen = 0;
+    size_t used = answerBatch(c->in, c->pending, c->out, &outLen);
+    if (used == 0 && c->pending == sizeof(c->in))
+    {
+        outLen = appendText(c->out, 0, "error line too long\n");
+        used = c->pending;
+    }
+    memmove(c->in, c->in + used, c->pending - used);
+    c->pending -= used;
+    c->outStart = 0;
+    c->outEnd = outLen;
+    return 1;
+}
+
+// --serve: answer queries from stdin until it closes
+int runQueryServer()
+{
+    static struct QueryConnection stdinConnection;
+    stdinConnection.fd = 0;
+    while (readQueries(&stdinConnection) && writeAll(1, stdinConnection.out, stdinConnection.outEnd))
+        ;
+    return 0;
+}
+
+#ifndef _WIN32
+// Write as much of a client's replies as its socket takes without waiting.
+// Returns 0 if the client is gone.
+int flushReplies(struct QueryConnection *c)
+{
+    while (c->outStart < c->outEnd)
+    {
+        long n = write(c->fd, c->out + c->outStart, c->outEnd - c->outStart);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return 1;
+        if (n <= 0)
+            return 0;
+        c->outStart += n;
+    }
+    return 1;
+}
+#endif
+
+// --serve-socket PATH: answer queries from any number of local clients
+int runSocketServer(const char *path)
+{
+#ifdef _WIN32
+    (void)path;
+    printf("The socket server needs a POSIX system; use --serve with a pipe.\n");
+    return 1;
+#else
+    #define MAX_QUERY_CLIENTS 64
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path);
+    unlink(path);
+    if (listener < 0 || bind(listener, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(listener, 16) != 0)
+    {
+        perror(path);
+        return 1;
+    }
+    printf("Answering date queries on %s\n", path);
+    fflush(stdout);
+    signal(SIGPIPE, SIG_IGN); // A client that leaves without reading is dropped on EPIPE
+
+    // Clients are non-blocking: a client that does not read its replies keeps them
+    // in its own buffer (and is not read from meanwhile) instead of stalling the rest
+    struct pollfd fds[MAX_QUERY_CLIENTS + 1];
+    struct QueryConnection *clients[MAX_QUERY_CLIENTS];
+    int clientCount = 0;
+    while (1)
+    {
+        fds[0].fd = listener;
+        fds[0].events = POLLIN;
+        for (int i = 0; i < clientCount; i++)
+        {
+            fds[i + 1].fd = clients[i]->fd;
+            fds[i + 1].events = clients[i]->outStart < clients[i]->outEnd ? POLLOUT : POLLIN;
+        }
+        if (poll(fds, clientCount + 1, -1) < 0)
+            continue;
+
+        for (int i = clientCount - 1; i >= 0; i--)
+        {
+            if (!(fds[i + 1].revents & (POLLIN | POLLOUT | POLLHUP | POLLERR)))
+                continue;
+            struct QueryConnection *c = clients[i];
+            int alive = c->outStart < c->outEnd ? flushReplies(c) : readQueries(c) && flushReplies(c);
+            if (!alive)
+            {
+                close(c->fd);
+                free(c);
+                clients[i] = clients[--clientCount];
+            }
+        }
+        if (fds[0].revents & POLLIN)
+        {
+            int fd = accept(listener, NULL, NULL);
+            struct QueryConnection *c = fd >= 0 && clientCount < MAX_QUERY_CLIENTS ? malloc(sizeof(struct QueryConnection)) : NULL;
+            if (c && fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) == 0)
+            {
+                c->fd = fd;
+                c->pending = c->outStart = c->outEnd = 0;
+                clients[clientCount++] = c;
+            }
+            else if (fd >= 0)
+            {
+                free(c);
+                close(fd);
+            }
+        }
+    }
+#endif
+}
+
+// Wall-clock seconds for the query benchmark
+double wallSeconds()
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Random valid date between 1600 and 2399
+struct Date randomDate()
+{
+    struct Date date;
+    date.year = 1600 + rand() % 800;
+    date.month = 1 + rand() % 12;
+    date.day = 1 + rand() % getDaysInMonth(date.month, date.year);
+    return date;
+}
+
+// Queries per second for each query type and a mix, in binary batches and as text
+int runQueryBenchmark(long total)
+{
+    #define BENCH_BATCH 4096
+    #define BENCH_SET (1 << 16)
+    static struct Query queries[QUERY_COUNT + 1][BENCH_SET];
+    static struct Answer answers[BENCH_BATCH];
+    static const char *names[QUERY_COUNT + 1] = {"weekday", "between", "nth weekday", "iso week", "to serial", "from serial", "mixed"};
+
+    srand(40);
+    for (int t = 0; t <= QUERY_COUNT; t++)
+    {
+        for (int i = 0; i < BENCH_SET; i++)
+        {
+            struct Query *q = &queries[t][i];
+            q->op = t < QUERY_COUNT ? t : rand() % QUERY_COUNT;
+            q->date = randomDate();
+            q->other = randomDate();
+            q->n = rand() % 6 == 0 ? -1 : 1 + rand() % 4;
+            q->weekday = rand() % 7;
+            q->value = rand() % 292000 - 146000;
+        }
+    }
+
+    printf("%-12s %10s %8s\n", "query", "Mq/s", "ns/query");
+    long checksum = 0;
+    for (int t = 0; t <= QUERY_COUNT; t++)
+    {
+        double start = wallSeconds();
+        for (long done = 0; done < total; done += BENCH_BATCH)
+        {
+            answerQueries(&queries[t][done % BENCH_SET], answers, BENCH_BATCH);
+            checksum += answers[BENCH_BATCH - 1].value + answers[BENCH_BATCH - 1].result.day;
+        }
+        double seconds = wallSeconds() - start;
+        printf("%-12s %10.1f %8.2f\n", names[t], total / seconds / 1e6, seconds * 1e9 / total);
+    }
+
+    // The text protocol, parsing and formatting included (no I/O)
+    static char in[QUERY_BATCH_SIZE * 4], out[QUERY_BATCH_SIZE * 8];
+    size_t inLen = 0;
+    long lines = 0;
+    const char *words[QUERY_COUNT] = {"weekday", "between", "nth", "isoweek", "serial", "date"};
+    for (int i = 0; inLen + 64 < sizeof(in); i++, lines++)
+    {
+        const struct Query *q = &queries[QUERY_COUNT][i % BENCH_SET];
+        if (q->op == QUERY_FROM_SERIAL)
+            inLen += sprintf(in + inLen, "date %lld\n", q->value);
+        else if (q->op == QUERY_NTH_WEEKDAY)
+            inLen += sprintf(in + inLen, "nth %d %d %d %d\n", q->date.year, q->date.month, q->n, q->weekday);
+        else if (q->op == QUERY_BETWEEN)
+            inLen += sprintf(in + inLen, "between %d %d %d %d %d %d\n", q->date.year, q->date.month, q->date.day,
+                             q->other.year, q->other.month, q->other.day);
+        else
+            inLen += sprintf(in + inLen, "%s %d %d %d\n", words[q->op], q->date.year, q->date.month, q->date.day);
+    }
+    long textTotal = total / 20;
+    double start = wallSeconds();
+    for (long done = 0; done < textTotal; done += lines)
+    {
+        size_t outLen = 0;
+        answerBatch(in, inLen, out, &outLen);
+        checksum += (long)outLen;
+    }
+    double seconds = wallSeconds() - start;
+    printf("%-12s %10.1f %8.2f\n", "text mixed", textTotal / seconds / 1e6, seconds * 1e9 / textTotal);
+    printf("(checksum %ld)\n", checksum);
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Verification and kernel benchmarks
+// ---------------------------------------------------------------------------
+
+// Days from 1970-01-01 to a date, after Howard Hinnant's days_from_civil. It is
+// independent of the kernels above (years start in March, eras are floored
+// signed divisions) and serves only as the reference they are checked against.
+long long referenceDays(long long y, int m, int d)
+{
+    y -= m <= 2;
+    long long era = (y >= 0 ? y : y - 399) / 400;
+    long long yearOfEra = y - era * 400;                            // 0 .. 399
+    long long dayOfYear = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    long long dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * DAYS_PER_400_YEARS + dayOfEra - 719468;
+}
+
+// Day of week of a reference day count, 0 = Saturday like getDayOfWeek
+int referenceWeekday(long long days)
+{
+    long long w = (days + 5) % 7;                                   // 1970-01-01 was a Thursday (5)
+    return (int)(w < 0 ? w + 7 : w);
+}
+
+// Column (0 = Sunday) in which the grid renderer puts day 1 of a month, read
+// back from the rendered text; -1 if day 1 does not end a cell of the first week
+int renderedStartColumn(int month, int year, int cellWidth)
+{
+    char buf[MONTH_BUFFER_SIZE + 1];
+    size_t len = renderMonthGrid(buf, 0, month, year, cellWidth);
+    buf[len] = '\0';
+    const char *week = strchr(buf, '\n') + 1;   // Skip the weekday header
+    size_t offset = strspn(week, " ");
+    if (week[offset] != '1' || (week[offset + 1] != ' ' && week[offset + 1] != '\n') || (offset + 1) % cellWidth)
+        return -1;
+    return (int)((offset + 1) / cellWidth) - 1;
+}
+
+// Failures found by one check over one range of years
+struct CheckResult
+{
+    long long cases;
+    long long failures;
+};
+
+enum
+{
+    CHECK_LEAP_YEAR,
+    CHECK_DAYS_IN_MONTH,
+    CHECK_DAY_OF_WEEK,
+    CHECK_GRID_COLUMN,
+    CHECK_TO_SERIAL,
+    CHECK_FROM_SERIAL,
+    CHECK_COUNT
+};
+
+static const char *checkNames[CHECK_COUNT] = {
+    "leap_year", "days_in_month", "day_of_week", "grid_start_column", "to_serial", "from_serial"};
+
+static inline void record(struct CheckResult *r, int ok)
+{
+    r->cases++;
+    r->failures += !ok;
+}
+
+// Check every date of `count` years starting at `first` against the reference
+void verifyYears(long long first, long long count, struct CheckResult results[CHECK_COUNT])
+{
+    for (long long y = first; y < first + count; y++)
+    {
+        int year = (int)y;
+        record(&results[CHECK_LEAP_YEAR], isLeapYear(year) == (referenceDays(y, 3, 1) - referenceDays(y, 2, 28) == 2));
+        for (int m = 1; m <= 12; m++)
+        {
+            long long start = referenceDays(y, m, 1);
+            int days = (int)((m == 12 ? referenceDays(y + 1, 1, 1) : referenceDays(y, m + 1, 1)) - start);
+            record(&results[CHECK_DAYS_IN_MONTH], getDaysInMonth(m, year) == days);
+            // Day 1 has to appear under its weekday in both layouts, Sunday first
+            int column = (referenceWeekday(start) + 6) % 7;
+            record(&results[CHECK_GRID_COLUMN], renderedStartColumn(m, year, SCREEN_CELL_WIDTH) == column);
+            record(&results[CHECK_GRID_COLUMN], renderedStartColumn(m, year, FILE_CELL_WIDTH) == column);
+
+            for (int d = 1; d <= days; d++)
+            {
+                long long serial = start + d - 1;
+                record(&results[CHECK_DAY_OF_WEEK], getDayOfWeek(d, m, year) == referenceWeekday(serial));
+                record(&results[CHECK_TO_SERIAL], dateToSerial(year, m, d) == serial);
+                struct Date date = serialToDate(serial);
+                record(&results[CHECK_FROM_SERIAL], date.year == year && date.month == m && date.day == d);
+            }
+        }
+    }
+}
+
+// Check the date kernels over full 400-year cycles: a modern one, one spanning
+// year 0, and negative, large and extreme years. Prints one CSV line per check
+// and range; returns 0 when everything matches.
+int runVerification()
+{
+    static const struct
+    {
+        const char *name;
+        long long first, count;
+    } ranges[] = {
+        {"cycle", 2000, 400},
+        {"around_year_0", -400, 800},
+        {"negative", -1000400, 400},
+        {"large", 1000000, 400},
+        {"int_min", -2147483647LL - 1, 400},
+        {"int_max", 2147483647LL - 399, 400},
+    };
+
+    long long totalFailures = 0;
+    printf("range,first_year,last_year,check,cases,failures\n");
+    for (size_t r = 0; r < sizeof(ranges) / sizeof(ranges[0]); r++)
+    {
+        struct CheckResult results[CHECK_COUNT] = {{0, 0}};
+        verifyYears(ranges[r].first, ranges[r].count, results);
+        for (int c = 0; c < CHECK_COUNT; c++)
+        {
+            printf("%s,%lld,%lld,%s,%lld,%lld\n", ranges[r].name, ranges[r].first,
+                   ranges[r].first + ranges[r].count - 1, checkNames[c], results[c].cases, results[c].failures);
+            totalFailures += results[c].failures;
+        }
+    }
+    fprintf(stderr, "%s: %lld failures\n", totalFailures ? "FAIL" : "PASS", totalFailures);
+    return totalFailures ? 1 : 0;
+}
+
+// Input of one kernel call: a date and its serial day number
+struct KernelInput
+{
+    struct Date date;
+    long long serial;
+};
+
+long long dayOfWeekKernel(const struct KernelInput *in)
+{
+    return getDayOfWeek(in->date.day, in->date.month, in->date.year);
+}
+
+long long leapYearKernel(const struct KernelInput *in)
+{
+    return isLeapYear(in->date.year);
+}
+
+long long daysInMonthKernel(const struct KernelInput *in)
+{
+    return getDaysInMonth(in->date.month, in->date.year);
+}
+
+long long toSerialKernel(const struct KernelInput *in)
+{
+    return dateToSerial(in->date.year, in->date.month, in->date.day);
+}
+
+long long fromSerialKernel(const struct KernelInput *in)
+{
+    return serialToDate(in->serial).day;
+}
+
+long long referenceKernel(const struct KernelInput *in)
+{
+    return referenceDays(in->date.year, in->date.month, in->date.day);
+}
+
+// Batched forms: one call per array, so the kernel is inlined into the loop
+void dayOfWeekBatch(const struct KernelInput *in, long long *out, int count)
+{
+    for (int i = 0; i < count; i++)
+        out[i] = getDayOfWeek(in[i].date.day, in[i].date.month, in[i].date.year);
+}
+
+void leapYearBatch(const struct KernelInput *in, long long *out, int count)
+{
+    for (int i = 0; i < count; i++)
+        out[i] = isLeapYear(in[i].date.year);
+}
+
+void daysInMonthBatch(const struct KernelInput *in, long long *out, int count)
+{
+    for (int i = 0; i < count; i++)
+        out[i] = getDaysInMonth(in[i].date.month, in[i].date.year);
+}
+
+void toSerialBatch(const struct KernelInput *in, long long *out, int count)
+{
+    for (int i = 0; i < count; i++)
+        out[i] = dateToSerial(in[i].date.year, in[i].date.month, in[i].date.day);
+}
+
+void fromSerialBatch(const struct KernelInput *in, long long *out, int count)
+{
+    for (int i = 0; i < count; i++)
+        out[i] = serialToDate(in[i].serial).day;
+}
+
+void referenceBatch(const struct KernelInput *in, long long *out, int count)
+{
+    for (int i = 0; i < count; i++)
+        out[i] = referenceDays(in[i].date.year, in[i].date.month, in[i].date.day);
+}
+
+struct Kernel
+{
+    const char *name;
+    long long (*scalar)(const struct KernelInput *);
+    void (*batch)(const struct KernelInput *, long long *, int);
+};
+
+static const struct Kernel kernels[] = {
+    {"day_of_week", dayOfWeekKernel, dayOfWeekBatch},
+    {"leap_year", leapYearKernel, leapYearBatch},
+    {"days_in_month", daysInMonthKernel, daysInMonthBatch},
+    {"to_serial", toSerialKernel, toSerialBatch},
+    {"from_serial", fromSerialKernel, fromSerialBatch},
+    {"reference_days", referenceKernel, referenceBatch},
+};
+
+#define KERNEL_SET (1 << 16)   // Distinct inputs, cycled through
+#define KERNEL_BATCH 4096
+
+static struct KernelInput kernelInputs[KERNEL_SET];
+
+// Scalar form: one call per date through a function pointer, as a caller in
+// another file would make it
+long long runScalar(const struct Kernel *k, long calls)
+{
+    long long (*volatile scalar)(const struct KernelInput *) = k->scalar;
+    long long checksum = 0;
+    for (long i = 0; i < calls; i++)
+        checksum += scalar(&kernelInputs[i & (KERNEL_SET - 1)]);
+    return checksum;
+}
+
+long long runBatched(const struct Kernel *k, long calls)
+{
+    static _Thread_local long long out[KERNEL_BATCH];
+    long long checksum = 0;
+    for (long done = 0; done < calls; done += KERNEL_BATCH)
+    {
+        k->batch(&kernelInputs[done & (KERNEL_SET - 1)], out, KERNEL_BATCH);
+        checksum += out[done / KERNEL_BATCH % KERNEL_BATCH];
+    }
+    return checksum;
+}
+
+// Processors available for the threaded form (threads are not used on Windows)
+int cpuCount()
+{
+#ifdef _WIN32
+    return 1;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+#endif
+}
+
+#ifndef _WIN32
+struct KernelThread
+{
+    const struct Kernel *kernel;
+    long calls;
+    long long checksum;
+    int threaded;  // 0 if the thread could not be started and the work ran inline
+};
+
+void *kernelThread(void *arg)
+{
+    struct KernelThread *t = arg;
+    t->checksum = runBatched(t->kernel, t->calls);
+    return NULL;
+}
+
+// Batched form on several threads at once; calls (whole batches) is the total
+// over all threads
+long long runThreaded(const struct Kernel *k, long calls, int threads)
+{
+    long batches = calls / KERNEL_BATCH;
+    pthread_t ids[256];
+    struct KernelThread work[256];
+    long long checksum = 0;
+    for (int t = 0; t < threads; t++)
+    {
+        work[t].kernel = k;
+        work[t].calls = (batches / threads + (t < batches % threads)) * KERNEL_BATCH;
+        work[t].threaded = pthread_create(&ids[t], NULL, kernelThread, &work[t]) == 0;
+    }
+    for (int t = 0; t < threads; t++)
+    {
+        if (work[t].threaded)
+            pthread_join(ids[t], NULL);
+        else
+            kernelThread(&work[t]);
+        checksum += work[t].checksum;
+    }
+    return checksum;
+}
+#endif
+
+// ns per call of each date kernel, scalar, batched and on several threads, as CSV
+int runKernelBenchmark(long calls, int threads)
+{
+    srand(44);
+    for (int i = 0; i < KERNEL_SET; i++)
+    {
+        struct Date *date = &kernelInputs[i].date;
+        date->year = rand() % 20001 - 10000;          // Negative years included
+        date->month = 1 + rand() % 12;
+        date->day = 1 + rand() % getDaysInMonth(date->month, date->year);
+        kernelInputs[i].serial = dateToSerial(date->year, date->month, date->day);
+    }
+    calls = (calls + KERNEL_BATCH - 1) / KERNEL_BATCH * KERNEL_BATCH;
+    if (calls < KERNEL_BATCH)
+        calls = KERNEL_BATCH;
+    if (threads < 1)
+        threads = 1;
+    if (threads > 256)
+        threads = 256;
+
+    printf("kernel,form,threads,calls,ns_per_call,mcalls_per_s,checksum\n");
+    for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++)
+    {
+        for (int form = 0; form < 3; form++)
+        {
+            int used = form == 2 ? threads : 1;
+            long long checksum;
+            double start = wallSeconds();
+            if (form == 0)
+                checksum = runScalar(&kernels[k], calls);
+            else if (form == 1)
+                checksum = runBatched(&kernels[k], calls);
+            else
+            {
+                // One thread would only repeat the batched row
+#ifdef _WIN32
+                break;
+#else
+                if (threads == 1)
+                    break;
+                checksum = runThreaded(&kernels[k], calls, used);
+#endif
+            }
+            double seconds = wallSeconds() - start;
+            static const char *forms[] = {"scalar", "batched", "threaded"};
+            printf("%s,%s,%d,%ld,%.3f,%.1f,%lld\n", kernels[k].name, forms[form], used, calls,
+                   seconds * 1e9 / calls, calls / seconds / 1e6, checksum);
+        }
+    }
+    return 0;
 }
@@ -1,90 +1,688 @@
 #include <stdio.h>      // For printf, getchar
 #include <time.h>       // For time and localtime
-#include <stdlib.h>     // For system()
+#include <stdlib.h>     // Standard utilities
+#include <string.h>     // For memcpy, memset
+#include <stdarg.h>     // For screen_print's variable arguments
+
+// Events reported by wait_for_event
+#define EVENT_TICK 1    // The display is due for its next update
+#define EVENT_KEY  2    // A key press is waiting to be read
+
+// Nanoseconds in a second
+#define NS_PER_SEC 1000000000L
+
+// Absolute time (ns) of the first tick after `now` when ticking every
+// `intervalNs`, counting from the start of each second
+long long next_boundary_ns(const struct timespec *now, long intervalNs) {
+    long long next = (now->tv_nsec / intervalNs + 1) * (long long)intervalNs;
+    if (next >= NS_PER_SEC)
+        next = NS_PER_SEC;
+    return (long long)now->tv_sec * NS_PER_SEC + next;
+}
 
 // Platform-specific headers and functions
 #ifdef _WIN32
     #include <conio.h>  // For getch, kbhit on Windows
     #include <windows.h> // For Sleep on Windows
-
-    // Clears the console screen on Windows
-    void clear_screen() {
-        system("cls");
-    }
+    #include <io.h>      // For dup, dup2
+    #include <fcntl.h>   // For _O_CREAT, _O_RDWR
+    #include <sys/stat.h>
+    #include <sys/locking.h> // For _locking
 
     // Sleep for given milliseconds (Windows)
     void sleep_ms(int milliseconds) {
         Sleep(milliseconds);
     }
 
+    // Writes raw bytes to the console
+    void write_out(const char *buf, size_t len) {
+        fwrite(buf, 1, len, stdout);
+        fflush(stdout);
+    }
+
+    // Lets the console interpret ANSI escape codes (Windows 10+)
+    void enable_ansi() {
+        HANDLE out = GetStdHandle(STD_OUTPUT_HANDLE);
+        DWORD mode = 0;
+        if (GetConsoleMode(out, &mode))
+            SetConsoleMode(out, mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING);
+    }
+
+    // Console size in character cells
+    void get_terminal_size(int *rows, int *cols) {
+        CONSOLE_SCREEN_BUFFER_INFO info;
+        if (GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &info)) {
+            *rows = info.srWindow.Bottom - info.srWindow.Top + 1;
+            *cols = info.srWindow.Right - info.srWindow.Left + 1;
+        }
+    }
+
+    // Wall-clock time with sub-second resolution
+    void get_realtime(struct timespec *ts) {
+        timespec_get(ts, TIME_UTC);
+    }
+
+    // Clock for measuring durations
+    void get_monotonic(struct timespec *ts) {
+        timespec_get(ts, TIME_UTC);
+    }
+
+    // Thread-safe conversion to local time
+    void local_time(const time_t *when, struct tm *out) {
+        localtime_s(out, when);
+    }
+
+    // The console delivers key presses without line buffering already
+    void input_init() {
+    }
+
+    // Read a pending key, or -1 if there is none
+    int read_key() {
+        return kbhit() ? getch() : -1;
+    }
+
+    // Waits for an exclusive lock on `path`; returns a handle for unlock_file, or -1
+    int lock_file(const char *path) {
+        int fd = _open(path, _O_RDWR | _O_CREAT, _S_IREAD | _S_IWRITE);
+        if (fd < 0)
+            return -1;
+        while (_locking(fd, _LK_LOCK, 1) != 0)
+            ;   // _LK_LOCK gives up after ten seconds; keep waiting
+        return fd;
+    }
+
+    void unlock_file(int fd) {
+        if (fd < 0)
+            return;
+        _lseek(fd, 0, SEEK_SET);
+        _locking(fd, _LK_UNLCK, 1);
+        _close(fd);
+    }
+
+    static long tickIntervalNs = NS_PER_SEC;
+    static long long nextTickNs;
+
+    // Ticks every `intervalNs`, aligned to whole seconds
+    void timer_start(long intervalNs) {
+        struct timespec now;
+        get_realtime(&now);
+        tickIntervalNs = intervalNs;
+        nextTickNs = next_boundary_ns(&now, intervalNs);
+    }
+
+    // Waits for the next tick or key press, checking the keyboard every few milliseconds
+    int wait_for_event() {
+        while (1) {
+            if (kbhit())
+                return EVENT_KEY;
+            struct timespec now;
+            get_realtime(&now);
+            long long nowNs = (long long)now.tv_sec * NS_PER_SEC + now.tv_nsec;
+            if (nowNs >= nextTickNs) {
+                while (nextTickNs <= nowNs)
+                    nextTickNs += tickIntervalNs;
+                return EVENT_TICK;
+            }
+            long long waitMs = (nextTickNs - nowNs) / 1000000;
+            sleep_ms(waitMs < 5 ? (int)waitMs : 5);
+        }
+    }
+
 #else
     // For Linux / macOS
-    #include <unistd.h>     // For usleep
+    #include <unistd.h>     // For read, write
     #include <termios.h>    // For terminal I/O
-    #include <fcntl.h>      // For file control options
-
-    // Clears the console screen on Unix
-    void clear_screen() {
-        system("clear");
-    }
+    #include <poll.h>       // For waiting on the keyboard and the timer together
+    #include <sys/ioctl.h>  // For the terminal size
+    #include <sys/file.h>   // For flock
+    #include <fcntl.h>      // For open
+    #include <sys/stat.h>   // For noticing a rewritten alarm file
+    #ifdef __linux__
+        #include <sys/timerfd.h> // For ticks aligned to the wall clock
+    #endif
 
     // Sleep for given milliseconds (Unix)
     void sleep_ms(int milliseconds) {
         usleep(milliseconds * 1000); // usleep takes microseconds
     }
 
-    // Check if a key was pressed (non-blocking)
-    int kbhit() {
-        struct termios oldt, newt;
-        int ch;
-        int oldf;
+    // Writes raw bytes to the terminal in as few system calls as possible
+    void write_out(const char *buf, size_t len) {
+        while (len > 0) {
+            ssize_t n = write(STDOUT_FILENO, buf, len);
+            if (n <= 0)
+                return;
+            buf += n;
+            len -= n;
+        }
+    }
+
+    // ANSI escape codes work out of the box on Unix terminals
+    void enable_ansi() {
+    }
+
+    // Terminal size in character cells
+    void get_terminal_size(int *rows, int *cols) {
+        struct winsize ws;
+        if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_row > 0 && ws.ws_col > 0) {
+            *rows = ws.ws_row;
+            *cols = ws.ws_col;
+        }
+    }
+
+    // Wall-clock time with sub-second resolution
+    void get_realtime(struct timespec *ts) {
+        clock_gettime(CLOCK_REALTIME, ts);
+    }
 
-        tcgetattr(STDIN_FILENO, &oldt);             // Save terminal settings
-        newt = oldt;
-        newt.c_lflag &= ~(ICANON | ECHO);           // Disable canonical mode & echo
-        tcsetattr(STDIN_FILENO, TCSANOW, &newt);    // Apply new settings
-        oldf = fcntl(STDIN_FILENO, F_GETFL, 0);
-        fcntl(STDIN_FILENO, F_SETFL, oldf | O_NONBLOCK);
+    // Clock for measuring durations (never jumps)
+    void get_monotonic(struct timespec *ts) {
+        clock_gettime(CLOCK_MONOTONIC, ts);
+    }
 
-        ch = getchar();
+    // Thread-safe conversion to local time
+    void local_time(const time_t *when, struct tm *out) {
+        localtime_r(when, out);
+    }
 
-        tcsetattr(STDIN_FILENO, TCSANOW, &oldt);    // Restore old settings
-        fcntl(STDIN_FILENO, F_SETFL, oldf);
+    static struct termios savedTermios;
+    static int termiosSaved = 0;
 
-        if (ch != EOF) {
-            ungetc(ch, stdin); // Put the char back
-            return 1;
+    // Restores the terminal settings saved by input_init
+    void input_restore() {
+        if (termiosSaved)
+            tcsetattr(STDIN_FILENO, TCSANOW, &savedTermios);
+    }
+
+    // Puts the terminal in raw mode once, so key presses arrive immediately and unechoed
+    void input_init() {
+        if (tcgetattr(STDIN_FILENO, &savedTermios) != 0)
+            return;   // Not a terminal (e.g. piped input)
+        termiosSaved = 1;
+        atexit(input_restore);
+
+        struct termios raw = savedTermios;
+        raw.c_lflag &= ~(ICANON | ECHO);   // Disable canonical mode & echo
+        raw.c_cc[VMIN] = 1;
+        raw.c_cc[VTIME] = 0;
+        tcsetattr(STDIN_FILENO, TCSANOW, &raw);
+    }
+
+    static int stdinOpen = 1;   // Cleared once stdin reaches end of file
+
+    // Read a pending key, or -1 if there is none
+    int read_key() {
+        unsigned char ch;
+        ssize_t n = read(STDIN_FILENO, &ch, 1);
+        if (n == 0)
+            stdinOpen = 0;      // Stop waiting on a closed stdin
+        return n == 1 ? ch : -1;
+    }
+
+    // Waits for an exclusive lock on `path`; returns a handle for unlock_file, or -1
+    int lock_file(const char *path) {
+        int fd = open(path, O_RDWR | O_CREAT, 0644);
+        if (fd >= 0 && flock(fd, LOCK_EX) != 0) {
+            close(fd);
+            fd = -1;
         }
+        return fd;
+    }
 
-        return 0;
+    void unlock_file(int fd) {
+        if (fd >= 0)
+            close(fd);      // Closing the last descriptor drops the lock
+    }
+
+    static long tickIntervalNs = NS_PER_SEC;
+#ifdef __linux__
+    static int tickFd = -1;
+
+    // Ticks every `intervalNs` on a timerfd armed at the next boundary (the next
+    // whole second for 1 s ticks), so updates land on wall-clock edges instead of drifting
+    void timer_start(long intervalNs) {
+        struct timespec now;
+        get_realtime(&now);
+        tickIntervalNs = intervalNs;
+        if (tickFd < 0)
+            tickFd = timerfd_create(CLOCK_REALTIME, TFD_CLOEXEC);
+
+        long long first = next_boundary_ns(&now, intervalNs);
+        struct itimerspec spec;
+        spec.it_value.tv_sec = first / NS_PER_SEC;
+        spec.it_value.tv_nsec = first % NS_PER_SEC;
+        spec.it_interval.tv_sec = intervalNs / NS_PER_SEC;
+        spec.it_interval.tv_nsec = intervalNs % NS_PER_SEC;
+        timerfd_settime(tickFd, TFD_TIMER_ABSTIME, &spec, NULL);
+    }
+
+    // Sleeps in poll() until the timer fires or a key is pressed
+    int wait_for_event() {
+        struct pollfd fds[2] = {
+            {tickFd, POLLIN, 0},
+            {STDIN_FILENO, POLLIN, 0},
+        };
+        while (poll(fds, stdinOpen ? 2 : 1, -1) < 0)
+            ;   // Interrupted by a signal: wait again
+
+        int events = 0;
+        if (fds[0].revents & POLLIN) {
+            unsigned long long expirations;
+            if (read(tickFd, &expirations, sizeof(expirations)) > 0)
+                events |= EVENT_TICK;
+        }
+        if (stdinOpen && (fds[1].revents & (POLLIN | POLLHUP)))
+            events |= EVENT_KEY;
+        return events;
+    }
+#else
+    static long long nextTickNs;
+
+    // Ticks every `intervalNs`, aligned to whole seconds
+    void timer_start(long intervalNs) {
+        struct timespec now;
+        get_realtime(&now);
+        tickIntervalNs = intervalNs;
+        nextTickNs = next_boundary_ns(&now, intervalNs);
     }
 
-    // Read a character without waiting for Enter key
-    int getch() {
-        struct termios oldt, newt;
-        int ch;
-        tcgetattr(STDIN_FILENO, &oldt);
-        newt = oldt;
-        newt.c_lflag &= ~(ICANON | ECHO); // Turn off canonical and echo
-        tcsetattr(STDIN_FILENO, TCSANOW, &newt);
-        ch = getchar();
-        tcsetattr(STDIN_FILENO, TCSANOW, &oldt); // Restore
-        return ch;
+    // Sleeps in poll() on stdin with a timeout that ends at the next tick
+    int wait_for_event() {
+        while (1) {
+            struct timespec now;
+            get_realtime(&now);
+            long long nowNs = (long long)now.tv_sec * NS_PER_SEC + now.tv_nsec;
+            if (nowNs >= nextTickNs) {
+                while (nextTickNs <= nowNs)
+                    nextTickNs += tickIntervalNs;
+                return EVENT_TICK;
+            }
+
+            struct pollfd fd = {STDIN_FILENO, POLLIN, 0};
+            int timeoutMs = (int)((nextTickNs - nowNs + 999999) / 1000000);
+            if (poll(&fd, stdinOpen ? 1 : 0, timeoutMs) > 0 && (fd.revents & (POLLIN | POLLHUP)))
+                return EVENT_KEY;
+        }
     }
 #endif
+#endif
+
+// Nanoseconds on the monotonic clock (unaffected by wall-clock changes)
+long long monotonic_ns() {
+    struct timespec ts;
+    get_monotonic(&ts);
+    return (long long)ts.tv_sec * NS_PER_SEC + ts.tv_nsec;
+}
+
+// Frame profiling: every phase of every frame is timed into an HDR-style
+// histogram (log-linear buckets, HIST_SUB_BITS of precision per power of two,
+// about 3% error) so millions of frames cost a fixed few kilobytes.
+#define HIST_SUB_BITS 5
+#define HIST_SUB (1 << HIST_SUB_BITS)
+#define HIST_BUCKETS ((64 - HIST_SUB_BITS) * HIST_SUB)
+
+typedef struct {
+    unsigned long long counts[HIST_BUCKETS];
+    unsigned long long total;
+    long long min, max, sum;
+} Histogram;
+
+// Phases of a frame, in the order they happen
+enum {
+    PHASE_WAIT,     // Sleeping until the next tick or key
+    PHASE_INPUT,    // Reading and handling keys, firing timers
+    PHASE_TIME,     // Reading the clock and converting to local time
+    PHASE_COMPOSE,  // Drawing the frame into the back buffer
+    PHASE_DIFF,     // Comparing buffers and building escape codes
+    PHASE_WRITE,    // Writing to the terminal
+    PHASE_FRAME,    // Whole frame, time to write
+    PHASE_COUNT
+};
+
+static const char *phaseNames[PHASE_COUNT] = {
+    "wait", "input", "time", "compose", "diff", "write", "frame"
+};
+
+// Where the P key writes the phase timings
+#define PROFILE_FILE "clock_profile.txt"
+
+Histogram phaseHist[PHASE_COUNT];
+long long phaseMark;    // End of the previous phase
+
+int hist_index(long long v) {
+    if (v < HIST_SUB)
+        return v < 0 ? 0 : (int)v;
+    int msb = 63 - __builtin_clzll((unsigned long long)v);
+    return (msb - HIST_SUB_BITS + 1) * HIST_SUB + (int)(v >> (msb - HIST_SUB_BITS)) - HIST_SUB;
+}
+
+// Smallest value that falls into bucket `index`
+long long hist_value(int index) {
+    if (index < HIST_SUB)
+        return index;
+    int shift = index / HIST_SUB - 1;
+    return (long long)(index % HIST_SUB + HIST_SUB) << shift;
+}
+
+void hist_record(Histogram *h, long long v) {
+    h->counts[hist_index(v)]++;
+    if (h->total == 0 || v < h->min)
+        h->min = v;
+    if (v > h->max)
+        h->max = v;
+    h->sum += v;
+    h->total++;
+}
+
+// Value at quantile q (0..1)
+long long hist_quantile(const Histogram *h, double q) {
+    unsigned long long rank = (unsigned long long)(q * (h->total - 1)) + 1, seen = 0;
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        seen += h->counts[i];
+        if (seen >= rank)
+            return hist_value(i) > h->max ? h->max : hist_value(i);
+    }
+    return h->max;
+}
+
+// Starts timing phases from now
+void profile_begin() {
+    phaseMark = monotonic_ns();
+}
+
+// Ends `phase`: records the time since the previous phase ended
+void profile_phase(int phase) {
+    long long now = monotonic_ns();
+    hist_record(&phaseHist[phase], now - phaseMark);
+    phaseMark = now;
+}
+
+void profile_reset() {
+    memset(phaseHist, 0, sizeof(phaseHist));
+}
+
+// Prints a table of phase timings in microseconds
+void profile_dump(FILE *fp) {
+    fprintf(fp, "%-8s %10s %9s %9s %9s %9s %9s %9s\n",
+        "phase", "count", "mean", "p50", "p90", "p99", "p99.9", "max");
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        const Histogram *h = &phaseHist[p];
+        if (h->total == 0)
+            continue;
+        fprintf(fp, "%-8s %10llu %9.2f %9.2f %9.2f %9.2f %9.2f %9.2f\n", phaseNames[p], h->total,
+            (double)h->sum / h->total / 1e3, hist_quantile(h, 0.5) / 1e3, hist_quantile(h, 0.9) / 1e3,
+            hist_quantile(h, 0.99) / 1e3, hist_quantile(h, 0.999) / 1e3, h->max / 1e3);
+    }
+    fprintf(fp, "(microseconds)\n");
+}
+
+// Largest screen the renderer will manage
+#define MAX_ROWS 100
+#define MAX_COLS 250
+// Unchanged cells worth rewriting rather than emitting a new cursor position
+#define DIFF_GAP 4
+
+// Double-buffered screen: frames are composed into `back`, compared with `front`
+// (what the terminal is showing) and only the changed cells are written out.
+typedef struct {
+    int rows, cols;
+    char front[MAX_ROWS * MAX_COLS];   // What the terminal currently shows
+    char back[MAX_ROWS * MAX_COLS];    // Frame being composed
+    char out[MAX_ROWS * MAX_COLS * 4]; // Escape codes + text for one frame
+    int cleared;                       // Terminal was cleared and front matches it
+} Screen;
+
+Screen screen;
+
+// Renderer statistics, shown when the clock exits
+unsigned long framesDrawn = 0;
+unsigned long bytesWritten = 0;
+
+// Sets up the screen buffers for the current terminal size
+void screen_init() {
+    int rows = 24, cols = 80;
+    get_terminal_size(&rows, &cols);
+    screen.rows = rows < MAX_ROWS ? rows : MAX_ROWS;
+    screen.cols = cols < MAX_COLS ? cols : MAX_COLS;
+    screen.cleared = 0;
+    enable_ansi();
+}
+
+// Starts a new frame with a blank back buffer
+void screen_begin() {
+    memset(screen.back, ' ', sizeof(screen.back));
+}
+
+// Prints formatted text into the back buffer at (row, col), clipped to the screen
+void screen_print(int row, int col, const char *fmt, ...) {
+    char text[MAX_COLS + 1];
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(text, sizeof(text), fmt, args);
+    va_end(args);
+
+    if (row < 0 || row >= screen.rows || col >= screen.cols || len <= 0)
+        return;
+    if (len > (int)sizeof(text) - 1)
+        len = sizeof(text) - 1;
+    if (col + len > screen.cols)
+        len = screen.cols - col;
+    memcpy(&screen.back[row * MAX_COLS + col], text, len);
+}
+
+// Copies raw cells into the back buffer at (row, col), clipped to the screen
+void screen_blit(int row, int col, const char *cells, int len) {
+    if (row < 0 || row >= screen.rows || col < 0 || col >= screen.cols)
+        return;
+    if (col + len > screen.cols)
+        len = screen.cols - col;
+    memcpy(&screen.back[row * MAX_COLS + col], cells, len);
+}
+
+// Appends a decimal number to the output buffer
+size_t append_number(char *out, size_t pos, int n) {
+    char digits[12];
+    int len = 0;
+    do {
+        digits[len++] = '0' + n % 10;
+        n /= 10;
+    } while (n > 0);
+    while (len > 0)
+        out[pos++] = digits[--len];
+    return pos;
+}
+
+// Writes the difference between the back and front buffers to the terminal
+// with cursor-positioning escape codes, in a single write
+void screen_flush() {
+    size_t pos = 0;
+    int cursorRow = -1, cursorCol = -1;
+
+    // First frame: hide the cursor and clear the terminal, then diff against blanks
+    if (!screen.cleared) {
+        static const char clearSeq[] = "\033[?25l\033[H\033[2J";
+        memcpy(screen.out, clearSeq, sizeof(clearSeq) - 1);
+        pos = sizeof(clearSeq) - 1;
+        memset(screen.front, ' ', sizeof(screen.front));
+        screen.cleared = 1;
+    }
+
+    for (int r = 0; r < screen.rows; r++) {
+        const char *back = &screen.back[r * MAX_COLS];
+        const char *front = &screen.front[r * MAX_COLS];
+        int c = 0;
+        while (c < screen.cols) {
+            if (back[c] == front[c]) {
+                c++;
+                continue;
+            }
+
+            // Extend the run over short stretches of unchanged cells
+            int start = c, last = c;
+            for (int j = c + 1; j < screen.cols && j - last <= DIFF_GAP; j++) {
+                if (back[j] != front[j])
+                    last = j;
+            }
+
+            // Move the cursor only if it is not already there (ESC [ row ; col H)
+            if (cursorRow != r || cursorCol != start) {
+                screen.out[pos++] = '\033';
+                screen.out[pos++] = '[';
+                pos = append_number(screen.out, pos, r + 1);
+                screen.out[pos++] = ';';
+                pos = append_number(screen.out, pos, start + 1);
+                screen.out[pos++] = 'H';
+            }
+            memcpy(&screen.out[pos], &back[start], last - start + 1);
+            pos += last - start + 1;
+            cursorRow = r;
+            cursorCol = last + 1;
+            c = last + 1;
+        }
+    }
+
+    profile_phase(PHASE_DIFF);
+    if (pos > 0)
+        write_out(screen.out, pos);
+    profile_phase(PHASE_WRITE);
+    memcpy(screen.front, screen.back, sizeof(screen.front));
+    framesDrawn++;
+    bytesWritten += pos;
+}
+
+// Clears the terminal, shows the cursor again and prints renderer statistics
+void screen_close() {
+    const char *reset = "\033[H\033[2J\033[?25h";
+    write_out(reset, strlen(reset));
+    screen.cleared = 0;
+
+    double cpuSeconds = (double)clock() / CLOCKS_PER_SEC;
+    if (framesDrawn > 0) {
+        printf("Frames: %lu, %.1f bytes/frame, %.1f us CPU/frame\n",
+            framesDrawn, (double)bytesWritten / framesDrawn, cpuSeconds * 1e6 / framesDrawn);
+    }
+}
+
+// Event loop timing samples (nanoseconds), summarized when the clock exits
+#define MAX_SAMPLES 4096
+long tickJitter[MAX_SAMPLES];   // How late each tick woke up after its boundary
+int tickCount = 0;
+long keyLatency[MAX_SAMPLES];   // From noticing a key press to the updated frame
+int keyCount = 0;
+
+// Stores a sample, keeping the most recent MAX_SAMPLES
+void record_sample(long *samples, int *count, long value) {
+    samples[*count % MAX_SAMPLES] = value;
+    (*count)++;
+}
+
+// Compares two samples for qsort
+int compare_samples(const void *a, const void *b) {
+    long x = *(const long *)a, y = *(const long *)b;
+    return (x > y) - (x < y);
+}
+
+// Prints the median, 99th percentile and maximum of a set of samples in microseconds
+void print_percentiles(const char *label, const long *samples, int count) {
+    static long sorted[MAX_SAMPLES];
+    int n = count < MAX_SAMPLES ? count : MAX_SAMPLES;
+    if (n == 0)
+        return;
+    memcpy(sorted, samples, n * sizeof(long));
+    qsort(sorted, n, sizeof(long), compare_samples);
+    printf("%s: p50 %.1f us, p99 %.1f us, max %.1f us (%d samples)\n", label,
+        sorted[n / 2] / 1e3, sorted[n * 99 / 100] / 1e3, sorted[n - 1] / 1e3, count);
+}
+
+// Nanoseconds between two wall-clock readings
+long elapsed_ns(const struct timespec *from, const struct timespec *to) {
+    return (to->tv_sec - from->tv_sec) * NS_PER_SEC + (to->tv_nsec - from->tv_nsec);
+}
 
 int is24Hour = 1; // Global flag to toggle between 12-hour and 24-hour formats
+int hiRes = 0;    // Millisecond mode with large digits, refreshed at HIRES_FPS
+int showStats = 0; // Show the frame statistics overlay
+
+// What the main area shows
+enum { VIEW_CLOCK, VIEW_WORLD, VIEW_STOPWATCH, VIEW_COUNTDOWN };
+int view = VIEW_CLOCK;
 
-// Function to display the current time on the console
-void print_time(int blink) {
-    time_t now;               // Variable to hold current system time
-    struct tm *t;             // Struct to break down time into components
-    char ampm[3] = "";        // AM/PM string for 12-hour format
+// Frame rate of the millisecond mode
+#define HIRES_FPS 60
+
+// Large seven-segment digits: GLYPH_ROWS tall, built once into an atlas so a
+// frame only needs a memcpy per glyph row
+#define GLYPH_ROWS 5
+#define GLYPH_COLS 6
+// Atlas slots after the ten digits
+#define GLYPH_COLON 10
+#define GLYPH_DOT 11
+#define GLYPH_BLANK 12
+#define GLYPH_COUNT 13
+
+char glyphAtlas[GLYPH_COUNT][GLYPH_ROWS][GLYPH_COLS];
+int glyphWidth[GLYPH_COUNT];
+
+// Segments lit for each digit (bit 0 = top, then upper right, lower right,
+// bottom, lower left, upper left, middle)
+static const unsigned char digitSegments[10] = {
+    0x3F, 0x06, 0x5B, 0x4F, 0x66, 0x6D, 0x7D, 0x07, 0x7F, 0x6F
+};
+
+// Pre-renders every glyph into the atlas
+void build_glyph_atlas() {
+    memset(glyphAtlas, ' ', sizeof(glyphAtlas));
+    for (int d = 0; d < 10; d++) {
+        unsigned char seg = digitSegments[d];
+        char (*g)[GLYPH_COLS] = glyphAtlas[d];
+        if (seg & 0x01) memcpy(&g[0][1], "###", 3);
+        if (seg & 0x20) g[1][0] = '#';
+        if (seg & 0x02) g[1][4] = '#';
+        if (seg & 0x40) memcpy(&g[2][1], "###", 3);
+        if (seg & 0x10) g[3][0] = '#';
+        if (seg & 0x04) g[3][4] = '#';
+        if (seg & 0x08) memcpy(&g[4][1], "###", 3);
+        glyphWidth[d] = GLYPH_COLS;
+    }
+    glyphAtlas[GLYPH_COLON][1][1] = '#';
+    glyphAtlas[GLYPH_COLON][3][1] = '#';
+    glyphAtlas[GLYPH_DOT][4][1] = '#';
+    glyphWidth[GLYPH_COLON] = glyphWidth[GLYPH_DOT] = glyphWidth[GLYPH_BLANK] = 3;
+}
+
+// Draws a string of digits, ':', '.' and ' ' in large glyphs; returns the width used
+int draw_big_text(int row, int col, const char *text) {
+    int start = col;
+    for (; *text; text++) {
+        int g = GLYPH_BLANK;
+        if (*text >= '0' && *text <= '9')
+            g = *text - '0';
+        else if (*text == ':')
+            g = GLYPH_COLON;
+        else if (*text == '.')
+            g = GLYPH_DOT;
+        for (int r = 0; r < GLYPH_ROWS; r++)
+            screen_blit(row + r, col, glyphAtlas[g][r], glyphWidth[g]);
+        col += glyphWidth[g];
+    }
+    return col - start;
+}
 
-    time(&now);               // Get current time
-    t = localtime(&now);      // Convert to local time structure
+// Returns the broken-down local time for `now`, calling localtime only when the second changes
+const struct tm *current_tm(const struct timespec *now) {
+    static time_t cachedSecond = -1;
+    static struct tm cached;
+    if (now->tv_sec != cachedSecond) {
+        local_time(&now->tv_sec, &cached);
+        cachedSecond = now->tv_sec;
+    }
+    return &cached;
+}
 
+// Hour to display and its AM/PM suffix (empty in 24-hour mode)
+int display_hour(const struct tm *t, const char **ampm) {
     int hour = t->tm_hour;
+    *ampm = "";
 
     // If 12-hour mode is enabled
     if (!is24Hour) {
@@ -92,52 +690,2201 @@ void print_time(int blink) {
             hour = 12;
         else if (hour > 12)
             hour -= 12;
+        *ampm = t->tm_hour >= 12 ? "PM" : "AM";
+    }
+    return hour;
+}
+
+// Frame timing for the stats overlay
+#define FRAME_HISTORY 256
+long frameTimes[FRAME_HISTORY];   // Compose + flush time of recent frames (ns)
+int frameTimeCount = 0;
+double cpuPercent = 0;            // Process CPU use over the last second
 
-        snprintf(ampm, sizeof(ampm), t->tm_hour >= 12 ? "PM" : "AM");
+// Updates the CPU usage estimate about once a second
+void update_cpu_usage(const struct timespec *now) {
+    static struct timespec lastWall;
+    static clock_t lastCpu;
+    static int started = 0;
+
+    if (!started) {
+        lastWall = *now;
+        lastCpu = clock();
+        started = 1;
+        return;
     }
+    long wall = elapsed_ns(&lastWall, now);
+    if (wall < NS_PER_SEC)
+        return;
+    clock_t cpu = clock();
+    cpuPercent = 100.0 * (double)(cpu - lastCpu) / CLOCKS_PER_SEC / (wall / 1e9);
+    lastWall = *now;
+    lastCpu = cpu;
+}
+
+// Draws frame time percentiles and CPU usage in the bottom rows
+void draw_stats_overlay() {
+    static long sorted[FRAME_HISTORY];
+    int n = frameTimeCount < FRAME_HISTORY ? frameTimeCount : FRAME_HISTORY;
+    if (n == 0)
+        return;
+    memcpy(sorted, frameTimes, n * sizeof(long));
+    qsort(sorted, n, sizeof(long), compare_samples);
+
+    int row = screen.rows - 2;
+    screen_print(row, 2, "Frame time p50 %7.1f us  p90 %7.1f us  p99 %7.1f us",
+        sorted[n / 2] / 1e3, sorted[n * 9 / 10] / 1e3, sorted[n * 99 / 100] / 1e3);
+    screen_print(row + 1, 2, "CPU %5.1f%%  %lu frames  %.1f bytes/frame",
+        cpuPercent, framesDrawn, framesDrawn ? (double)bytesWritten / framesDrawn : 0.0);
+}
+
+// Function to draw the current time into the screen buffer
+void print_time(const struct timespec *now) {
+    const struct tm *t = current_tm(now); // Cached local time
+    const char *ampm;                     // AM/PM string for 12-hour format
+    int hour = display_hour(t, &ampm);
+    int blink = now->tv_sec % 2 == 0;     // Blinking colon every second
 
     // Display clock interface
-    printf("\n\n\t\t+--------------------------+\n");
-    printf("\t\t|     DIGITAL CLOCK        |\n");
-    printf("\t\t+--------------------------+\n\n");
+    screen_print(2, 16, "+--------------------------+");
+    screen_print(3, 16, "|     DIGITAL CLOCK        |");
+    screen_print(4, 16, "+--------------------------+");
 
     // Print current time in hh:mm:ss format
-    printf("\t\t      %02d%c%02d%c%02d %s\n",
+    screen_print(6, 22, "%02d%c%02d%c%02d %s",
         hour,
-        blink ? ':' : ' ',  // Blinking colon every second
+        blink ? ':' : ' ',
         t->tm_min,
         blink ? ':' : ' ',
         t->tm_sec,
-        is24Hour ? "" : ampm
+        ampm
     );
+}
+
+// Draws hh:mm:ss.mmm in large digits (millisecond mode)
+void print_time_hires(const struct timespec *now) {
+    const struct tm *t = current_tm(now);
+    const char *ampm;
+    int hour = display_hour(t, &ampm);
+    int ms = (int)(now->tv_nsec / 1000000);
+    char text[16];
+
+    // Two-digit fields by hand: this runs HIRES_FPS times a second
+    text[0] = '0' + hour / 10;     text[1] = '0' + hour % 10;     text[2] = ':';
+    text[3] = '0' + t->tm_min / 10; text[4] = '0' + t->tm_min % 10; text[5] = ':';
+    text[6] = '0' + t->tm_sec / 10; text[7] = '0' + t->tm_sec % 10; text[8] = '.';
+    text[9] = '0' + ms / 100;      text[10] = '0' + ms / 10 % 10; text[11] = '0' + ms % 10;
+    text[12] = '\0';
 
-    // User controls
-    printf("\n\t[H] Toggle 12/24 Hour   [Q] Quit\n");
+    screen_print(1, 8, "DIGITAL CLOCK  (milliseconds)");
+    int width = draw_big_text(3, 8, text);
+    screen_print(7, 8 + width + 1, "%s", ampm);
 }
 
-// Entry point of the program
-int main() {
-    int blink = 1;   // Toggle colon blinking effect
-    char key;        // To capture user keypresses
+// ---------------------------------------------------------------------------
+// World clock
+// ---------------------------------------------------------------------------
 
-    while (1) {
-        clear_screen();       // Clear screen every second
-        print_time(blink);    // Print time
-        blink = !blink;       // Toggle blinking colon
+// Where TZif zone files live
+#define ZONEINFO_DIR "/usr/share/zoneinfo"
+// Zones shown when none are configured
+#define DEFAULT_ZONES "America/Los_Angeles,America/New_York,America/Sao_Paulo,Europe/London," \
+                      "Europe/Berlin,Africa/Cairo,Asia/Dubai,Asia/Kolkata,Asia/Shanghai," \
+                      "Asia/Tokyo,Australia/Sydney,Pacific/Auckland"
+// Most zones the world clock will load
+#define MAX_ZONES 1024
+// Rule-based transitions are expanded up to this year
+#define ZONE_RULES_UNTIL 2100
 
-        sleep_ms(1000);       // Wait for 1 second
+// One local time type of a zone (offset from UTC, DST flag, abbreviation)
+typedef struct {
+    int utoff;          // Seconds east of UTC
+    int isDst;
+    char abbr[8];
+} ZoneType;
 
-        // Check if user pressed a key
-        if (kbhit()) {
-            key = getch();    // Get the pressed key
-            if (key == 'q' || key == 'Q')
-                break;        // Exit loop if 'q' is pressed
-            else if (key == 'h' || key == 'H')
-                is24Hour = !is24Hour;  // Toggle 12/24 hour mode
+// A zone's transitions, parsed once from its TZif file. Local time at instant t
+// is the type of the last transition at or before t (binary search).
+typedef struct {
+    char name[40];
+    long long *times;   // Transition instants (UTC seconds), ascending
+    unsigned char *typeOf;  // Type index in effect from each transition
+    int count;
+    ZoneType types[32];
+    int typeCount;
+} Zone;
+
+Zone *zones[MAX_ZONES];
+int zoneCount = 0;
+
+// Big-endian integers as stored in TZif files
+long long read_be(const unsigned char *p, int bytes) {
+    unsigned long long v = 0;
+    for (int i = 0; i < bytes; i++)
+        v = v << 8 | p[i];
+    if (bytes == 4)
+        return (int)(unsigned int)v;
+    return (long long)v;
+}
+
+// Days since 1970-01-01 for a proleptic Gregorian date
+long long days_from_civil(long long y, int m, int d) {
+    y -= m <= 2;
+    long long era = (y >= 0 ? y : y - 399) / 400;
+    long long yoe = y - era * 400;
+    long long doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    long long doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+int is_leap(long long y) {
+    return (y % 4 == 0 && y % 100 != 0) || y % 400 == 0;
+}
+
+// Parses "[+-]hh[:mm[:ss]]" from a POSIX TZ string, returning seconds
+const char *parse_tz_time(const char *p, long *seconds) {
+    int sign = 1;
+    if (*p == '+' || *p == '-')
+        sign = *p++ == '-' ? -1 : 1;
+    long h = strtol(p, (char **)&p, 10), m = 0, s = 0;
+    if (*p == ':') {
+        m = strtol(p + 1, (char **)&p, 10);
+        if (*p == ':')
+            s = strtol(p + 1, (char **)&p, 10);
+    }
+    *seconds = sign * (h * 3600 + m * 60 + s);
+    return p;
+}
+
+// Parses a zone abbreviation: letters, or anything inside <...>
+const char *parse_tz_name(const char *p, char *name, int size) {
+    int n = 0;
+    if (*p == '<') {
+        for (p++; *p && *p != '>'; p++)
+            if (n < size - 1)
+                name[n++] = *p;
+        if (*p == '>')
+            p++;
+    } else {
+        for (; (*p >= 'A' && *p <= 'Z') || (*p >= 'a' && *p <= 'z'); p++)
+            if (n < size - 1)
+                name[n++] = *p;
+    }
+    name[n] = '\0';
+    return p;
+}
+
+// A DST start or end rule from a POSIX TZ string
+typedef struct {
+    char kind;          // 'M' (month.week.day), 'J' (Julian, no Feb 29) or 'D' (zero-based day)
+    int month, week, weekday, day;
+    long time;          // Local time of day of the change, seconds
+} TzRule;
+
+const char *parse_tz_rule(const char *p, TzRule *rule) {
+    memset(rule, 0, sizeof(*rule));
+    if (*p == 'M') {
+        rule->kind = 'M';
+        rule->month = (int)strtol(p + 1, (char **)&p, 10);
+        rule->week = (int)strtol(p + 1, (char **)&p, 10);
+        rule->weekday = (int)strtol(p + 1, (char **)&p, 10);
+    } else if (*p == 'J') {
+        rule->kind = 'J';
+        rule->day = (int)strtol(p + 1, (char **)&p, 10);
+    } else {
+        rule->kind = 'D';
+        rule->day = (int)strtol(p, (char **)&p, 10);
+    }
+    rule->time = 7200;  // Default 02:00:00
+    if (*p == '/')
+        p = parse_tz_time(p + 1, &rule->time);
+    return p;
+}
+
+// Local seconds since the epoch at which a rule fires in a given year
+long long tz_rule_local_time(const TzRule *rule, int year) {
+    long long day;
+    if (rule->kind == 'M') {
+        static const int monthDays[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+        long long first = days_from_civil(year, rule->month, 1);
+        int firstWeekday = (int)((first % 7 + 11) % 7);   // 1970-01-01 was a Thursday
+        int dom = 1 + (rule->weekday - firstWeekday + 7) % 7 + 7 * (rule->week - 1);
+        int len = monthDays[rule->month - 1] + (rule->month == 2 && is_leap(year));
+        while (dom > len)
+            dom -= 7;
+        day = first + dom - 1;
+    } else if (rule->kind == 'J') {
+        day = days_from_civil(year, 1, 1) + rule->day - 1 + (is_leap(year) && rule->day >= 60);
+    } else {
+        day = days_from_civil(year, 1, 1) + rule->day;
+    }
+    return day * 86400 + rule->time;
+}
+
+// Adds a type to a zone, reusing an identical one. Returns its index.
+int zone_add_type(Zone *z, int utoff, int isDst, const char *abbr) {
+    for (int i = 0; i < z->typeCount; i++) {
+        if (z->types[i].utoff == utoff && z->types[i].isDst == isDst && strcmp(z->types[i].abbr, abbr) == 0)
+            return i;
+    }
+    if (z->typeCount == (int)(sizeof(z->types) / sizeof(z->types[0])))
+        return z->typeCount - 1;
+    ZoneType *t = &z->types[z->typeCount];
+    t->utoff = utoff;
+    t->isDst = isDst;
+    snprintf(t->abbr, sizeof(t->abbr), "%s", abbr);
+    return z->typeCount++;
+}
+
+// Appends a transition, growing the arrays as needed
+void zone_add_transition(Zone *z, long long when, int type, int *cap) {
+    if (z->count == *cap) {
+        *cap = *cap ? *cap * 2 : 64;
+        z->times = realloc(z->times, *cap * sizeof(long long));
+        z->typeOf = realloc(z->typeOf, *cap);
+    }
+    z->times[z->count] = when;
+    z->typeOf[z->count] = (unsigned char)type;
+    z->count++;
+}
+
+// Expands the TZif footer (a POSIX TZ string such as "EST5EDT,M3.2.0,M11.1.0")
+// into explicit transitions after the last one in the file
+void zone_expand_footer(Zone *z, const char *tz, int *cap) {
+    char stdName[8], dstName[8];
+    long stdOffset, dstOffset;
+    const char *p = parse_tz_name(tz, stdName, sizeof(stdName));
+    if (!stdName[0])
+        return;
+    p = parse_tz_time(p, &stdOffset);       // Seconds west of UTC
+    int stdType = zone_add_type(z, (int)-stdOffset, 0, stdName);
+
+    p = parse_tz_name(p, dstName, sizeof(dstName));
+    if (!dstName[0]) {
+        // No DST: the standard type applies from the last transition on
+        if (z->count == 0 || z->types[z->typeOf[z->count - 1]].utoff != -stdOffset)
+            zone_add_transition(z, z->count ? z->times[z->count - 1] + 1 : -(1LL << 40), stdType, cap);
+        return;
+    }
+    dstOffset = stdOffset - 3600;
+    if (*p && *p != ',')
+        p = parse_tz_time(p, &dstOffset);
+    int dstType = zone_add_type(z, (int)-dstOffset, 1, dstName);
+
+    TzRule start, end;
+    if (*p != ',')
+        return;
+    p = parse_tz_rule(p + 1, &start);
+    if (*p != ',')
+        return;
+    parse_tz_rule(p + 1, &end);
+
+    long long last = z->count ? z->times[z->count - 1] : 0;
+    int firstYear = 1970 + (int)(last / 31556952);
+    for (int year = firstYear; year <= ZONE_RULES_UNTIL; year++) {
+        long long on = tz_rule_local_time(&start, year) + stdOffset;   // Local std -> UTC
+        long long off = tz_rule_local_time(&end, year) + dstOffset;    // Local dst -> UTC
+        long long first = on < off ? on : off, second = on < off ? off : on;
+        int firstType = on < off ? dstType : stdType, secondType = on < off ? stdType : dstType;
+        if (first > last)
+            zone_add_transition(z, first, firstType, cap);
+        if (second > last)
+            zone_add_transition(z, second, secondType, cap);
+    }
+}
+
+// Reads the six TZif header counts (isutcnt, isstdcnt, leapcnt, timecnt,
+// typecnt, charcnt) as unsigned values and returns the size of the data block
+// they describe, or 0 if a count is out of range. Each entry takes at least one
+// byte, so no count can exceed the file size, and with that bound the block
+// size cannot overflow.
+size_t tzif_block(const unsigned char *h, int timeSize, size_t size, size_t cnt[6]) {
+    for (int i = 0; i < 6; i++) {
+        cnt[i] = (unsigned int)read_be(h + 20 + 4 * i, 4);
+        if (cnt[i] > size)
+            return 0;
+    }
+    if (cnt[4] < 1 || cnt[4] > 256 || cnt[5] < 1)   // Type indices are single bytes
+        return 0;
+    return cnt[3] * timeSize + cnt[3] + cnt[4] * 6 + cnt[5] + cnt[2] * (timeSize + 4) + cnt[1] + cnt[0];
+}
+
+// Loads a zone from its TZif file (RFC 8536, versions 1-4). Returns NULL on error.
+Zone *load_zone(const char *name) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s", ZONEINFO_DIR, name);
+    FILE *fp = fopen(path, "rb");
+    if (!fp)
+        return NULL;
+    static unsigned char data[1 << 17];
+    size_t size = fread(data, 1, sizeof(data), fp);
+    fclose(fp);
+    if (size < 44 || memcmp(data, "TZif", 4) != 0)
+        return NULL;
+
+    // Header counts: isutcnt, isstdcnt, leapcnt, timecnt, typecnt, charcnt
+    const unsigned char *h = data;
+    int timeSize = 4;
+    size_t cnt[6];
+    size_t block = tzif_block(h, timeSize, size, cnt);
+    if (block == 0)
+        return NULL;
+
+    // Version 2+ files repeat the data with 64-bit times: use that copy
+    if (data[4] >= '2' && 44 + block + 44 <= size) {
+        h = data + 44 + block;
+        if (memcmp(h, "TZif", 4) != 0)
+            return NULL;
+        timeSize = 8;
+        block = tzif_block(h, timeSize, size, cnt);
+        if (block == 0)
+            return NULL;
+    }
+    const unsigned char *p = h + 44;
+    if ((size_t)(p - data) + block > size)
+        return NULL;
+
+    Zone *z = calloc(1, sizeof(Zone));
+    if (!z)
+        return NULL;
+    snprintf(z->name, sizeof(z->name), "%s", name);
+    const unsigned char *times = p;
+    const unsigned char *idx = times + cnt[3] * timeSize;
+    const unsigned char *ttinfo = idx + cnt[3];
+    const char *abbrs = (const char *)(ttinfo + cnt[4] * 6);
+
+    // Types keep the file's numbering so the transition indices stay valid
+    int maxTypes = (int)(sizeof(z->types) / sizeof(z->types[0]));
+    for (int i = 0; i < (int)cnt[4] && i < maxTypes; i++) {
+        const unsigned char *tt = ttinfo + 6 * i;
+        ZoneType *t = &z->types[z->typeCount++];
+        t->utoff = (int)read_be(tt, 4);
+        t->isDst = tt[4];
+        size_t at = tt[5] < cnt[5] ? tt[5] : 0;
+        snprintf(t->abbr, sizeof(t->abbr), "%.*s", (int)(cnt[5] - at), abbrs + at);
+    }
+
+    int cap = 0;
+    for (size_t i = 0; i < cnt[3]; i++) {
+        int type = idx[i] < z->typeCount ? idx[i] : 0;
+        zone_add_transition(z, read_be(times + i * timeSize, timeSize), type, &cap);
+    }
+
+    // Footer: "\n<POSIX TZ string>\n" for versions 2+
+    if (timeSize == 8) {
+        const char *footer = (const char *)(p + block);
+        const char *end = (const char *)data + size;
+        if (footer < end && *footer == '\n') {
+            char tz[64];
+            int n = 0;
+            for (footer++; footer < end && *footer != '\n' && n < 63; footer++)
+                tz[n++] = *footer;
+            tz[n] = '\0';
+            zone_expand_footer(z, tz, &cap);
+        }
+    }
+    return z;
+}
+
+// Finds the local time type in effect at instant t by binary search over transitions
+const ZoneType *zone_type_at(const Zone *z, long long t) {
+    int lo = 0, hi = z->count - 1, found = -1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        if (z->times[mid] <= t) {
+            found = mid;
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    // Before the first transition the first type applies
+    return &z->types[found >= 0 ? z->typeOf[found] : 0];
+}
+
+// Loads a comma-separated list of zone names; "all" loads every zone in zone1970.tab
+void load_zones(const char *list) {
+    if (strcmp(list, "all") == 0) {
+        FILE *fp = fopen(ZONEINFO_DIR "/zone1970.tab", "r");
+        char line[512];
+        while (fp && fgets(line, sizeof(line), fp) && zoneCount < MAX_ZONES) {
+            char codes[64], coords[64], name[128];
+            if (line[0] == '#' || sscanf(line, "%63s %63s %127s", codes, coords, name) != 3)
+                continue;
+            Zone *z = load_zone(name);
+            if (z)
+                zones[zoneCount++] = z;
+        }
+        if (fp)
+            fclose(fp);
+        return;
+    }
+
+    char name[128];
+    while (*list && zoneCount < MAX_ZONES) {
+        size_t len = strcspn(list, ",");
+        if (len > 0 && len < sizeof(name)) {
+            memcpy(name, list, len);
+            name[len] = '\0';
+            Zone *z = load_zone(name);
+            if (z)
+                zones[zoneCount++] = z;
+        }
+        list += len + (list[len] == ',');
+    }
+}
+
+// Draws every configured zone in as many columns as fit on the screen
+void print_world_clock(const struct timespec *now) {
+    const int colWidth = 38;
+    int firstRow = 3, lastRow = screen.rows - 5;
+    int perColumn = lastRow - firstRow + 1;
+    int columns = screen.cols / colWidth;
+    if (perColumn < 1 || columns < 1)
+        return;
+
+    screen_print(1, 2, "WORLD CLOCK  (%d zones)", zoneCount);
+    if (zoneCount == 0) {
+        screen_print(firstRow, 2, "No zones loaded from %s", ZONEINFO_DIR);
+        return;
+    }
+
+    int shown = perColumn * columns < zoneCount ? perColumn * columns : zoneCount;
+    char line[64];
+    for (int i = 0; i < shown; i++) {
+        const Zone *z = zones[i];
+        const ZoneType *type = zone_type_at(z, now->tv_sec);
+        long long local = now->tv_sec + type->utoff;
+        int secOfDay = (int)(((local % 86400) + 86400) % 86400);
+        int hour = secOfDay / 3600, min = secOfDay / 60 % 60, sec = secOfDay % 60;
+        const char *ampm = "";
+        if (!is24Hour) {
+            ampm = hour >= 12 ? "PM" : "AM";
+            hour = hour % 12 == 0 ? 12 : hour % 12;
+        }
+
+        // Zone name, time and abbreviation, formatted by hand
+        memset(line, ' ', colWidth);
+        int n = (int)strlen(z->name);
+        memcpy(line, z->name, n > 20 ? 20 : n);
+        char *t = line + 21;
+        t[0] = '0' + hour / 10; t[1] = '0' + hour % 10; t[2] = ':';
+        t[3] = '0' + min / 10;  t[4] = '0' + min % 10;  t[5] = ':';
+        t[6] = '0' + sec / 10;  t[7] = '0' + sec % 10;
+        memcpy(t + 9, ampm, strlen(ampm));
+        n = (int)strlen(type->abbr);
+        memcpy(t + (is24Hour ? 9 : 12), type->abbr, n > 5 ? 5 : n);
+
+        screen_blit(firstRow + i % perColumn, 2 + (i / perColumn) * colWidth, line, colWidth - 2);
+    }
+    if (shown < zoneCount)
+        screen_print(lastRow + 1, 2, "... and %d more zones", zoneCount - shown);
+}
+
+// Compares table lookups with setenv("TZ") + localtime_r for every zone of every frame
+int run_zone_benchmark(int count, int frames) {
+#ifdef _WIN32
+    (void)count;
+    (void)frames;
+    printf("The zone benchmark needs %s.\n", ZONEINFO_DIR);
+    return 1;
+#else
+    struct timespec start, end;
+    get_monotonic(&start);
+    load_zones("all");
+    get_monotonic(&end);
+    if (zoneCount == 0) {
+        printf("No zones found in %s\n", ZONEINFO_DIR);
+        return 1;
+    }
+    printf("Loaded %d zones in %.1f ms\n", zoneCount, elapsed_ns(&start, &end) / 1e6);
+
+    // Cycle through the loaded zones to reach the requested count
+    for (int i = zoneCount; i < count && i < MAX_ZONES; i++)
+        zones[i] = zones[i % zoneCount];
+    int loaded = zoneCount;
+    zoneCount = count < MAX_ZONES ? count : MAX_ZONES;
+
+    time_t base = time(NULL);
+    int libcFrames = frames < 200 ? frames : 200;   // The libc path is far slower
+    long tableSum = 0, libcSum = 0;
+    get_monotonic(&start);
+    for (int f = 0; f < frames; f++) {
+        for (int i = 0; i < zoneCount; i++)
+            tableSum += zone_type_at(zones[i], base + f)->utoff;
+        if (f == libcFrames - 1)
+            libcSum = tableSum;     // Checked against the libc path below
+    }
+    get_monotonic(&end);
+    double tableNs = (double)elapsed_ns(&start, &end) / frames / zoneCount;
+
+    char *savedTz = getenv("TZ") ? strdup(getenv("TZ")) : NULL;
+    get_monotonic(&start);
+    for (int f = 0; f < libcFrames; f++) {
+        for (int i = 0; i < zoneCount; i++) {
+            struct tm tmv;
+            time_t t = base + f;
+            setenv("TZ", zones[i]->name, 1);
+            tzset();
+            localtime_r(&t, &tmv);
+            libcSum -= tmv.tm_gmtoff;
+        }
+    }
+    get_monotonic(&end);
+    double libcNs = (double)elapsed_ns(&start, &end) / libcFrames / zoneCount;
+    if (savedTz) {
+        setenv("TZ", savedTz, 1);
+        free(savedTz);
+    } else {
+        unsetenv("TZ");
+    }
+    tzset();
+
+    printf("Zones per frame      : %d (%d distinct)\n", zoneCount, loaded < zoneCount ? loaded : zoneCount);
+    printf("Transition table     : %8.1f ns/zone, %10.0f frames/s\n", tableNs, 1e9 / (tableNs * zoneCount));
+    printf("setenv + localtime_r : %8.1f ns/zone, %10.0f frames/s\n", libcNs, 1e9 / (libcNs * zoneCount));
+    printf("UTC offsets          : %s\n", libcSum == 0 ? "identical" : "DIFFERENT");
+    printf("Offset checksum      : %ld\n", tableSum);
+    return 0;
+#endif
+}
+
+// ---------------------------------------------------------------------------
+// Stopwatch, lap timer and countdowns
+// ---------------------------------------------------------------------------
+
+// Hierarchical timer wheel with 1 ms resolution: WHEEL_LEVELS levels of
+// WHEEL_SIZE slots, each level WHEEL_SIZE times coarser than the one below.
+// Adding and cancelling are O(1); timers in a coarse slot are moved down a
+// level when the finer level wraps around, so each tick only looks at one slot.
+#define WHEEL_BITS 6
+#define WHEEL_SIZE (1 << WHEEL_BITS)
+#define WHEEL_LEVELS 5   // 2^30 ms (about 12 days) before timers are re-queued
+#define WHEEL_NONE -1
+
+typedef struct {
+    long long expires;  // Absolute expiry, ms on the wheel's clock
+    int next, prev;     // Links within a slot (or the free list)
+    int slot;           // Slot index (level * WHEEL_SIZE + i), or WHEEL_NONE if idle
+} WheelTimer;
+
+typedef struct {
+    WheelTimer *timers;
+    int capacity;
+    int freeList;
+    int pending;
+    long long now;      // Next millisecond to be processed
+    int slots[WHEEL_LEVELS * WHEEL_SIZE];
+} TimerWheel;
+
+// Called for every timer that expires, with its handle
+typedef void (*TimerCallback)(int handle, long long expires, void *ctx);
+
+// Creates a wheel for up to `capacity` timers, starting at `nowMs`
+void wheel_init(TimerWheel *w, int capacity, long long nowMs) {
+    w->timers = malloc(capacity * sizeof(WheelTimer));
+    w->capacity = capacity;
+    w->pending = 0;
+    w->now = nowMs;
+    for (int i = 0; i < WHEEL_LEVELS * WHEEL_SIZE; i++)
+        w->slots[i] = WHEEL_NONE;
+    for (int i = 0; i < capacity; i++) {
+        w->timers[i].next = i + 1 < capacity ? i + 1 : WHEEL_NONE;
+        w->timers[i].slot = WHEEL_NONE;
+    }
+    w->freeList = capacity > 0 ? 0 : WHEEL_NONE;
+}
+
+void wheel_free(TimerWheel *w) {
+    free(w->timers);
+    w->timers = NULL;
+    w->capacity = 0;
+}
+
+// Links a timer into the slot matching its distance from `now`
+void wheel_place(TimerWheel *w, int handle) {
+    WheelTimer *t = &w->timers[handle];
+    long long expires = t->expires < w->now ? w->now : t->expires;
+    long long delta = expires - w->now;
+    int level = 0;
+    while (level < WHEEL_LEVELS - 1 && delta >= 1LL << (WHEEL_BITS * (level + 1)))
+        level++;
+    if (delta >= 1LL << (WHEEL_BITS * WHEEL_LEVELS))
+        expires = w->now + (1LL << (WHEEL_BITS * WHEEL_LEVELS)) - 1;   // Re-queued when it comes round
+
+    int slot = level * WHEEL_SIZE + (int)((expires >> (WHEEL_BITS * level)) & (WHEEL_SIZE - 1));
+    t->slot = slot;
+    t->prev = WHEEL_NONE;
+    t->next = w->slots[slot];
+    if (t->next != WHEEL_NONE)
+        w->timers[t->next].prev = handle;
+    w->slots[slot] = handle;
+}
+
+// Removes a timer from its slot list
+void wheel_unlink(TimerWheel *w, int handle) {
+    WheelTimer *t = &w->timers[handle];
+    if (t->prev != WHEEL_NONE)
+        w->timers[t->prev].next = t->next;
+    else
+        w->slots[t->slot] = t->next;
+    if (t->next != WHEEL_NONE)
+        w->timers[t->next].prev = t->prev;
+    t->slot = WHEEL_NONE;
+}
+
+// Schedules a timer at `expiresMs`; returns its handle, or WHEEL_NONE when the wheel is full
+int wheel_add(TimerWheel *w, long long expiresMs) {
+    int handle = w->freeList;
+    if (handle == WHEEL_NONE)
+        return WHEEL_NONE;
+    w->freeList = w->timers[handle].next;
+    w->timers[handle].expires = expiresMs;
+    wheel_place(w, handle);
+    w->pending++;
+    return handle;
+}
+
+// Returns a handle to the free list
+void wheel_release(TimerWheel *w, int handle) {
+    w->timers[handle].next = w->freeList;
+    w->freeList = handle;
+    w->pending--;
+}
+
+// Cancels a pending timer; returns 0 if it was not pending
+int wheel_cancel(TimerWheel *w, int handle) {
+    if (handle < 0 || handle >= w->capacity || w->timers[handle].slot == WHEEL_NONE)
+        return 0;
+    wheel_unlink(w, handle);
+    wheel_release(w, handle);
+    return 1;
+}
+
+// Processes every millisecond up to and including `nowMs`, firing expired timers
+void wheel_advance(TimerWheel *w, long long nowMs, TimerCallback fire, void *ctx) {
+    while (w->now <= nowMs) {
+        if (w->pending == 0) {
+            w->now = nowMs + 1;     // Nothing to fire: skip ahead
+            return;
+        }
+        int index = (int)(w->now & (WHEEL_SIZE - 1));
+
+        // When a level wraps, move the next slot of the level above down
+        for (int level = 1; level < WHEEL_LEVELS && index == 0; level++) {
+            index = (int)((w->now >> (WHEEL_BITS * level)) & (WHEEL_SIZE - 1));
+            int slot = level * WHEEL_SIZE + index;
+            int handle = w->slots[slot];
+            w->slots[slot] = WHEEL_NONE;
+            while (handle != WHEEL_NONE) {
+                int next = w->timers[handle].next;
+                wheel_place(w, handle);
+                handle = next;
+            }
+        }
+
+        int slot = (int)(w->now & (WHEEL_SIZE - 1));
+        int handle = w->slots[slot];
+        while (handle != WHEEL_NONE) {
+            int next = w->timers[handle].next;
+            WheelTimer *t = &w->timers[handle];
+            if (t->expires <= w->now) {
+                wheel_unlink(w, handle);
+                wheel_release(w, handle);
+                fire(handle, t->expires, ctx);
+            }
+            handle = next;
+        }
+        w->now++;
+    }
+}
+
+// Laps kept for display and export: the most recent LAP_CAPACITY, in a ring
+#define LAP_CAPACITY 1024
+#define LAP_FILE "laps.csv"
+
+typedef struct {
+    long long splitNs;  // Time since the previous lap
+    long long totalNs;  // Time since the stopwatch started
+} Lap;
+
+// Stopwatch state; elapsed time is accumulated across start/stop
+struct {
+    int running;
+    long long startNs;      // Monotonic time of the last start
+    long long accumulatedNs;
+    long long lastLapNs;    // Total at the previous lap
+    Lap laps[LAP_CAPACITY];
+    int lapCount;           // Laps recorded since the last reset (may exceed LAP_CAPACITY)
+} stopwatch;
+
+long long stopwatch_elapsed(long long nowNs) {
+    return stopwatch.accumulatedNs + (stopwatch.running ? nowNs - stopwatch.startNs : 0);
+}
+
+void stopwatch_toggle(long long nowNs) {
+    if (stopwatch.running)
+        stopwatch.accumulatedNs += nowNs - stopwatch.startNs;
+    else
+        stopwatch.startNs = nowNs;
+    stopwatch.running = !stopwatch.running;
+}
+
+void stopwatch_lap(long long nowNs) {
+    long long total = stopwatch_elapsed(nowNs);
+    Lap *lap = &stopwatch.laps[stopwatch.lapCount % LAP_CAPACITY];
+    lap->totalNs = total;
+    lap->splitNs = total - stopwatch.lastLapNs;
+    stopwatch.lastLapNs = total;
+    stopwatch.lapCount++;
+}
+
+void stopwatch_reset() {
+    stopwatch.running = 0;
+    stopwatch.accumulatedNs = 0;
+    stopwatch.lastLapNs = 0;
+    stopwatch.lapCount = 0;
+}
+
+// Writes the laps still in the ring to LAP_FILE as CSV (one write)
+int export_laps(const char *path) {
+    int first = stopwatch.lapCount > LAP_CAPACITY ? stopwatch.lapCount - LAP_CAPACITY : 0;
+    size_t size = 32 + (size_t)(stopwatch.lapCount - first) * 64;
+    char *buf = malloc(size);
+    size_t len = snprintf(buf, size, "lap,split_ms,total_ms\n");
+    for (int i = first; i < stopwatch.lapCount; i++) {
+        const Lap *lap = &stopwatch.laps[i % LAP_CAPACITY];
+        len += snprintf(buf + len, size - len, "%d,%.3f,%.3f\n",
+            i + 1, lap->splitNs / 1e6, lap->totalNs / 1e6);
+    }
+
+    FILE *fp = fopen(path, "w");
+    int ok = fp && fwrite(buf, 1, len, fp) == len;
+    if (fp)
+        ok = fclose(fp) == 0 && ok;
+    free(buf);
+    return ok ? stopwatch.lapCount - first : -1;
+}
+
+// Countdowns shown in the countdown view; all of them expire through the timer wheel
+#define MAX_COUNTDOWNS 8
+
+typedef struct {
+    int handle;             // Wheel handle, or WHEEL_NONE once fired or cancelled
+    long long durationMs;
+    long long endMs;        // Monotonic ms at which it fires
+    int fired;
+} Countdown;
+
+Countdown countdowns[MAX_COUNTDOWNS];
+int countdownCount = 0;
+long long countdownSetting = 5 * 60 * 1000;   // Duration of the next countdown (ms)
+TimerWheel wheel;
+char statusLine[80] = "";   // Last timer message (laps exported, countdown done)
+
+// Wheel callback for the countdown view
+void countdown_fired(int handle, long long expires, void *ctx) {
+    (void)expires;
+    (void)ctx;
+    for (int i = 0; i < countdownCount; i++) {
+        if (countdowns[i].handle == handle) {
+            countdowns[i].handle = WHEEL_NONE;
+            countdowns[i].fired = 1;
+            snprintf(statusLine, sizeof(statusLine), "Countdown %d finished!", i + 1);
+            write_out("\a", 1);     // Terminal bell
+        }
+    }
+}
+
+// Starts a countdown of the current setting, replacing the oldest finished one when full
+void countdown_start(long long nowMs) {
+    int i = countdownCount;
+    if (i == MAX_COUNTDOWNS) {
+        for (i = 0; i < MAX_COUNTDOWNS && countdowns[i].handle != WHEEL_NONE; i++)
+            ;
+        if (i == MAX_COUNTDOWNS)
+            return;
+        memmove(&countdowns[i], &countdowns[i + 1], (MAX_COUNTDOWNS - i - 1) * sizeof(Countdown));
+        i = MAX_COUNTDOWNS - 1;
+    } else {
+        countdownCount++;
+    }
+    countdowns[i].durationMs = countdownSetting;
+    countdowns[i].endMs = nowMs + countdownSetting;
+    countdowns[i].fired = 0;
+    countdowns[i].handle = wheel_add(&wheel, countdowns[i].endMs);
+}
+
+void countdown_reset() {
+    for (int i = 0; i < countdownCount; i++)
+        wheel_cancel(&wheel, countdowns[i].handle);
+    countdownCount = 0;
+}
+
+// Formats a duration as [h:]mm:ss.t
+void format_duration(char *out, size_t size, long long ns) {
+    long long tenths = ns / (NS_PER_SEC / 10);
+    long long secs = tenths / 10;
+    if (secs >= 3600)
+        snprintf(out, size, "%lld:%02lld:%02lld.%lld", secs / 3600, secs / 60 % 60, secs % 60, tenths % 10);
+    else
+        snprintf(out, size, "%02lld:%02lld.%lld", secs / 60, secs % 60, tenths % 10);
+}
+
+// Stopwatch elapsed time in large digits with the most recent laps below
+void print_stopwatch(long long nowNs) {
+    char text[24];
+    format_duration(text, sizeof(text), stopwatch_elapsed(nowNs));
+    screen_print(1, 8, "STOPWATCH  %s", stopwatch.running ? "(running)" : "(stopped)");
+    draw_big_text(3, 8, text);
+
+    int rows = screen.rows - 14;
+    int shown = stopwatch.lapCount < rows ? stopwatch.lapCount : rows;
+    if (shown > LAP_CAPACITY)
+        shown = LAP_CAPACITY;
+    for (int i = 0; i < shown; i++) {
+        int n = stopwatch.lapCount - 1 - i;
+        const Lap *lap = &stopwatch.laps[n % LAP_CAPACITY];
+        char split[24], total[24];
+        format_duration(split, sizeof(split), lap->splitNs);
+        format_duration(total, sizeof(total), lap->totalNs);
+        screen_print(9 + i, 8, "Lap %4d   %12s   %12s", n + 1, split, total);
+    }
+    screen_print(screen.rows - 4, 8, "%s", statusLine);
+    screen_print(screen.rows - 3, 8, "[Space] Start/Stop  [L] Lap  [R] Reset  [E] Export CSV  [S] Back  [Q] Quit");
+}
+
+// Countdown setting and every running or finished countdown
+void print_countdowns(long long nowNs) {
+    char text[24];
+    format_duration(text, sizeof(text), countdownSetting * 1000000LL);
+    screen_print(1, 8, "COUNTDOWN  (next: %s)", text);
+
+    long long nowMs = nowNs / 1000000;
+    if (countdownCount == 0)
+        draw_big_text(3, 8, text);
+    for (int i = 0; i < countdownCount; i++) {
+        const Countdown *c = &countdowns[i];
+        long long left = c->endMs > nowMs ? c->endMs - nowMs : 0;
+        format_duration(text, sizeof(text), left * 1000000LL);
+        if (i == countdownCount - 1) {
+            draw_big_text(3, 8, text);
+            continue;
+        }
+        screen_print(9 + i, 8, "#%d  %12s  %s", i + 1, text, c->fired ? "done" : "");
+    }
+    screen_print(screen.rows - 4, 8, "%s", statusLine);
+    screen_print(screen.rows - 3, 8, "[+/-] 1 min  [Space] Start  [R] Reset  [C] Back  [Q] Quit");
+}
+
+// Accuracy test: schedules `count` timers over `seconds`, drives the wheel from
+// the monotonic clock and reports how late they fired (none may fire early)
+struct TimerTest {
+    long long *expires;     // Expected expiry per handle (ms), or -1 if cancelled
+    long long fired, early, wrong;
+    long *lateness;         // Lateness samples (ns)
+    long long startNs;
+};
+
+void timer_test_fired(int handle, long long expires, void *ctx) {
+    struct TimerTest *test = ctx;
+    if (test->expires[handle] != expires)
+        test->wrong++;      // Cancelled or unknown timer fired
+    long long late = monotonic_ns() - test->startNs - expires * 1000000LL;
+    if (late < 0)
+        test->early++;
+    test->lateness[test->fired++] = (long)late;
+    test->expires[handle] = -1;
+}
+
+int run_timer_test(int count, int seconds) {
+    TimerWheel w;
+    struct TimerTest test = {0};
+    test.expires = malloc(count * sizeof(long long));
+    test.lateness = malloc(count * sizeof(long));
+    test.startNs = monotonic_ns();
+    wheel_init(&w, count, 0);   // The wheel's clock is ms since the test started
+
+    // Random expiry times, then cancel every tenth timer
+    srand(12345);
+    long long spanMs = (long long)seconds * 1000;
+    long long start = monotonic_ns();
+    for (int i = 0; i < count; i++) {
+        long long when = 1 + ((long long)rand() * (RAND_MAX + 1LL) + rand()) % spanMs;
+        int handle = wheel_add(&w, when);
+        test.expires[handle] = when;
+    }
+    double addNs = (double)(monotonic_ns() - start) / count;
+    int cancelled = 0;
+    start = monotonic_ns();
+    for (int i = 0; i < count; i += 10) {
+        cancelled += wheel_cancel(&w, i);
+        test.expires[i] = -1;
+    }
+    double cancelNs = cancelled ? (double)(monotonic_ns() - start) / cancelled : 0;
+
+    // Drive the wheel in real time, 1 ms per step
+    long long busyNs = 0, steps = 0;
+    while (w.pending > 0) {
+        sleep_ms(1);
+        long long t0 = monotonic_ns();
+        wheel_advance(&w, (t0 - test.startNs) / 1000000, timer_test_fired, &test);
+        busyNs += monotonic_ns() - t0;
+        steps++;
+    }
+
+    int expected = count - cancelled;
+    qsort(test.lateness, test.fired, sizeof(long), compare_samples);
+    printf("Timers: %d scheduled over %d s, %d cancelled\n", count, seconds, cancelled);
+    printf("Add %.1f ns, cancel %.1f ns, advance %.1f us per step (%lld steps)\n",
+        addNs, cancelNs, steps ? busyNs / 1e3 / steps : 0.0, steps);
+    printf("Fired %lld of %d (early %lld, cancelled or duplicate %lld)\n",
+        test.fired, expected, test.early, test.wrong);
+    if (test.fired > 0) {
+        printf("Lateness: p50 %.3f ms, p99 %.3f ms, max %.3f ms\n",
+            test.lateness[test.fired / 2] / 1e6, test.lateness[test.fired * 99 / 100] / 1e6,
+            test.lateness[test.fired - 1] / 1e6);
+    }
+    int ok = test.fired == expected && test.early == 0 && test.wrong == 0;
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    free(test.expires);
+    free(test.lateness);
+    wheel_free(&w);
+    return ok ? 0 : 1;
+}
+
+// ---------------------------------------------------------------------------
+// Headless tick publisher
+// ---------------------------------------------------------------------------
+
+// Headless mode publishes every tick into a shared-memory ring that any number
+// of subscriber processes map read-only. Subscribers read events with plain
+// loads (a per-slot sequence number acts as a seqlock), so receiving costs no
+// system calls; they only enter the kernel to sleep on a futex when they have
+// caught up, and the publisher wakes them with a single FUTEX_WAKE. The ring
+// records the publisher's pid: a new publisher only replaces a ring whose
+// publisher is gone, and sleeping subscribers wake up now and then to notice
+// a publisher that died without saying so.
+#define TICK_SHM_NAME "/digital-clock-ticks"
+#define TICK_RING_SIZE 256          // Events kept; slower subscribers skip ahead
+#define TICK_MAGIC 0x4b434954u      // "TICK"
+#define TICK_WAIT_MS 1000           // Longest futex sleep between publisher checks
+
+// One published tick
+typedef struct {
+    unsigned long long seq;         // 1, 2, 3, ...
+    long long realtimeNs;           // Wall-clock time of the tick
+    long long publishedNs;          // Monotonic time it was published (for latency)
+    char text[12];                  // Local time as "HH:MM:SS"
+} TickEvent;
+
+#ifdef __linux__
+#include <stdatomic.h>
+#include <stdint.h>
+#include <fcntl.h>          // For O_CREAT, O_RDWR
+#include <signal.h>         // For stopping the publisher cleanly
+#include <pthread.h>        // For the fan-out benchmark's subscriber threads
+#include <sys/mman.h>       // For shm_open, mmap
+#include <sys/resource.h>   // For getrusage
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <errno.h>          // For EEXIST, EBUSY, ETIMEDOUT
+
+typedef struct {
+    atomic_ullong version;          // 2*seq-1 while being written, 2*seq once complete
+    TickEvent event;
+} TickSlot;
+
+typedef struct {
+    unsigned int magic;
+    unsigned int size;
+    atomic_int publisher;           // Pid of the publisher, 0 once it has stopped
+    atomic_ullong head;             // Sequence number of the latest complete event
+    atomic_uint wakeWord;           // Futex word, bumped on every publish
+    atomic_uint waiters;            // Subscribers sleeping on wakeWord
+    TickSlot slots[TICK_RING_SIZE];
+} TickRing;
+
+long futex(atomic_uint *word, int op, unsigned int value, const struct timespec *timeout) {
+    return syscall(SYS_futex, (uint32_t *)word, op, value, timeout, NULL, 0);
+}
+
+// Whether the process that publishes into the ring is still running
+int tick_publisher_alive(const TickRing *ring) {
+    int pid = atomic_load_explicit(&ring->publisher, memory_order_acquire);
+    return pid > 0 && (kill(pid, 0) == 0 || errno == EPERM);
+}
+
+// Writes the next event into the ring and wakes sleeping subscribers
+void tick_publish(TickRing *ring, const struct timespec *now) {
+    unsigned long long seq = atomic_load_explicit(&ring->head, memory_order_relaxed) + 1;
+    TickSlot *slot = &ring->slots[seq % TICK_RING_SIZE];
+
+    atomic_store_explicit(&slot->version, 2 * seq - 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    const struct tm *t = current_tm(now);
+    slot->event.seq = seq;
+    slot->event.realtimeNs = (long long)now->tv_sec * NS_PER_SEC + now->tv_nsec;
+    snprintf(slot->event.text, sizeof(slot->event.text), "%02d:%02d:%02d", t->tm_hour, t->tm_min, t->tm_sec);
+    slot->event.publishedNs = monotonic_ns();
+    atomic_store_explicit(&slot->version, 2 * seq, memory_order_release);
+    atomic_store_explicit(&ring->head, seq, memory_order_release);
+
+    atomic_fetch_add_explicit(&ring->wakeWord, 1, memory_order_release);
+    if (atomic_load_explicit(&ring->waiters, memory_order_acquire) > 0)
+        futex(&ring->wakeWord, FUTEX_WAKE, INT32_MAX, NULL);
+}
+
+// Marks the ring as abandoned and wakes every subscriber so they notice
+void tick_stop(TickRing *ring) {
+    atomic_store_explicit(&ring->publisher, 0, memory_order_release);
+    atomic_fetch_add_explicit(&ring->wakeWord, 1, memory_order_release);
+    futex(&ring->wakeWord, FUTEX_WAKE, INT32_MAX, NULL);
+}
+
+// Reads event `seq` if it is still in the ring. Returns 1 on success, 0 if it
+// has not been published yet and -1 if it was already overwritten.
+int tick_read(const TickRing *ring, unsigned long long seq, TickEvent *out) {
+    const TickSlot *slot = &ring->slots[seq % TICK_RING_SIZE];
+    while (1) {
+        unsigned long long before = atomic_load_explicit(&slot->version, memory_order_acquire);
+        if (before < 2 * seq)
+            return 0;
+        if (before > 2 * seq)
+            return -1;
+        *out = slot->event;
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&slot->version, memory_order_relaxed) == before)
+            return 1;
+    }
+}
+
+// Waits for the next event after `*next - 1`, skipping anything the ring no
+// longer holds (added to *skipped). Returns 1 with the event in `out`, or 0
+// once the publisher has stopped or died and every event has been read.
+int tick_next(TickRing *ring, unsigned long long *next, TickEvent *out, unsigned long long *skipped) {
+    while (1) {
+        unsigned int word = atomic_load_explicit(&ring->wakeWord, memory_order_acquire);
+        int got = tick_read(ring, *next, out);
+        if (got > 0) {
+            (*next)++;
+            return 1;
+        }
+        if (got < 0) {
+            // Lagged behind the ring: continue from the oldest event still held
+            unsigned long long head = atomic_load_explicit(&ring->head, memory_order_acquire);
+            unsigned long long oldest = head > TICK_RING_SIZE - 1 ? head - (TICK_RING_SIZE - 1) : 1;
+            *skipped += oldest - *next;
+            *next = oldest;
+            continue;
+        }
+        if (atomic_load_explicit(&ring->publisher, memory_order_acquire) == 0)
+            return 0;
+
+        // Caught up: sleep until the publisher bumps the futex word, or for
+        // TICK_WAIT_MS to check that the publisher still exists
+        struct timespec timeout = {TICK_WAIT_MS / 1000, TICK_WAIT_MS % 1000 * 1000000L};
+        long woken = 0;
+        atomic_fetch_add_explicit(&ring->waiters, 1, memory_order_acq_rel);
+        if (atomic_load_explicit(&ring->head, memory_order_acquire) < *next)
+            woken = futex(&ring->wakeWord, FUTEX_WAIT, word, &timeout);
+        atomic_fetch_sub_explicit(&ring->waiters, 1, memory_order_release);
+        if (woken < 0 && errno == ETIMEDOUT && !tick_publisher_alive(ring))
+            return 0;
+    }
+}
+
+// Maps the shared ring of a running publisher, or returns NULL
+TickRing *tick_ring_open() {
+    int fd = shm_open(TICK_SHM_NAME, O_RDWR, 0644);
+    if (fd < 0)
+        return NULL;
+    TickRing *ring = mmap(NULL, sizeof(TickRing), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ring == MAP_FAILED)
+        return NULL;
+    if (ring->magic != TICK_MAGIC || ring->size != TICK_RING_SIZE) {
+        munmap(ring, sizeof(TickRing));
+        return NULL;
+    }
+    return ring;
+}
+
+// Creates the ring for this process to publish into. A ring left behind by a
+// publisher that died is replaced; if its publisher is still running, returns
+// NULL with errno set to EBUSY.
+TickRing *tick_ring_create() {
+    for (int attempt = 0; attempt < 3; attempt++) {
+        int fd = shm_open(TICK_SHM_NAME, O_CREAT | O_EXCL | O_RDWR, 0644);
+        if (fd >= 0) {
+            TickRing *ring = ftruncate(fd, sizeof(TickRing)) == 0
+                ? mmap(NULL, sizeof(TickRing), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+            close(fd);
+            if (ring == MAP_FAILED) {
+                shm_unlink(TICK_SHM_NAME);
+                return NULL;
+            }
+            ring->size = TICK_RING_SIZE;    // A new object is zero-filled
+            atomic_store(&ring->publisher, (int)getpid());
+            ring->magic = TICK_MAGIC;
+            return ring;
+        }
+        if (errno != EEXIST)
+            return NULL;
+
+        TickRing *old = tick_ring_open();
+        int alive = old && tick_publisher_alive(old);
+        if (old)
+            munmap(old, sizeof(TickRing));
+        if (alive) {
+            errno = EBUSY;
+            return NULL;
+        }
+        if (!old && attempt == 0) {
+            sleep_ms(10);   // Perhaps another publisher is setting it up right now
+            continue;
+        }
+        shm_unlink(TICK_SHM_NAME);
+    }
+    errno = EBUSY;
+    return NULL;
+}
+
+// Reports why the publisher's ring could not be created
+void tick_ring_error() {
+    if (errno == EBUSY)
+        printf("Another clock is already publishing on %s\n", TICK_SHM_NAME);
+    else
+        perror("shm_open " TICK_SHM_NAME);
+}
+
+static volatile sig_atomic_t publisherStop = 0;
+
+void publisher_signal(int sig) {
+    (void)sig;
+    publisherStop = 1;
+}
+
+// --headless [interval_ms]: publishes ticks until interrupted or 'q' is typed
+int run_headless(long intervalMs) {
+    TickRing *ring = tick_ring_create();
+    if (!ring) {
+        tick_ring_error();
+        return 1;
+    }
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = publisher_signal;   // No SA_RESTART: poll returns on the signal
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    printf("Publishing ticks every %ld ms on shared memory %s (Ctrl+C to stop)\n", intervalMs, TICK_SHM_NAME);
+    fflush(stdout);
+    timer_start(intervalMs * 1000000L);
+    while (!publisherStop) {
+        struct pollfd fds[2] = {{tickFd, POLLIN, 0}, {STDIN_FILENO, POLLIN, 0}};
+        if (poll(fds, stdinOpen ? 2 : 1, -1) < 0)
+            continue;       // Interrupted: check publisherStop
+        if (fds[0].revents & POLLIN) {
+            unsigned long long expirations;
+            if (read(tickFd, &expirations, sizeof(expirations)) > 0) {
+                struct timespec now;
+                get_realtime(&now);
+                tick_publish(ring, &now);
+            }
+        }
+        if (stdinOpen && (fds[1].revents & (POLLIN | POLLHUP))) {
+            int key = read_key();
+            if (key == 'q' || key == 'Q')
+                break;
+        }
+    }
+
+    printf("Published %llu ticks\n", (unsigned long long)atomic_load(&ring->head));
+    tick_stop(ring);
+    munmap(ring, sizeof(TickRing));
+    shm_unlink(TICK_SHM_NAME);
+    return 0;
+}
+
+// --subscribe: prints every tick published by a running --headless clock. When
+// the publisher goes away it follows a restarted one, or exits.
+int run_subscriber() {
+    TickRing *ring = tick_ring_open();
+    if (!ring || !tick_publisher_alive(ring)) {
+        printf("No clock is publishing on %s (start one with --headless)\n", TICK_SHM_NAME);
+        return 1;
+    }
+    unsigned long long next = atomic_load(&ring->head) + 1;
+    TickEvent event;
+    while (1) {
+        unsigned long long skipped = 0;
+        if (!tick_next(ring, &next, &event, &skipped)) {
+            munmap(ring, sizeof(TickRing));
+            ring = tick_ring_open();
+            if (!ring || !tick_publisher_alive(ring)) {
+                printf("The clock stopped publishing\n");
+                if (ring)
+                    munmap(ring, sizeof(TickRing));
+                return 0;
+            }
+            printf("Following a restarted clock\n");
+            next = atomic_load(&ring->head) + 1;
+            continue;
+        }
+        long long latency = monotonic_ns() - event.publishedNs;
+        printf("%s  #%llu  latency %.1f us%s\n", event.text, event.seq, latency / 1e3,
+            skipped ? "  (skipped some)" : "");
+        fflush(stdout);
+    }
+}
+
+// Fan-out benchmark: one publisher thread, `subscribers` subscriber threads
+typedef struct {
+    TickRing *ring;
+    int ticks;
+    long *latency;          // Latency of each received tick (ns)
+    int received;
+    unsigned long long skipped;
+} FanoutSubscriber;
+
+void *fanout_subscriber(void *arg) {
+    FanoutSubscriber *sub = arg;
+    unsigned long long next = 1;
+    TickEvent event;
+    while (next <= (unsigned long long)sub->ticks) {
+        if (!tick_next(sub->ring, &next, &event, &sub->skipped))
+            break;
+        sub->latency[sub->received++] = (long)(monotonic_ns() - event.publishedNs);
+    }
+    return NULL;
+}
+
+double cpu_seconds() {
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_utime.tv_sec + ru.ru_stime.tv_sec + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+}
+
+// Every subscriber that is asleep when a tick is published has to be woken by
+// the kernel inside the publisher's FUTEX_WAKE, so the publish cost reported
+// grows with the number of sleeping subscribers
+int run_fanout_benchmark(int subscribers, int ticks, long intervalUs) {
+    FanoutSubscriber *subs = calloc(subscribers, sizeof(FanoutSubscriber));
+    pthread_t *threads = malloc(subscribers * sizeof(pthread_t));
+    long *latency = malloc((size_t)subscribers * ticks * sizeof(long));
+    if (!subs || !threads || !latency) {
+        printf("Not enough memory for %d subscribers and %d ticks\n", subscribers, ticks);
+        free(latency);
+        free(threads);
+        free(subs);
+        return 1;
+    }
+    TickRing *ring = tick_ring_create();
+    if (!ring) {
+        tick_ring_error();
+        free(latency);
+        free(threads);
+        free(subs);
+        return 1;
+    }
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, 64 * 1024);
+    int started = 0;
+    for (int i = 0; i < subscribers; i++) {
+        subs[i].ring = ring;
+        subs[i].ticks = ticks;
+        subs[i].latency = latency + (size_t)i * ticks;
+        if (pthread_create(&threads[i], &attr, fanout_subscriber, &subs[i]) != 0)
+            break;
+        started++;
+    }
+    pthread_attr_destroy(&attr);
+    if (started < subscribers)
+        printf("Warning: only %d of %d subscriber threads started\n", started, subscribers);
+    // Let every subscriber reach its first wait
+    while (atomic_load(&ring->waiters) < (unsigned int)started)
+        sleep_ms(1);
+
+    double cpuBefore = cpu_seconds();
+    long long start = monotonic_ns(), publishNs = 0;
+    struct timespec now;
+    for (int i = 0; i < ticks; i++) {
+        long long deadline = start + (long long)(i + 1) * intervalUs * 1000;
+        while (monotonic_ns() < deadline)
+            usleep(50);
+        get_realtime(&now);
+        long long t0 = monotonic_ns();
+        tick_publish(ring, &now);
+        publishNs += monotonic_ns() - t0;
+    }
+    for (int i = 0; i < started; i++)
+        pthread_join(threads[i], NULL);
+    long long wall = monotonic_ns() - start;
+    double cpu = cpu_seconds() - cpuBefore;
+
+    // Percentiles over every delivery
+    long total = 0;
+    unsigned long long skipped = 0;
+    for (int i = 0; i < started; i++) {
+        memmove(latency + total, subs[i].latency, subs[i].received * sizeof(long));
+        total += subs[i].received;
+        skipped += subs[i].skipped;
+    }
+    qsort(latency, total, sizeof(long), compare_samples);
+    printf("Subscribers %d, ticks %d every %ld us, ring %d events\n", started, ticks, intervalUs, TICK_RING_SIZE);
+    printf("Deliveries  %ld (skipped %llu)\n", total, skipped);
+    if (total > 0) {
+        printf("Latency     p50 %.1f us, p99 %.1f us, max %.1f us (publish to read)\n",
+            latency[total / 2] / 1e3, latency[total * 99 / 100] / 1e3, latency[total - 1] / 1e3);
+    }
+    printf("Publish     %.2f us per tick (write + a futex wake of every sleeping subscriber)\n", publishNs / 1e3 / ticks);
+    printf("CPU         %.1f%% over %.2f s, %.2f us per delivery\n",
+        100.0 * cpu / (wall / 1e9), wall / 1e9, total ? cpu * 1e6 / total : 0.0);
+
+    free(latency);
+    free(threads);
+    free(subs);
+    tick_stop(ring);
+    munmap(ring, sizeof(TickRing));
+    shm_unlink(TICK_SHM_NAME);
+    return 0;
+}
+#else
+int run_headless(long intervalMs) {
+    (void)intervalMs;
+    printf("Headless publishing needs Linux (shared memory ring + futex).\n");
+    return 1;
+}
+
+int run_subscriber() {
+    return run_headless(0);
+}
+
+int run_fanout_benchmark(int subscribers, int ticks, long intervalUs) {
+    (void)subscribers;
+    (void)ticks;
+    return run_headless(intervalUs);
+}
+#endif
+
+// ---------------------------------------------------------------------------
+// Alarms
+// ---------------------------------------------------------------------------
+
+// Alarms are kept in a min-heap ordered by their next fire time, so a tick only
+// looks at the top of the heap; adding and cancelling are O(log n). Each alarm
+// remembers its heap position, and its id is its slot number (plus one), which
+// stays the same across runs because the file stores it.
+#define ALARM_FILE "alarms.dat"
+#define ALARM_LOCK_FILE ALARM_FILE ".lock"   // Held while the file is read, changed and written
+#define ALARM_MAGIC "ALRM"
+#define ALARM_LABEL 24
+#define ALARM_MAX_ID (1 << 20)  // Slots are reused, so ids stay below the most alarms ever set at once
+
+typedef struct {
+    long long nextFire;     // Next time it goes off (seconds since the epoch), 0 if the slot is free
+    int heapIndex;
+    unsigned char hour, minute;
+    unsigned char weekdays; // Bit 0 = Sunday ... bit 6 = Saturday; 0 = one-shot
+    char label[ALARM_LABEL];
+} Alarm;
+
+Alarm *alarms = NULL;
+int alarmSlots = 0;         // Slots in use or free, ids 1..alarmSlots
+int alarmCapacity = 0;
+int *alarmHeap = NULL;      // Slot numbers, earliest nextFire first
+int alarmCount = 0;
+int *freeAlarms = NULL;     // Free slots below alarmSlots
+int freeAlarmCount = 0;
+int *spentAlarms = NULL;    // One-shots removed by the last alarm_check ...
+long long *spentFireAt = NULL;  // ... and when they were due
+int spentAlarmCount = 0;
+
+// The alarm file as last loaded or written here: saves replace the file, so a
+// change by another process shows up as a new inode, size or modification time
+typedef struct {
+    long long inode, size, mtime;
+} FileStamp;
+
+FileStamp alarmFileStamp;
+
+static const char *weekdayNames[7] = {"sun", "mon", "tue", "wed", "thu", "fri", "sat"};
+
+void alarm_heap_swap(int i, int j) {
+    int a = alarmHeap[i], b = alarmHeap[j];
+    alarmHeap[i] = b;
+    alarmHeap[j] = a;
+    alarms[b].heapIndex = i;
+    alarms[a].heapIndex = j;
+}
+
+void alarm_sift_up(int i) {
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (alarms[alarmHeap[parent]].nextFire <= alarms[alarmHeap[i]].nextFire)
+            break;
+        alarm_heap_swap(i, parent);
+        i = parent;
+    }
+}
+
+void alarm_sift_down(int i) {
+    while (1) {
+        int left = 2 * i + 1, smallest = i;
+        if (left < alarmCount && alarms[alarmHeap[left]].nextFire < alarms[alarmHeap[smallest]].nextFire)
+            smallest = left;
+        if (left + 1 < alarmCount && alarms[alarmHeap[left + 1]].nextFire < alarms[alarmHeap[smallest]].nextFire)
+            smallest = left + 1;
+        if (smallest == i)
+            return;
+        alarm_heap_swap(i, smallest);
+        i = smallest;
+    }
+}
+
+// First time after `after` (local time) at which the alarm should go off
+long long alarm_next_fire(const Alarm *a, time_t after) {
+    struct tm today;
+    local_time(&after, &today);
+    int passed = a->hour * 3600 + a->minute * 60 <= today.tm_hour * 3600 + today.tm_min * 60 + today.tm_sec;
+
+    // Pick the day by weekday arithmetic, then convert once
+    int day = passed;
+    while (day < 7 + passed && a->weekdays && !(a->weekdays >> (today.tm_wday + day) % 7 & 1))
+        day++;
+    struct tm t = today;
+    t.tm_mday += day;
+    t.tm_hour = a->hour;
+    t.tm_min = a->minute;
+    t.tm_sec = 0;
+    t.tm_isdst = -1;        // Let mktime work out DST for that day
+    long long when = mktime(&t);
+    return when > after ? when : (long long)after + 60;   // Skipped by a DST jump: retry shortly
+}
+
+// Makes room for `slots` slots (up to ALARM_MAX_ID); returns 0 if it cannot
+int alarm_reserve(int slots) {
+    if (slots <= alarmCapacity)
+        return 1;
+    if (slots > ALARM_MAX_ID)
+        return 0;
+    int capacity = alarmCapacity ? alarmCapacity : 64;
+    while (capacity < slots)
+        capacity *= 2;      // Stops at ALARM_MAX_ID, a power of two
+    // Arrays that did grow keep their larger blocks; alarmCapacity only moves
+    // once all of them have
+    Alarm *grownAlarms = realloc(alarms, capacity * sizeof(Alarm));
+    if (!grownAlarms)
+        return 0;
+    alarms = grownAlarms;
+    int *grownHeap = realloc(alarmHeap, capacity * sizeof(int));
+    if (!grownHeap)
+        return 0;
+    alarmHeap = grownHeap;
+    int *grownFree = realloc(freeAlarms, capacity * sizeof(int));
+    if (!grownFree)
+        return 0;
+    freeAlarms = grownFree;
+    int *grownSpent = realloc(spentAlarms, capacity * sizeof(int));
+    if (!grownSpent)
+        return 0;
+    spentAlarms = grownSpent;
+    long long *grownFireAt = realloc(spentFireAt, capacity * sizeof(long long));
+    if (!grownFireAt)
+        return 0;
+    spentFireAt = grownFireAt;
+    memset(alarms + alarmCapacity, 0, (capacity - alarmCapacity) * sizeof(Alarm));
+    alarmCapacity = capacity;
+    return 1;
+}
+
+// Puts an alarm into slot `slot` and onto the heap
+void alarm_insert_slot(int slot, int hour, int minute, int weekdays, const char *label, long long fireAt) {
+    Alarm *a = &alarms[slot];
+    a->hour = (unsigned char)hour;
+    a->minute = (unsigned char)minute;
+    a->weekdays = (unsigned char)weekdays;
+    snprintf(a->label, sizeof(a->label), "%s", label ? label : "");
+    a->nextFire = fireAt;
+    a->heapIndex = alarmCount;
+    alarmHeap[alarmCount++] = slot;
+    alarm_sift_up(a->heapIndex);
+}
+
+// Adds an alarm firing next after `now`; returns its id, or 0 if there is no room
+int alarm_add(int hour, int minute, int weekdays, const char *label, time_t now) {
+    int slot;
+    if (freeAlarmCount > 0) {
+        slot = freeAlarms[--freeAlarmCount];
+    } else {
+        if (!alarm_reserve(alarmSlots + 1))
+            return 0;
+        slot = alarmSlots++;
+    }
+    Alarm *a = &alarms[slot];
+    a->hour = (unsigned char)hour;
+    a->minute = (unsigned char)minute;
+    a->weekdays = (unsigned char)weekdays;
+    alarm_insert_slot(slot, hour, minute, weekdays, label, alarm_next_fire(a, now));
+    return slot + 1;
+}
+
+// Removes the alarm in heap position `i`
+void alarm_remove_at(int i) {
+    int slot = alarmHeap[i];
+    alarm_heap_swap(i, --alarmCount);
+    if (i < alarmCount) {
+        alarm_sift_up(i);       // The last alarm moved into the hole may belong higher
+        alarm_sift_down(i);     // ... or lower
+    }
+    alarms[slot].nextFire = 0;
+    freeAlarms[freeAlarmCount++] = slot;
+}
+
+// Cancels an alarm by id; returns 0 if there is no such alarm
+int alarm_cancel(int id) {
+    if (id < 1 || id > alarmSlots || alarms[id - 1].nextFire == 0)
+        return 0;
+    alarm_remove_at(alarms[id - 1].heapIndex);
+    return 1;
+}
+
+// Earliest pending alarm, or NULL
+const Alarm *alarm_next() {
+    return alarmCount > 0 ? &alarms[alarmHeap[0]] : NULL;
+}
+
+// Fires every alarm due at `now`: one-shots are removed, recurring ones
+// rescheduled. Returns how many fired; the last one is copied to `fired`, and
+// the removed one-shots are listed in spentAlarms (spentAlarmCount of them).
+int alarm_check(time_t now, Alarm *fired) {
+    int count = 0;
+    spentAlarmCount = 0;
+    while (alarmCount > 0 && alarms[alarmHeap[0]].nextFire <= now) {
+        Alarm *a = &alarms[alarmHeap[0]];
+        if (fired)
+            *fired = *a;
+        count++;
+        if (a->weekdays) {
+            a->nextFire = alarm_next_fire(a, now);
+            alarm_sift_down(0);
+        } else {
+            spentAlarms[spentAlarmCount] = alarmHeap[0];
+            spentFireAt[spentAlarmCount++] = a->nextFire;
+            alarm_remove_at(0);
+        }
+    }
+    return count;
+}
+
+// Forgets every alarm (the arrays are kept for reuse)
+void alarm_clear() {
+    if (alarms)
+        memset(alarms, 0, alarmSlots * sizeof(Alarm));
+    alarmSlots = 0;
+    alarmCount = 0;
+    freeAlarmCount = 0;
+}
+
+// Rebuilds the free list from the empty slots
+void alarm_rebuild_free_list() {
+    freeAlarmCount = 0;
+    for (int i = alarmSlots - 1; i >= 0; i--) {
+        if (alarms[i].nextFire == 0)
+            freeAlarms[freeAlarmCount++] = i;
+    }
+}
+
+// Little-endian helpers for the alarm file
+void put_le(unsigned char *p, unsigned long long v, int bytes) {
+    for (int i = 0; i < bytes; i++)
+        p[i] = (unsigned char)(v >> (8 * i));
+}
+
+unsigned long long get_le(const unsigned char *p, int bytes) {
+    unsigned long long v = 0;
+    for (int i = bytes - 1; i >= 0; i--)
+        v = v << 8 | p[i];
+    return v;
+}
+
+// Reads the stamp of a file; all zero if it does not exist
+void file_stamp(const char *path, FileStamp *s) {
+    struct stat st;
+    memset(s, 0, sizeof(*s));
+    if (stat(path, &st) == 0) {
+        s->inode = (long long)st.st_ino;
+        s->size = (long long)st.st_size;
+        s->mtime = (long long)st.st_mtime;
+    }
+}
+
+// Saves every alarm in one write. Record: id (4), hour, minute, weekdays,
+// next fire time (8, used for one-shots), label length, label. The records go
+// to a temporary file that then replaces the old one, so a reader (or a crash
+// halfway) never sees a truncated file.
+int alarm_save(const char *path) {
+    size_t size = 8 + (size_t)alarmCount * (16 + ALARM_LABEL), len = 8;
+    unsigned char *buf = malloc(size);
+    if (!buf)
+        return 0;
+    memcpy(buf, ALARM_MAGIC, 4);
+    put_le(buf + 4, alarmCount, 4);
+    for (int slot = 0; slot < alarmSlots; slot++) {
+        const Alarm *a = &alarms[slot];
+        if (a->nextFire == 0)
+            continue;
+        int labelLen = (int)strlen(a->label);
+        put_le(buf + len, slot + 1, 4);
+        buf[len + 4] = a->hour;
+        buf[len + 5] = a->minute;
+        buf[len + 6] = a->weekdays;
+        put_le(buf + len + 7, (unsigned long long)a->nextFire, 8);
+        buf[len + 15] = (unsigned char)labelLen;
+        memcpy(buf + len + 16, a->label, labelLen);
+        len += 16 + labelLen;
+    }
+
+    char tmp[256];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE *fp = fopen(tmp, "wb");
+    int ok = fp && fwrite(buf, 1, len, fp) == len;
+    if (fp)
+        ok = fclose(fp) == 0 && ok;
+    free(buf);
+#ifdef _WIN32
+    ok = ok && MoveFileExA(tmp, path, MOVEFILE_REPLACE_EXISTING);
+#else
+    ok = ok && rename(tmp, path) == 0;
+#endif
+    if (!ok) {
+        remove(tmp);
+        return 0;
+    }
+    file_stamp(path, &alarmFileStamp);
+    return 1;
+}
+
+// Loads alarms saved by alarm_save; recurring alarms are rescheduled from `now`
+// and one-shots missed while the clock was closed fire on the first tick
+int alarm_load(const char *path, time_t now) {
+    file_stamp(path, &alarmFileStamp);      // Before reading: a later change is seen again
+    FILE *fp = fopen(path, "rb");
+    if (!fp)
+        return 0;
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    rewind(fp);
+    unsigned char *buf = malloc(size > 0 ? size : 1);
+    if (!buf) {
+        fclose(fp);
+        return 0;
+    }
+    int ok = size >= 8 && fread(buf, 1, size, fp) == (size_t)size && memcmp(buf, ALARM_MAGIC, 4) == 0;
+    fclose(fp);
+
+    long pos = 8;
+    int records = ok ? (int)get_le(buf + 4, 4) : 0;
+    for (int i = 0; i < records && pos + 16 <= size; i++) {
+        const unsigned char *r = buf + pos;
+        int id = (int)get_le(r, 4), labelLen = r[15];
+        if (id < 1 || id > ALARM_MAX_ID || pos + 16 + labelLen > size || !alarm_reserve(id))
+            break;
+        char label[ALARM_LABEL];
+        snprintf(label, sizeof(label), "%.*s", labelLen, (const char *)r + 16);
+        pos += 16 + labelLen;
+
+        if (id > alarmSlots)
+            alarmSlots = id;
+        if (alarms[id - 1].nextFire != 0)
+            continue;       // Duplicate id
+        Alarm *a = &alarms[id - 1];
+        a->hour = r[4];
+        a->minute = r[5];
+        a->weekdays = r[6];
+        long long fireAt = a->weekdays ? alarm_next_fire(a, now) : (long long)get_le(r + 7, 8);
+        alarm_insert_slot(id - 1, r[4], r[5], r[6], label, fireAt);
+    }
+    free(buf);
+    alarm_rebuild_free_list();
+    return alarmCount;
+}
+
+// Writes back the removal of the one-shots spent by the last alarm_check. The
+// file may have changed since it was loaded (--alarm-add from another shell),
+// so it is reloaded under the lock and only the spent alarms are taken out.
+int alarm_sync(time_t now) {
+    int lock = lock_file(ALARM_LOCK_FILE);
+    int spent = spentAlarmCount;
+    alarm_clear();
+    alarm_load(ALARM_FILE, now);
+    for (int i = 0; i < spent; i++) {
+        int slot = spentAlarms[i];
+        if (slot < alarmSlots && alarms[slot].nextFire == spentFireAt[i] && !alarms[slot].weekdays)
+            alarm_remove_at(alarms[slot].heapIndex);
+    }
+    spentAlarmCount = 0;
+    int ok = alarm_save(ALARM_FILE);
+    unlock_file(lock);
+    return ok;
+}
+
+// Reloads the alarms if another process replaced the file (--alarm-add or
+// --alarm-cancel from another shell). Recurring alarms are rescheduled from
+// `checked`, the last second alarm_check has seen, so one due in the current
+// second still fires. Returns 1 if the file was reloaded.
+int alarm_refresh(time_t checked) {
+    FileStamp now;
+    file_stamp(ALARM_FILE, &now);
+    if (now.inode == alarmFileStamp.inode && now.size == alarmFileStamp.size && now.mtime == alarmFileStamp.mtime)
+        return 0;
+    int lock = lock_file(ALARM_LOCK_FILE);
+    alarm_clear();
+    alarm_load(ALARM_FILE, checked);
+    unlock_file(lock);
+    return 1;
+}
+
+// Parses "once", "daily", "weekdays", "weekends" or a list like "mon,wed,fri";
+// returns the weekday mask or -1
+int parse_weekdays(const char *text) {
+    if (strcmp(text, "once") == 0)
+        return 0;
+    if (strcmp(text, "daily") == 0)
+        return 0x7f;
+    if (strcmp(text, "weekdays") == 0)
+        return 0x3e;
+    if (strcmp(text, "weekends") == 0)
+        return 0x41;
+    int mask = 0;
+    while (*text) {
+        int day = 0;
+        while (day < 7 && strncmp(text, weekdayNames[day], 3) != 0)
+            day++;
+        if (day == 7)
+            return -1;
+        mask |= 1 << day;
+        text += 3;
+        if (*text == ',')
+            text++;
+    }
+    return mask ? mask : -1;
+}
+
+// Writes a readable summary of when an alarm repeats
+void format_weekdays(char *out, size_t size, int mask) {
+    if (mask == 0)
+        snprintf(out, size, "once");
+    else if (mask == 0x7f)
+        snprintf(out, size, "daily");
+    else if (mask == 0x3e)
+        snprintf(out, size, "weekdays");
+    else if (mask == 0x41)
+        snprintf(out, size, "weekends");
+    else {
+        size_t len = 0;
+        out[0] = '\0';
+        for (int d = 0; d < 7 && len + 5 < size; d++) {
+            if (mask >> d & 1)
+                len += snprintf(out + len, size - len, "%s%s", len ? "," : "", weekdayNames[d]);
+        }
+    }
+}
+
+// --alarm-add, --alarm-list or --alarm-cancel on the alarms in the file
+int alarm_command(int argc, char *argv[], time_t now) {
+    alarm_load(ALARM_FILE, now);
+
+    if (strcmp(argv[1], "--alarm-add") == 0) {
+        int hour, minute, weekdays = argc > 3 ? parse_weekdays(argv[3]) : 0;
+        if (argc < 3 || sscanf(argv[2], "%d:%d", &hour, &minute) != 2 || hour < 0 || hour > 23
+            || minute < 0 || minute > 59 || weekdays < 0) {
+            printf("Usage: --alarm-add HH:MM [once|daily|weekdays|weekends|mon,tue,...] [label]\n");
+            return 1;
+        }
+        int id = alarm_add(hour, minute, weekdays, argc > 4 ? argv[4] : "", now);
+        if (id == 0) {
+            printf("Too many alarms\n");
+            return 1;
+        }
+        if (!alarm_save(ALARM_FILE)) {
+            printf("Could not write %s\n", ALARM_FILE);
+            return 1;
+        }
+        printf("Alarm %d set for %02d:%02d\n", id, hour, minute);
+    } else if (strcmp(argv[1], "--alarm-cancel") == 0) {
+        if (argc < 3 || !alarm_cancel(atoi(argv[2]))) {
+            printf("No such alarm\n");
+            return 1;
+        }
+        if (!alarm_save(ALARM_FILE)) {
+            printf("Could not write %s\n", ALARM_FILE);
+            return 1;
+        }
+        printf("Alarm %s cancelled\n", argv[2]);
+    } else {
+        printf("%5s  %5s  %-28s  %-16s  %s\n", "ID", "Time", "Repeats", "Next", "Label");
+        for (int slot = 0; slot < alarmSlots; slot++) {
+            const Alarm *a = &alarms[slot];
+            if (a->nextFire == 0)
+                continue;
+            char repeats[32], next[20];
+            struct tm t;
+            time_t when = (time_t)a->nextFire;
+            local_time(&when, &t);
+            format_weekdays(repeats, sizeof(repeats), a->weekdays);
+            strftime(next, sizeof(next), "%a %Y-%m-%d", &t);
+            printf("%5d  %02d:%02d  %-28s  %-16s  %s\n", slot + 1, a->hour, a->minute, repeats, next, a->label);
+        }
+        printf("%d alarm%s\n", alarmCount, alarmCount == 1 ? "" : "s");
+    }
+    return 0;
+}
+
+// --alarm-add HH:MM [days] [label], --alarm-list, --alarm-cancel ID
+int run_alarm_command(int argc, char *argv[]) {
+    time_t now = time(NULL);
+    int lock = lock_file(ALARM_LOCK_FILE);   // A running clock may be writing the file too
+    int status = alarm_command(argc, argv, now);
+    unlock_file(lock);
+    return status;
+}
+
+// Tick cost against the number of alarms: inserts n random alarms, runs a day
+// of one-second ticks (only the heap top is checked) and cancels half of them
+int run_alarm_benchmark(int maxAlarms) {
+    srand(2024);
+    time_t start = time(NULL);
+    printf("%9s %12s %12s %14s %9s %12s\n", "alarms", "insert ns", "cancel ns", "tick ns", "fired", "memory KB");
+    for (int n = 1000; n <= maxAlarms; n *= 10) {
+        alarmSlots = alarmCount = freeAlarmCount = 0;
+        long long t0 = monotonic_ns();
+        for (int i = 0; i < n; i++) {
+            int weekdays = i % 4 == 0 ? 0 : rand() & 0x7f;
+            alarm_add(rand() % 24, rand() % 60, weekdays, "", start);
+        }
+        double insertNs = (double)(monotonic_ns() - t0) / n;
+
+        // 86400 ticks; alarm_check compares the top and pops only due alarms
+        long fired = 0;
+        t0 = monotonic_ns();
+        for (int s = 1; s <= 86400; s++)
+            fired += alarm_check(start + s, NULL);
+        double tickNs = (double)(monotonic_ns() - t0) / 86400;
+
+        // Ticks with nothing due, the common case
+        t0 = monotonic_ns();
+        for (int s = 0; s < 1000000; s++)
+            fired += alarm_check(start, NULL);
+        double idleNs = (double)(monotonic_ns() - t0) / 1000000;
+
+        int toCancel = alarmCount / 2, cancelled = 0;
+        t0 = monotonic_ns();
+        for (int i = 0; cancelled < toCancel && i < alarmSlots; i += 2)
+            cancelled += alarm_cancel(i + 1);
+        double cancelNs = cancelled ? (double)(monotonic_ns() - t0) / cancelled : 0;
+
+        printf("%9d %12.1f %12.1f %6.1f/%-7.1f %9ld %12zu\n", n, insertNs, cancelNs, tickNs, idleNs, fired,
+            (size_t)alarmCapacity * (sizeof(Alarm) + 2 * sizeof(int)) / 1024);
+    }
+    printf("(tick ns: average over a simulated day / idle tick)\n");
+    return 0;
+}
+
+// Tick interval for what is on screen: HIRES_FPS for milliseconds, tenths while
+// a stopwatch or countdown is running, otherwise whole seconds
+long desired_tick_interval() {
+    int countdownRunning = 0;
+    for (int i = 0; i < countdownCount; i++)
+        countdownRunning |= countdowns[i].handle != WHEEL_NONE;
+    if (view == VIEW_CLOCK && hiRes)
+        return NS_PER_SEC / HIRES_FPS;
+    if ((view == VIEW_STOPWATCH && stopwatch.running) || countdownRunning)
+        return NS_PER_SEC / 10;
+    return NS_PER_SEC;
+}
+
+// Composes and sends one frame, timing it for the stats overlay
+void draw_frame() {
+    struct timespec now, start, end;
+    get_monotonic(&start);
+    get_realtime(&now);
+    current_tm(&now);         // Local time conversion, at most once a second
+    profile_phase(PHASE_TIME);
+
+    screen_begin();
+    if (view == VIEW_STOPWATCH)
+        print_stopwatch(monotonic_ns());
+    else if (view == VIEW_COUNTDOWN)
+        print_countdowns(monotonic_ns());
+    else if (view == VIEW_WORLD)
+        print_world_clock(&now);
+    else if (hiRes)
+        print_time_hires(&now);
+    else
+        print_time(&now);
+
+    // User controls (the timer views draw their own)
+    if (view == VIEW_CLOCK || view == VIEW_WORLD) {
+        screen_print(view == VIEW_WORLD ? screen.rows - 3 : hiRes ? 10 : 8, 8,
+            "[H] 12/24 Hour  [M] Milliseconds  [W] World  [S] Stopwatch  [C] Countdown  [I] Stats  [P] Profile  [Q] Quit");
+        screen_print(0, 8, "%s", statusLine);
+
+        const Alarm *next = alarm_next();
+        if (next && view == VIEW_CLOCK) {
+            char repeats[32];
+            format_weekdays(repeats, sizeof(repeats), next->weekdays);
+            screen_print(hiRes ? 11 : 9, 8, "Next alarm %02d:%02d %s %s  (%d set)  [X] Dismiss",
+                next->hour, next->minute, repeats, next->label, alarmCount);
+        }
+    }
+
+    update_cpu_usage(&now);
+    if (showStats)
+        draw_stats_overlay();
+
+    profile_phase(PHASE_COMPOSE);
+    screen_flush();           // Send only what changed since the last frame
+
+    get_monotonic(&end);
+    frameTimes[frameTimeCount++ % FRAME_HISTORY] = elapsed_ns(&start, &end);
+    hist_record(&phaseHist[PHASE_FRAME], elapsed_ns(&start, &end));
+}
+
+// Draws `frames` frames of each view as fast as possible into the null device
+// and prints where the time went; `fullRedraw` repaints every cell each frame
+int run_frame_benchmark(int frames, int fullRedraw) {
+#ifdef _WIN32
+    const char *nullDevice = "NUL";
+#else
+    const char *nullDevice = "/dev/null";
+#endif
+    static const struct { const char *name; int view, hiRes; } modes[] = {
+        {"clock", VIEW_CLOCK, 0},
+        {"milliseconds", VIEW_CLOCK, 1},
+        {"world", VIEW_WORLD, 0},
+    };
+    FILE *sink = fopen(nullDevice, "w");
+    if (!sink) {
+        perror(nullDevice);
+        return 1;
+    }
+    build_glyph_atlas();
+    screen.rows = 24;           // A fixed size keeps runs comparable
+    screen.cols = 80;
+    fflush(stdout);
+    int savedOut = dup(1);
+
+    for (int m = 0; m < (int)(sizeof(modes) / sizeof(modes[0])); m++) {
+        view = modes[m].view;
+        hiRes = modes[m].hiRes;
+        profile_reset();
+        framesDrawn = bytesWritten = 0;
+        screen.cleared = 0;
+
+        dup2(fileno(sink), 1);
+        long long start = monotonic_ns();
+        for (int i = 0; i < frames; i++) {
+            if (fullRedraw)
+                screen.cleared = 0;
+            profile_begin();
+            draw_frame();
+        }
+        long long wall = monotonic_ns() - start;
+        dup2(savedOut, 1);
+
+        printf("%s: %d frames in %.1f ms, %.0f frames/s, %.1f bytes/frame\n", modes[m].name, frames,
+            wall / 1e6, frames / (wall / 1e9), (double)bytesWritten / frames);
+        profile_dump(stdout);
+        printf("\n");
+    }
+    close(savedOut);
+    fclose(sink);
+    return 0;
+}
+
+// Entry point of the program
+int main(int argc, char *argv[]) {
+    int key;         // To capture user keypresses
+
+    // --bench-zones [zones] [frames]: time zone lookups without drawing
+    if (argc > 1 && strcmp(argv[1], "--bench-zones") == 0) {
+        int count = argc > 2 ? atoi(argv[2]) : 200, frames = argc > 3 ? atoi(argv[3]) : 10000;
+        if (count < 1 || frames < 1) {
+            printf("Usage: --bench-zones [zones] [frames], both at least 1\n");
+            return 1;
+        }
+        return run_zone_benchmark(count, frames);
+    }
+    // --test-timers [count] [seconds]: timer wheel firing accuracy
+    if (argc > 1 && strcmp(argv[1], "--test-timers") == 0) {
+        int count = argc > 2 ? atoi(argv[2]) : 100000, seconds = argc > 3 ? atoi(argv[3]) : 5;
+        if (count < 1 || seconds < 1) {
+            printf("Usage: --test-timers [count] [seconds], both at least 1\n");
+            return 1;
+        }
+        return run_timer_test(count, seconds);
+    }
+    // Alarm management, then exit
+    if (argc > 1 && (strcmp(argv[1], "--alarm-add") == 0 || strcmp(argv[1], "--alarm-list") == 0
+        || strcmp(argv[1], "--alarm-cancel") == 0))
+        return run_alarm_command(argc, argv);
+    // --bench-alarms [max]: tick, insert and cancel cost from 1000 up to max alarms
+    if (argc > 1 && strcmp(argv[1], "--bench-alarms") == 0) {
+        int maxAlarms = argc > 2 ? atoi(argv[2]) : 1000000;
+        if (maxAlarms < 1 || maxAlarms > ALARM_MAX_ID) {
+            printf("Usage: --bench-alarms [max], max 1 to %d\n", ALARM_MAX_ID);
+            return 1;
+        }
+        return run_alarm_benchmark(maxAlarms);
+    }
+    // --headless [interval_ms]: no display, publish ticks to subscribers
+    if (argc > 1 && strcmp(argv[1], "--headless") == 0) {
+        char *end = "";
+        long intervalMs = argc > 2 ? strtol(argv[2], &end, 10) : 1000;
+        if (*end != '\0' || intervalMs < 1 || intervalMs > 86400000L) {
+            printf("Usage: --headless [interval_ms], interval 1 to 86400000\n");
+            return 1;
+        }
+        return run_headless(intervalMs);
+    }
+    if (argc > 1 && strcmp(argv[1], "--subscribe") == 0)
+        return run_subscriber();
+    // --bench-fanout [subscribers] [ticks] [interval_us]
+    if (argc > 1 && strcmp(argv[1], "--bench-fanout") == 0) {
+        int subscribers = argc > 2 ? atoi(argv[2]) : 1000, ticks = argc > 3 ? atoi(argv[3]) : 200;
+        long intervalUs = argc > 4 ? atol(argv[4]) : 10000;
+        if (subscribers < 1 || ticks < 1 || intervalUs < 1) {
+            printf("Usage: --bench-fanout [subscribers] [ticks] [interval_us], all at least 1\n");
+            return 1;
+        }
+        return run_fanout_benchmark(subscribers, ticks, intervalUs);
+    }
+
+    // World clock zones: --zones a,b,c (or "all"), else $CLOCK_ZONES, else a default set
+    const char *zoneList = getenv("CLOCK_ZONES") ? getenv("CLOCK_ZONES") : DEFAULT_ZONES;
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "--zones") == 0)
+            zoneList = argv[i + 1];
+    }
+    load_zones(zoneList);
+    wheel_init(&wheel, MAX_COUNTDOWNS, monotonic_ns() / 1000000);
+    time_t alarmsChecked = time(NULL);     // Last second compared with the alarms
+    alarm_load(ALARM_FILE, alarmsChecked);
+
+    // --bench N [full]: draw N frames of each view to the null device without sleeping
+    if (argc > 2 && strcmp(argv[1], "--bench") == 0) {
+        int frames = atoi(argv[2]);
+        if (frames < 1) {
+            printf("Usage: --bench N [full], N at least 1\n");
+            return 1;
+        }
+        return run_frame_benchmark(frames, argc > 3 && strcmp(argv[3], "full") == 0);
+    }
+
+    build_glyph_atlas();
+    screen_init();
+    input_init();               // Raw keyboard mode, set once
+    timer_start(NS_PER_SEC);    // Tick on every wall-clock second edge
+    profile_begin();
+    draw_frame();
+
+    while (1) {
+        int events = wait_for_event();   // Sleep until a tick or a key press
+        profile_phase(PHASE_WAIT);
+        struct timespec woke, drawn;
+        get_realtime(&woke);
+
+        // How far past its boundary this tick woke up
+        if (events & EVENT_TICK)
+            record_sample(tickJitter, &tickCount, woke.tv_nsec % tickIntervalNs);
+
+        // Handle the key press right away
+        if (events & EVENT_KEY) {
+            key = read_key();
+            if (key == 'q' || key == 'Q')
+                break;        // Exit loop if 'q' is pressed
+            else if (key == 'h' || key == 'H')
+                is24Hour = !is24Hour;  // Toggle 12/24 hour mode
+            else if (key == 'm' || key == 'M')
+                hiRes = !hiRes;        // Toggle millisecond mode
+            else if (key == 'w' || key == 'W')
+                view = view == VIEW_WORLD ? VIEW_CLOCK : VIEW_WORLD;
+            else if (key == 's' || key == 'S')
+                view = view == VIEW_STOPWATCH ? VIEW_CLOCK : VIEW_STOPWATCH;
+            else if (key == 'c' || key == 'C')
+                view = view == VIEW_COUNTDOWN ? VIEW_CLOCK : VIEW_COUNTDOWN;
+            else if (key == 'i' || key == 'I')
+                showStats = !showStats; // Toggle the stats overlay
+            else if (key == 'p' || key == 'P') {
+                FILE *fp = fopen(PROFILE_FILE, "w");
+                if (fp) {
+                    profile_dump(fp);
+                    fclose(fp);
+                }
+                snprintf(statusLine, sizeof(statusLine), fp ? "Profile written to %s" : "Could not write %s", PROFILE_FILE);
+            } else if (key == 'x' || key == 'X')
+                statusLine[0] = '\0';  // Dismiss the alarm (or other) message
+            else if (view == VIEW_STOPWATCH) {
+                long long nowNs = monotonic_ns();
+                if (key == ' ')
+                    stopwatch_toggle(nowNs);
+                else if ((key == 'l' || key == 'L') && stopwatch.running)
+                    stopwatch_lap(nowNs);
+                else if (key == 'r' || key == 'R')
+                    stopwatch_reset();
+                else if (key == 'e' || key == 'E') {
+                    int laps = export_laps(LAP_FILE);
+                    if (laps < 0)
+                        snprintf(statusLine, sizeof(statusLine), "Could not write %s", LAP_FILE);
+                    else
+                        snprintf(statusLine, sizeof(statusLine), "%d laps exported to %s", laps, LAP_FILE);
+                }
+            } else if (view == VIEW_COUNTDOWN) {
+                if (key == '+' || key == '=')
+                    countdownSetting += 60 * 1000;
+                else if ((key == '-' || key == '_') && countdownSetting > 60 * 1000)
+                    countdownSetting -= 60 * 1000;
+                else if (key == ' ')
+                    countdown_start(monotonic_ns() / 1000000);
+                else if (key == 'r' || key == 'R')
+                    countdown_reset();
+            }
+        }
+
+        // Fire due countdowns, then match the tick rate to what is on screen
+        wheel_advance(&wheel, monotonic_ns() / 1000000, countdown_fired, NULL);
+
+        // Alarms: pick up changes from other shells once a second, then compare
+        // only the earliest one with the clock
+        if (woke.tv_sec != alarmsChecked)
+            alarm_refresh(alarmsChecked);
+        Alarm fired;
+        if (alarm_check(woke.tv_sec, &fired) > 0) {
+            snprintf(statusLine, sizeof(statusLine), "ALARM %02d:%02d %s", fired.hour, fired.minute, fired.label);
+            write_out("\a", 1);
+            if (spentAlarmCount > 0)
+                alarm_sync(woke.tv_sec);    // One-shot alarms are gone for good
+        }
+        alarmsChecked = woke.tv_sec;
+        if (desired_tick_interval() != tickIntervalNs)
+            timer_start(desired_tick_interval());
+        profile_phase(PHASE_INPUT);
+
+        draw_frame();         // Draw time (only changed cells reach the terminal)
+
+        if (events & EVENT_KEY) {
+            get_realtime(&drawn);
+            record_sample(keyLatency, &keyCount, elapsed_ns(&woke, &drawn));
         }
     }
 
-    clear_screen(); // Final clear
+    screen_close(); // Final clear
+    print_percentiles("Tick jitter", tickJitter, tickCount);
+    print_percentiles("Key latency", keyLatency, keyCount);
+    profile_dump(stdout);
     printf("Clock closed. Goodbye!\n");
     return 0;
 }
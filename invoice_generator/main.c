@@ -9,7 +9,7 @@
  * 
  * Features:
  * ---------
- * - Stores invoices as timestamped text files in the "invoices" folder.
+ * - Stores invoices as text files in the "invoices" folder, named by a collision-free invoice ID.
  * - Calculates subtotal, GST (18%), and grand total for each invoice.
  * - Supports buyer details (name, phone, email).
  * - Loads items from a CSV file ("items.csv") or allows manual entry.
@@ -23,9 +23,21 @@
  * Main Functions:
  * ---------------
  * - getCurrentDateTime: Gets current date/time as a string for filenames.
- * - printDateTime: Prints and writes the current date/time to invoice.
+ * - initInvoiceIdAllocator: Picks the worker ID used in this process's invoice IDs.
+ * - allocateInvoiceId: Hands out a unique, time-ordered invoice ID without touching the filesystem.
+ * - compileTemplate / renderTemplate: Compile invoice templates once, then fill them per invoice.
+ * - renderInvoice: Renders an invoice as text, HTML or PDF into a buffer.
+ * - writeInvoiceBody: Writes the text layout of an invoice to any stream.
+ * - loadCatalog / reloadCatalog: Load the product catalog and hot-swap it in.
+ * - resolveCatalogItems: Turns (SKU, quantity) lines into priced invoice items.
+ * - appendSalesRecords: Records each invoice line in the sales ledger.
+ * - storeInvoiceInSegment: Appends an invoice to this process's compact segment file.
+ * - scanInvoiceSegment: Decodes the invoices in a segment (used to list and view them).
+ * - runSalesReport: Totals revenue by day, buyer and item over the ledger.
  * - loadItemsFromCSV: Loads items from "items.csv" into an array.
- * - generateInvoice: Generates and saves an invoice file.
+ * - saveInvoice: Allocates an ID and stores an invoice (shared by the menu and the service).
+ * - generateInvoice: Generates and saves an invoice file (text, HTML or PDF).
+ * - startInvoiceService / runServiceLoad: Serve invoice requests on a socket, and load-test it.
  * - listPastInvoices: Lists all invoice files in the "invoices" directory.
  * - viewInvoiceByName: Displays the contents of a selected invoice file.
  * 
@@ -33,142 +45,3373 @@
  * ------
  * 1. Run the program.
  * 2. Choose to generate a new invoice, list past invoices, or view a specific invoice.
- * 3. For new invoices, enter buyer details and choose item entry method.
+ * 3. For new invoices, enter buyer details, choose item entry method and output format.
  * 4. Invoices are saved in the "invoices" directory.
  * 
+ * Invoice IDs:
+ * ------------
+ * Each invoice is named "invoice_<date>_<time>_<worker>-<sequence>.txt". The worker ID
+ * is the process ID (or INVOICE_WORKER_ID from the environment, e.g. to separate hosts
+ * sharing a folder) and the sequence is a lock-free atomic counter, so any number of
+ * threads and processes can generate invoices in the same second without collisions.
+ * A process that reuses the PID of one that ran earlier in the same second starts at
+ * the same sequence; its invoice file or segment then already exists, and the invoice
+ * simply takes the next sequence number.
+ * 
+ * Product Catalog:
+ * ----------------
+ * "catalog.csv" holds one product per line: SKU,name,unit price,tax class
+ * (tax class 0-4 = GST 0%, 5%, 12%, 18%, 28%). It is loaded once into an
+ * open-addressing hash table whose SKU and name strings live in one compact
+ * string pool, so invoice lines only need a SKU and quantity and prices are
+ * resolved in O(1). Reloading builds the new table off to the side and then
+ * swaps a pointer, so invoices being generated never wait for a reload.
+ * 
+ *   ./invoice --bench-catalog [skus]
+ * Measures load time, lookup latency and reader stalls during a hot reload
+ * on a synthetic catalog (default 10000000 SKUs).
+ * 
+ * Output Formats:
+ * ---------------
+ * Invoices can be written as text, HTML or PDF. Templates use {{field}} or
+ * {{field:width}} slots (negative width = left-aligned) and a repeated
+ * {{#items}}...{{/items}} section; they are compiled once into a flat list of
+ * literal chunks and field slots, so each invoice is rendered by concatenating
+ * into a buffer with no re-parsing. "templates/invoice.txt" and
+ * "templates/invoice.html" override the built-in layouts. PDFs are produced by
+ * a small built-in writer (Courier text, no external libraries).
+ * 
+ *   ./invoice --bench-render [invoices]
+ * Reports invoices/s for text, HTML and PDF.
+ * 
+ * Compact Storage:
+ * ----------------
+ * With INVOICE_STORAGE=segment, invoices are appended to a binary segment file
+ * ("invoices/segment_<first invoice ID>.seg", one per process, up to 100000
+ * invoices) instead of one padded text file each. A segment is a series of
+ * blocks; each block is a stream of varint-encoded entries, optionally
+ * compressed with a small in-tree LZ77 codec. Buyer details and item names are
+ * dictionary-encoded per segment, prices are stored in paise and tax rates in
+ * basis points. Listing and viewing work the same for both formats: a stored
+ * invoice is rendered back to the text layout on demand.
+ * 
+ *   ./invoice --bench-storage [invoices]
+ * Reports bytes per invoice and encode/decode throughput versus text files. Batches
+ * (the service) fill 64 KB blocks; an invoice made from the menu is flushed as its
+ * own block so it is on disk at once, which the last row measures.
+ * 
+ * Sales Reports:
+ * --------------
+ * Every generated invoice also appends one fixed-size record per line to
+ * "invoices/sales.dat". Reports map that ledger into memory, split it into one
+ * partition per thread, aggregate each partition into private hash maps and
+ * merge them at the end. The totals are saved to "invoices/report.state", so an
+ * incremental report only scans lines added since the previous report. The state
+ * remembers which ledger file it totals (device, inode and record checksums), so
+ * a ledger that was replaced or truncated since is reported from scratch.
+ * 
+ *   ./invoice --report [threads]              Full report
+ *   ./invoice --report-incremental [threads]  Only new invoices
+ *   ./invoice --bench-report [invoices] [threads]
+ * 
+ * Service Mode:
+ * -------------
+ *   ./invoice --serve <socket> [workers]
+ * Listens on a Unix domain socket instead of showing the menu, so other programs
+ * can create invoices without starting a process per invoice. Each request and
+ * response is a frame: a 4-byte length followed by that many bytes. Integers are
+ * little-endian; a string is a 1-byte length and its bytes.
+ *
+ *   Request:  tag (4) | format (1: 0 text, 1 HTML, 2 PDF) | item kind (1) | item count (1)
+ *             | buyer name | phone | email | items
+ *             item kind 0: name | quantity (4) | unit price in paise (4)   (GST 18%)
+ *             item kind 1: SKU | quantity (4)                            (priced from catalog.csv)
+ *   Response: tag (4) | status (1) | invoice ID (or the unknown SKU) | grand total in paise (8)
+ *             status 0 = saved, 1 = malformed request, 2 = unknown SKU, 3 = storage error,
+ *             4 = no catalog loaded
+ *
+ * Requests may be pipelined; responses carry the request's tag and can arrive out
+ * of order. A reader thread per connection decodes frames into the bounded queues
+ * of the worker threads (round robin). When a queue is full the reader stops reading,
+ * so a client sending faster than invoices are produced is held back by its own
+ * socket buffer instead of growing the server's memory. Each worker takes up to 32
+ * queued requests at a time, saves them with one segment flush and one ledger write,
+ * and sends each connection all of its responses in one write. Workers never wait
+ * for a client: responses its socket has no room for are handed to the connection's
+ * reader, which stops reading that client's requests until they are sent.
+ *
+ *   ./invoice --load-test <socket> [requests] [clients]
+ *   ./invoice --bench-service [requests] [clients] [workers]
+ * Closed-loop load generator at 1, 2, 4 ... clients reporting invoices/s and p50/p99
+ * latency; --bench-service runs it against an in-process service in a scratch folder.
+ * 
+ * Stress test:
+ * ------------
+ *   ./invoice --stress [invoices] [threads]
+ * Generates invoices (default 1000000 across 16 threads) into /dev/null, then checks
+ * that every allocated ID is unique and reports throughput.
+ * 
  * Note:
  * -----
- * - Requires "items.csv" for CSV item loading.
+ * - Requires "items.csv" for CSV item loading and "catalog.csv" for SKU entry.
  * - Creates "invoices" directory if it does not exist.
  * - Designed for basic demonstration and educational purposes.
+ * - Compile with: gcc main.c -o invoice -pthread -lm
  */
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <math.h>
 #include <dirent.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <signal.h>
+#include <errno.h>
+
+// Maximum number of items per invoice
+#define MAX_ITEMS 100
+// GST tax rate (18%)
+#define TAX_RATE 0.18
+// Folder to store invoices
+#define INVOICE_FOLDER "invoices"
+// Maximum length of an invoice ID
+#define MAX_INVOICE_ID 64
+// IDs tried for one invoice before giving up on finding one that is not taken
+#define INVOICE_ID_ATTEMPTS 1000
+// Fixed-size record of every invoice line, used for sales reports
+#define SALES_LEDGER INVOICE_FOLDER "/sales.dat"
+// Totals of the last sales report, used by incremental reports
+#define REPORT_STATE INVOICE_FOLDER "/report.state"
+// Magic bytes at the start of the report state
+#define REPORT_STATE_MAGIC "SALESRP2"
+// Optional custom templates (invoice.txt, invoice.html) are read from here
+#define TEMPLATE_FOLDER "templates"
+// Lines of text per PDF page
+#define PDF_LINES_PER_PAGE 64
+// Magic bytes at the start of every invoice segment file
+#define SEGMENT_MAGIC "INVSEG01"
+// Pending segment data is written out as a block once it reaches this size
+#define SEGMENT_BLOCK_SIZE (64 * 1024)
+// Largest block a reader accepts: a full block plus the invoice that overflowed it
+#define SEGMENT_MAX_BLOCK (4 * SEGMENT_BLOCK_SIZE)
+// Invoices per segment file before a new one is started
+#define SEGMENT_MAX_INVOICES 100000
+// Product catalog (SKU,name,unit price,tax class)
+#define CATALOG_FILE "catalog.csv"
+// Number of catalog tax classes
+#define TAX_CLASS_COUNT 5
+
+// Structure to represent an item in the invoice
+typedef struct {
+    char name[50];     // Item name
+    int quantity;      // Quantity purchased
+    float price;       // Price per item
+    float total;       // Total price for this item (quantity * price)
+    float taxRate;     // GST rate applied to this item
+} Item;
+
+// Structure to represent buyer details
+typedef struct {
+    char name[100];    // Buyer's name
+    char phone[20];    // Buyer's phone number
+    char email[100];   // Buyer's email address
+} Buyer;
+
+// Gets the current date and time as a string for filenames
+void getCurrentDateTime(char *datetimeStr, int maxLen) {
+    time_t now = time(NULL);
+    struct tm t;
+    localtime_r(&now, &t);
+    strftime(datetimeStr, maxLen, "%Y-%m-%d_%H-%M-%S", &t);
+}
+
+// Worker ID embedded in every invoice ID generated by this process
+static unsigned int invoiceWorkerId;
+// Per-process invoice sequence, shared lock-free by all threads
+static atomic_ulong invoiceSequence;
+
+// Picks the worker ID for this process: INVOICE_WORKER_ID if set, otherwise the PID
+void initInvoiceIdAllocator() {
+    const char *env = getenv("INVOICE_WORKER_ID");
+    if (env && *env)
+        invoiceWorkerId = (unsigned int)strtoul(env, NULL, 0) & 0xFFFFFF;
+    else
+        invoiceWorkerId = (unsigned int)getpid() & 0xFFFFFF;
+    atomic_store(&invoiceSequence, 0);
+}
+
+// Allocates a unique invoice ID of the form "<date>_<time>_<worker>-<sequence>" and
+// returns the time it is stamped with (and the sequence in `seq`, if not NULL). The
+// time is read before the sequence, so a later sequence never carries an earlier
+// second. The timestamp is formatted at most once per second per thread.
+time_t allocateInvoiceId(char *idStr, int maxLen, unsigned long *seqOut) {
+    static _Thread_local time_t cachedSecond = -1;
+    static _Thread_local char cachedStamp[32];
+
+    time_t now = time(NULL);
+    unsigned long seq = atomic_fetch_add_explicit(&invoiceSequence, 1, memory_order_seq_cst);
+    if (now != cachedSecond) {
+        getCurrentDateTime(cachedStamp, sizeof(cachedStamp));
+        cachedSecond = now;
+    }
+    snprintf(idStr, maxLen, "%s_%06x-%08lu", cachedStamp, invoiceWorkerId, seq);
+    if (seqOut)
+        *seqOut = seq;
+    return cachedSecond;
+}
+
+// Loads items from "items.csv" into the items array
+int loadItemsFromCSV(Item items[]) {
+    FILE *fp = fopen("items.csv", "r");
+    if (!fp) {
+        printf("Error opening items.csv\n");
+        return 0;
+    }
+
+    char line[200];
+    int count = 0;
+
+    // Read each line and parse item details
+    while (fgets(line, sizeof(line), fp)) {
+        sscanf(line, "%[^,],%d,%f", items[count].name, &items[count].quantity, &items[count].price);
+        items[count].total = items[count].quantity * items[count].price;
+        items[count].taxRate = TAX_RATE;
+        count++;
+    }
+
+    fclose(fp);
+    return count; // Return number of items loaded
+}
+
+// ---------------------------------------------------------------------------
+// Invoice templates (text, HTML, PDF)
+// ---------------------------------------------------------------------------
+
+// Output formats for rendered invoices
+typedef enum { FORMAT_TEXT, FORMAT_HTML, FORMAT_PDF, FORMAT_COUNT } InvoiceFormat;
+
+// Growable output buffer that rendered invoices are concatenated into
+typedef struct {
+    char *data;
+    size_t len, cap;
+} OutBuf;
+
+// Makes room for `extra` more bytes
+void reserveOutBuf(OutBuf *out, size_t extra) {
+    if (out->len + extra <= out->cap)
+        return;
+    size_t cap = out->cap ? out->cap : 4096;
+    while (cap < out->len + extra)
+        cap *= 2;
+    char *grown = realloc(out->data, cap);
+    if (!grown) {
+        printf("Out of memory rendering invoice.\n");
+        exit(1);
+    }
+    out->data = grown;
+    out->cap = cap;
+}
+
+void appendOutBuf(OutBuf *out, const char *s, size_t len) {
+    reserveOutBuf(out, len);
+    memcpy(out->data + out->len, s, len);
+    out->len += len;
+}
+
+// Fields a template can refer to as {{name}} or {{name:width}} (negative width = left-aligned)
+typedef enum {
+    FIELD_DATE, FIELD_BUYER_NAME, FIELD_BUYER_PHONE, FIELD_BUYER_EMAIL,
+    FIELD_ITEM_NAME, FIELD_ITEM_QTY, FIELD_ITEM_PRICE, FIELD_ITEM_TOTAL,
+    FIELD_SUBTOTAL, FIELD_TAX_RATE, FIELD_TAX, FIELD_GRAND_TOTAL, FIELD_COUNT
+} TemplateField;
+
+static const char *templateFieldNames[FIELD_COUNT] = {
+    "date", "buyer.name", "buyer.phone", "buyer.email",
+    "item.name", "item.qty", "item.price", "item.total",
+    "subtotal", "tax.rate", "tax", "grandtotal",
+};
+
+// One step of a compiled template
+typedef enum { OP_LITERAL, OP_FIELD, OP_ITEMS_BEGIN, OP_ITEMS_END } TemplateOpType;
+
+typedef struct {
+    TemplateOpType type;
+    size_t offset, len;        // OP_LITERAL: chunk of the template text
+    TemplateField field;       // OP_FIELD
+    int width;                 // OP_FIELD padding, negative = left-aligned
+    int jump;                  // OP_ITEMS_BEGIN: index of its OP_ITEMS_END
+} TemplateOp;
+
+// A template compiled into a flat list of literal chunks and field slots.
+// Sections between {{#items}} and {{/items}} repeat once per invoice line.
+typedef struct {
+    char *text;                // Template source (literals point into it)
+    TemplateOp *ops;
+    int opCount;
+    int escapeHtml;            // Escape field values for HTML
+} InvoiceTemplate;
+
+// Compiles template source. Returns NULL (after printing why) if it is malformed
+// or memory runs out.
+InvoiceTemplate *compileTemplate(const char *source, int escapeHtml) {
+    InvoiceTemplate *t = calloc(1, sizeof(InvoiceTemplate));
+    if (!t) {
+        printf("Out of memory compiling template.\n");
+        return NULL;
+    }
+    t->text = strdup(source);
+    t->escapeHtml = escapeHtml;
+    t->ops = malloc((strlen(source) + 1) * sizeof(TemplateOp));   // Never more ops than bytes
+    int loopStart = -1;
+    if (!t->text || !t->ops) {
+        printf("Out of memory compiling template.\n");
+        goto fail;
+    }
+
+    const char *p = t->text;
+    while (*p) {
+        const char *open = strstr(p, "{{");
+        size_t literal = open ? (size_t)(open - p) : strlen(p);
+        if (literal) {
+            TemplateOp *op = &t->ops[t->opCount++];
+            op->type = OP_LITERAL;
+            op->offset = p - t->text;
+            op->len = literal;
+        }
+        if (!open)
+            break;
+
+        const char *close = strstr(open + 2, "}}");
+        if (!close) {
+            printf("Template error: unterminated {{ at offset %ld\n", (long)(open - t->text));
+            goto fail;
+        }
+        char tag[64];
+        size_t tagLen = close - open - 2;
+        if (tagLen >= sizeof(tag)) {
+            printf("Template error: tag too long at offset %ld\n", (long)(open - t->text));
+            goto fail;
+        }
+        memcpy(tag, open + 2, tagLen);
+        tag[tagLen] = '\0';
+
+        TemplateOp *op = &t->ops[t->opCount];
+        memset(op, 0, sizeof(*op));
+        if (strcmp(tag, "#items") == 0) {
+            if (loopStart >= 0) {
+                printf("Template error: nested {{#items}}\n");
+                goto fail;
+            }
+            op->type = OP_ITEMS_BEGIN;
+            loopStart = t->opCount;
+        } else if (strcmp(tag, "/items") == 0) {
+            if (loopStart < 0) {
+                printf("Template error: {{/items}} without {{#items}}\n");
+                goto fail;
+            }
+            op->type = OP_ITEMS_END;
+            t->ops[loopStart].jump = t->opCount;
+            loopStart = -1;
+        } else {
+            char *colon = strchr(tag, ':');
+            if (colon) {
+                *colon = '\0';
+                op->width = atoi(colon + 1);
+            }
+            op->type = OP_FIELD;
+            op->field = FIELD_COUNT;
+            for (int f = 0; f < FIELD_COUNT; f++) {
+                if (strcmp(tag, templateFieldNames[f]) == 0)
+                    op->field = (TemplateField)f;
+            }
+            if (op->field == FIELD_COUNT) {
+                printf("Template error: unknown field {{%s}}\n", tag);
+                goto fail;
+            }
+            int isItemField = op->field >= FIELD_ITEM_NAME && op->field <= FIELD_ITEM_TOTAL;
+            if (isItemField != (loopStart >= 0)) {
+                printf("Template error: {{%s}} %s\n", tag, isItemField ? "outside {{#items}}" : "inside {{#items}}");
+                goto fail;
+            }
+        }
+        t->opCount++;
+        p = close + 2;
+    }
+    if (loopStart >= 0) {
+        printf("Template error: {{#items}} is never closed\n");
+        goto fail;
+    }
+    return t;
+
+fail:
+    free(t->text);
+    free(t->ops);
+    free(t);
+    return NULL;
+}
+
+// Built-in templates. The text one reproduces the original invoice layout.
+static const char *builtinTextTemplate =
+    "======== INVOICE ========\n"
+    "Date: {{date}}\n"
+    "Buyer Name : {{buyer.name}}\n"
+    "Phone      : {{buyer.phone}}\n"
+    "Email      : {{buyer.email}}\n"
+    "\n"
+    "Item                 Qty        Price      Total     \n"
+    "{{#items}}{{item.name:-20}} {{item.qty:-10}} {{item.price:-10}} {{item.total:-10}}\n{{/items}}"
+    "\n"
+    "Subtotal: {{subtotal}}\n"
+    "GST ({{tax.rate}}): {{tax}}\n"
+    "Grand Total: {{grandtotal}}\n";
+
+static const char *builtinHtmlTemplate =
+    "<!DOCTYPE html>\n<html><head><meta charset=\"utf-8\"><title>Invoice</title>\n"
+    "<style>body{font-family:sans-serif}table{border-collapse:collapse}"
+    "td,th{border:1px solid #999;padding:4px 8px}td.n{text-align:right}</style></head>\n"
+    "<body><h1>Invoice</h1>\n<p>Date: {{date}}<br>\n"
+    "Buyer Name: {{buyer.name}}<br>\nPhone: {{buyer.phone}}<br>\nEmail: {{buyer.email}}</p>\n"
+    "<table><tr><th>Item</th><th>Qty</th><th>Price</th><th>Total</th></tr>\n"
+    "{{#items}}<tr><td>{{item.name}}</td><td class=\"n\">{{item.qty}}</td>"
+    "<td class=\"n\">{{item.price}}</td><td class=\"n\">{{item.total}}</td></tr>\n{{/items}}"
+    "</table>\n<p>Subtotal: {{subtotal}}<br>\nGST ({{tax.rate}}): {{tax}}<br>\n"
+    "<strong>Grand Total: {{grandtotal}}</strong></p>\n</body></html>\n";
+
+// Compiled templates, indexed by InvoiceFormat (PDF wraps the text template)
+static InvoiceTemplate *invoiceTemplates[FORMAT_COUNT];
+static pthread_once_t templatesOnce = PTHREAD_ONCE_INIT;
+
+// Reads a whole template file, or returns NULL if it does not exist
+char *readTemplateFile(const char *path) {
+    FILE *fp = fopen(path, "rb");
+    if (!fp)
+        return NULL;
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    char *text = malloc(size + 1);
+    if (text && fread(text, 1, size, fp) == (size_t)size) {
+        text[size] = '\0';
+    } else {
+        free(text);
+        text = NULL;
+    }
+    fclose(fp);
+    return text;
+}
+
+// Compiles the templates once per process, preferring files in the templates folder
+void compileInvoiceTemplates() {
+    const char *paths[2] = {TEMPLATE_FOLDER "/invoice.txt", TEMPLATE_FOLDER "/invoice.html"};
+    const char *builtins[2] = {builtinTextTemplate, builtinHtmlTemplate};
+
+    for (int f = FORMAT_TEXT; f <= FORMAT_HTML; f++) {
+        char *custom = readTemplateFile(paths[f]);
+        if (custom) {
+            invoiceTemplates[f] = compileTemplate(custom, f == FORMAT_HTML);
+            if (!invoiceTemplates[f])
+                printf("Using the built-in template instead of %s\n", paths[f]);
+            free(custom);
+        }
+        if (!invoiceTemplates[f])
+            invoiceTemplates[f] = compileTemplate(builtins[f], f == FORMAT_HTML);
+        if (!invoiceTemplates[f])
+            exit(1);        // Only when out of memory: the built-in templates are valid
+    }
+    invoiceTemplates[FORMAT_PDF] = invoiceTemplates[FORMAT_TEXT];
+}
+
+// Values computed once per invoice and substituted into template slots
+typedef struct {
+    const Item *items;
+    int count;
+    const Buyer *buyer;
+    char date[32];
+    char taxRate[16];
+    float subtotal, tax, grandTotal;
+} InvoiceView;
+
+// Computes dates and totals for rendering
+void buildInvoiceView(InvoiceView *v, const Item items[], int count, const Buyer *buyer, time_t issued) {
+    struct tm t;
+    localtime_r(&issued, &t);
+    strftime(v->date, sizeof(v->date), "%d-%m-%Y %H:%M:%S", &t);
+
+    v->items = items;
+    v->count = count;
+    v->buyer = buyer;
+    v->subtotal = 0;
+    v->tax = 0;
+    int mixedRates = 0;
+    for (int i = 0; i < count; i++) {
+        v->subtotal += items[i].total;
+        v->tax += items[i].total * items[i].taxRate;
+        if (items[i].taxRate != items[0].taxRate)
+            mixedRates = 1;
+    }
+    v->grandTotal = v->subtotal + v->tax;
+
+    // A single GST line, labelled with the rate when all items share it
+    if (mixedRates)
+        snprintf(v->taxRate, sizeof(v->taxRate), "mixed");
+    else
+        snprintf(v->taxRate, sizeof(v->taxRate), "%.0f%%", (count > 0 ? items[0].taxRate : TAX_RATE) * 100);
+}
+
+// Appends one field value, padded like printf's %*s / %-*s
+void appendField(OutBuf *out, const char *value, size_t len, int width, int escapeHtml) {
+    size_t pad = 0;
+    size_t target = (size_t)(width < 0 ? -width : width);
+    if (len < target)
+        pad = target - len;
+
+    reserveOutBuf(out, len * 6 + pad);
+    if (width > 0) {
+        memset(out->data + out->len, ' ', pad);
+        out->len += pad;
+    }
+    if (escapeHtml) {
+        for (size_t i = 0; i < len; i++) {
+            switch (value[i]) {
+            case '<': appendOutBuf(out, "&lt;", 4); break;
+            case '>': appendOutBuf(out, "&gt;", 4); break;
+            case '&': appendOutBuf(out, "&amp;", 5); break;
+            case '"': appendOutBuf(out, "&quot;", 6); break;
+            case '\'': appendOutBuf(out, "&#39;", 5); break;
+            default: out->data[out->len++] = value[i];
+            }
+        }
+    } else {
+        memcpy(out->data + out->len, value, len);
+        out->len += len;
+    }
+    if (width < 0) {
+        memset(out->data + out->len, ' ', pad);
+        out->len += pad;
+    }
+}
+
+// Instantiates a compiled template for one invoice by concatenating its chunks
+void renderTemplate(const InvoiceTemplate *t, const InvoiceView *v, OutBuf *out) {
+    int item = 0;
+    for (int i = 0; i < t->opCount; i++) {
+        const TemplateOp *op = &t->ops[i];
+        char number[32];
+        const char *value = number;
+        int len = 0;
+
+        switch (op->type) {
+        case OP_LITERAL:
+            appendOutBuf(out, t->text + op->offset, op->len);
+            continue;
+        case OP_ITEMS_BEGIN:
+            item = 0;
+            if (v->count == 0)
+                i = op->jump;
+            continue;
+        case OP_ITEMS_END:
+            // Jump back to the first op inside the section for the next item
+            if (++item < v->count) {
+                while (t->ops[i].type != OP_ITEMS_BEGIN)
+                    i--;
+            }
+            continue;
+        case OP_FIELD:
+            break;
+        }
+
+        const Item *it = &v->items[item];
+        switch (op->field) {
+        case FIELD_DATE: value = v->date; len = strlen(value); break;
+        case FIELD_BUYER_NAME: value = v->buyer->name; len = strlen(value); break;
+        case FIELD_BUYER_PHONE: value = v->buyer->phone; len = strlen(value); break;
+        case FIELD_BUYER_EMAIL: value = v->buyer->email; len = strlen(value); break;
+        case FIELD_ITEM_NAME: value = it->name; len = strlen(value); break;
+        case FIELD_ITEM_QTY: len = snprintf(number, sizeof(number), "%d", it->quantity); break;
+        case FIELD_ITEM_PRICE: len = snprintf(number, sizeof(number), "%.2f", it->price); break;
+        case FIELD_ITEM_TOTAL: len = snprintf(number, sizeof(number), "%.2f", it->total); break;
+        case FIELD_SUBTOTAL: len = snprintf(number, sizeof(number), "%.2f", v->subtotal); break;
+        case FIELD_TAX_RATE: value = v->taxRate; len = strlen(value); break;
+        case FIELD_TAX: len = snprintf(number, sizeof(number), "%.2f", v->tax); break;
+        case FIELD_GRAND_TOTAL: len = snprintf(number, sizeof(number), "%.2f", v->grandTotal); break;
+        default: break;
+        }
+        appendField(out, value, len, op->width, t->escapeHtml);
+    }
+}
+
+// Appends printf-style text to a buffer
+void appendFormat(OutBuf *out, const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    int needed = vsnprintf(NULL, 0, fmt, args);
+    va_end(args);
+
+    reserveOutBuf(out, needed + 1);
+    va_start(args, fmt);
+    vsnprintf(out->data + out->len, needed + 1, fmt, args);
+    va_end(args);
+    out->len += needed;
+}
+
+// Writes plain text as a minimal PDF: Courier text on A4 pages, no external libraries
+void writePdfDocument(const char *text, size_t len, OutBuf *out) {
+    const int linesPerPage = PDF_LINES_PER_PAGE;
+    int lines = 1;
+    for (size_t i = 0; i + 1 < len; i++)
+        lines += text[i] == '\n';
+    int pages = (lines + linesPerPage - 1) / linesPerPage;
+
+    // Objects: 1 catalog, 2 page tree, 3 font, then a page and its content stream per page
+    int objects = 3 + 2 * pages;
+    size_t *offsets = malloc((objects + 1) * sizeof(size_t));
+
+    appendFormat(out, "%%PDF-1.4\n");
+    offsets[1] = out->len;
+    appendFormat(out, "1 0 obj\n<< /Type /Catalog /Pages 2 0 R >>\nendobj\n");
+    offsets[2] = out->len;
+    appendFormat(out, "2 0 obj\n<< /Type /Pages /Count %d /Kids [", pages);
+    for (int p = 0; p < pages; p++)
+        appendFormat(out, " %d 0 R", 4 + 2 * p);
+    appendFormat(out, " ] >>\nendobj\n");
+    offsets[3] = out->len;
+    appendFormat(out, "3 0 obj\n<< /Type /Font /Subtype /Type1 /BaseFont /Courier >>\nendobj\n");
+
+    OutBuf stream = {0};
+    const char *line = text;
+    const char *end = text + len;
+    for (int p = 0; p < pages; p++) {
+        // Content stream: one Tj per line, moving down with T*
+        stream.len = 0;
+        appendFormat(&stream, "BT /F1 10 Tf 12 TL 50 800 Td\n");
+        for (int l = 0; l < linesPerPage && line < end; l++) {
+            const char *nl = memchr(line, '\n', end - line);
+            const char *lineEnd = nl ? nl : end;
+            appendOutBuf(&stream, "(", 1);
+            for (const char *c = line; c < lineEnd; c++) {
+                if (*c == '(' || *c == ')' || *c == '\\')
+                    appendOutBuf(&stream, "\\", 1);
+                if (*c != '\r')
+                    appendOutBuf(&stream, c, 1);
+            }
+            appendOutBuf(&stream, ") Tj T*\n", 8);
+            line = nl ? nl + 1 : end;
+        }
+        appendFormat(&stream, "ET\n");
+
+        offsets[4 + 2 * p] = out->len;
+        appendFormat(out, "%d 0 obj\n<< /Type /Page /Parent 2 0 R /MediaBox [0 0 595 842] "
+                          "/Resources << /Font << /F1 3 0 R >> >> /Contents %d 0 R >>\nendobj\n",
+                     4 + 2 * p, 5 + 2 * p);
+        offsets[5 + 2 * p] = out->len;
+        appendFormat(out, "%d 0 obj\n<< /Length %zu >>\nstream\n", 5 + 2 * p, stream.len);
+        appendOutBuf(out, stream.data, stream.len);
+        appendFormat(out, "endstream\nendobj\n");
+    }
+    free(stream.data);
+
+    // Cross-reference table and trailer
+    size_t xref = out->len;
+    appendFormat(out, "xref\n0 %d\n0000000000 65535 f \n", objects + 1);
+    for (int i = 1; i <= objects; i++)
+        appendFormat(out, "%010zu 00000 n \n", offsets[i]);
+    appendFormat(out, "trailer\n<< /Size %d /Root 1 0 R >>\nstartxref\n%zu\n%%%%EOF\n", objects + 1, xref);
+    free(offsets);
+}
+
+// Scratch buffers each thread renders into, freed when the thread exits
+typedef struct {
+    OutBuf pdfText;            // renderInvoice: text layout of a PDF
+    OutBuf body;               // writeInvoiceBody
+    OutBuf document;           // writeInvoiceDocument
+} RenderScratch;
+
+static pthread_key_t renderScratchKey;
+static pthread_once_t renderScratchOnce = PTHREAD_ONCE_INIT;
+
+void freeRenderScratch(void *arg) {
+    RenderScratch *s = arg;
+    free(s->pdfText.data);
+    free(s->body.data);
+    free(s->document.data);
+    free(s);
+}
+
+void createRenderScratchKey() {
+    pthread_key_create(&renderScratchKey, freeRenderScratch);
+}
+
+// This thread's scratch buffers, created on first use
+RenderScratch *renderScratch() {
+    pthread_once(&renderScratchOnce, createRenderScratchKey);
+    RenderScratch *s = pthread_getspecific(renderScratchKey);
+    if (!s) {
+        s = calloc(1, sizeof(RenderScratch));
+        if (!s || pthread_setspecific(renderScratchKey, s) != 0) {
+            printf("Out of memory rendering invoice.\n");
+            exit(1);
+        }
+    }
+    return s;
+}
+
+// Renders an invoice in the given format, appending to `out`
+void renderInvoice(InvoiceFormat format, const Item items[], int count, const Buyer *buyer, time_t issued,
+                   OutBuf *out) {
+    pthread_once(&templatesOnce, compileInvoiceTemplates);
+
+    InvoiceView view;
+    buildInvoiceView(&view, items, count, buyer, issued);
+    if (format != FORMAT_PDF) {
+        renderTemplate(invoiceTemplates[format], &view, out);
+        return;
+    }
+
+    // PDF pages carry the text layout
+    OutBuf *text = &renderScratch()->pdfText;
+    text->len = 0;
+    renderTemplate(invoiceTemplates[FORMAT_TEXT], &view, text);
+    writePdfDocument(text->data, text->len, out);
+}
+
+// Writes the text layout of an invoice (header, buyer, items, totals) to a stream
+void writeInvoiceBody(FILE *fptr, Item items[], int count, Buyer buyer, time_t issued) {
+    OutBuf *buf = &renderScratch()->body;
+    buf->len = 0;
+    renderInvoice(FORMAT_TEXT, items, count, &buyer, issued, buf);
+    fwrite(buf->data, 1, buf->len, fptr);
+}
+
+// ---------------------------------------------------------------------------
+// Product catalog
+// ---------------------------------------------------------------------------
+
+// Longest SKU accepted from the catalog or from invoice lines
+#define CATALOG_MAX_SKU 32
+
+// GST rate for each catalog tax class
+static const float taxClassRates[TAX_CLASS_COUNT] = {0.0f, 0.05f, 0.12f, 0.18f, 0.28f};
+
+// One hash table slot (16 bytes). The product name is stored in the pool right
+// after the SKU's terminating NUL, so a single offset locates both strings.
+typedef struct {
+    uint32_t hash;             // SKU hash, 0 marks an empty slot
+    uint32_t offset;           // Offset of the SKU in the string pool
+    float price;               // Unit price
+    uint16_t skuLen;           // SKU length (name starts at offset + skuLen + 1)
+    uint8_t taxClass;          // Index into taxClassRates
+    uint8_t reserved;
+} CatalogSlot;
+
+// Immutable product catalog: open-addressing (linear probing) table + string pool
+typedef struct {
+    CatalogSlot *slots;
+    size_t mask;               // Capacity - 1 (capacity is a power of two)
+    size_t count;              // Number of products
+    char *pool;                // SKU and name strings
+    size_t poolSize;
+} Catalog;
+
+// Active catalog; the lock is only held to swap the pointer or to read through it
+static Catalog *activeCatalog;
+static pthread_rwlock_t catalogLock = PTHREAD_RWLOCK_INITIALIZER;
+
+// FNV-1a hash of a SKU, never 0 so that 0 can mark empty slots
+uint32_t hashSku(const char *sku, size_t len) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)sku[i];
+        h *= 16777619u;
+    }
+    return h ? h : 1;
+}
+
+// Finds the slot for a SKU: either the matching product or the empty slot where it belongs
+CatalogSlot *findCatalogSlot(const Catalog *cat, const char *sku, size_t len, uint32_t hash) {
+    size_t i = hash & cat->mask;
+    while (1) {
+        CatalogSlot *slot = &cat->slots[i];
+        if (slot->hash == 0)
+            return slot;
+        if (slot->hash == hash && slot->skuLen == len && memcmp(cat->pool + slot->offset, sku, len) == 0)
+            return slot;
+        i = (i + 1) & cat->mask;
+    }
+}
+
+// Looks up a SKU, returning NULL if the catalog does not contain it
+const CatalogSlot *lookupCatalog(const Catalog *cat, const char *sku) {
+    size_t len = strlen(sku);
+    const CatalogSlot *slot = findCatalogSlot(cat, sku, len, hashSku(sku, len));
+    return slot->hash ? slot : NULL;
+}
+
+// Frees a catalog and its storage
+void freeCatalog(Catalog *cat) {
+    if (!cat)
+        return;
+    free(cat->slots);
+    free(cat->pool);
+    free(cat);
+}
+
+// Loads a catalog file into a new table. Returns NULL on error.
+Catalog *loadCatalog(const char *path) {
+    FILE *fp = fopen(path, "rb");
+    if (!fp) {
+        printf("Error opening %s\n", path);
+        return NULL;
+    }
+
+    // Read the whole file at once and parse it in place
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    // Slots address the pool with 32-bit offsets, and the pool never outgrows the file
+    if (size < 0 || (unsigned long long)size >= UINT32_MAX) {
+        printf("Error: %s is larger than the 4 GB a catalog can hold\n", path);
+        fclose(fp);
+        return NULL;
+    }
+    char *data = malloc(size + 1);
+    if (!data || fread(data, 1, size, fp) != (size_t)size) {
+        printf("Error reading %s\n", path);
+        free(data);
+        fclose(fp);
+        return NULL;
+    }
+    fclose(fp);
+    data[size] = '\0';
+
+    // Size the table for a load factor of at most 2/3
+    size_t lines = 1;
+    for (char *p = data; (p = memchr(p, '\n', data + size - p)) != NULL; p++)
+        lines++;
+    size_t capacity = 16;
+    while (capacity < lines + lines / 2)
+        capacity <<= 1;
+
+    Catalog *cat = calloc(1, sizeof(Catalog));
+    if (cat) {
+        cat->slots = calloc(capacity, sizeof(CatalogSlot));
+        cat->pool = malloc(size + 1);   // Strings never outgrow the file itself
+    }
+    if (!cat || !cat->slots || !cat->pool) {
+        printf("Out of memory loading %s\n", path);
+        freeCatalog(cat);
+        free(data);
+        return NULL;
+    }
+    cat->mask = capacity - 1;
+
+    char *line = data;
+    while (line < data + size) {
+        char *end = memchr(line, '\n', data + size - line);
+        if (!end)
+            end = data + size;
+        char *next = end + 1;
+        if (end > line && end[-1] == '\r')
+            end--;
+        *end = '\0';
+
+        // SKU,name,price,taxClass
+        char *comma1 = strchr(line, ',');
+        char *comma2 = comma1 ? strchr(comma1 + 1, ',') : NULL;
+        char *priceEnd = NULL;
+        float price = 0;
+        if (comma2) {
+            price = strtof(comma2 + 1, &priceEnd);
+        }
+        // Skips blank lines, headers and malformed rows
+        if (comma2 && priceEnd != comma2 + 1 && comma1 - line > 0 && comma1 - line < CATALOG_MAX_SKU) {
+            size_t skuLen = comma1 - line;
+            size_t nameLen = comma2 - comma1 - 1;
+            int taxClass = *priceEnd == ',' ? atoi(priceEnd + 1) : 3;
+            if (taxClass < 0 || taxClass >= TAX_CLASS_COUNT)
+                taxClass = 3;
+
+            uint32_t hash = hashSku(line, skuLen);
+            CatalogSlot *slot = findCatalogSlot(cat, line, skuLen, hash);
+            if (slot->hash == 0) {
+                // New SKU: append "sku\0name\0" to the pool
+                slot->hash = hash;
+                slot->offset = (uint32_t)cat->poolSize;
+                slot->skuLen = (uint16_t)skuLen;
+                memcpy(cat->pool + cat->poolSize, line, skuLen);
+                cat->pool[cat->poolSize + skuLen] = '\0';
+                memcpy(cat->pool + cat->poolSize + skuLen + 1, comma1 + 1, nameLen);
+                cat->pool[cat->poolSize + skuLen + 1 + nameLen] = '\0';
+                cat->poolSize += skuLen + nameLen + 2;
+                cat->count++;
+            }
+            // A repeated SKU keeps its first name but takes the latest price
+            slot->price = price;
+            slot->taxClass = (uint8_t)taxClass;
+        }
+        line = next;
+    }
+
+    free(data);
+    return cat;
+}
+
+// Loads a catalog and atomically makes it the active one. Returns 1 on success.
+int reloadCatalog(const char *path) {
+    // The expensive part happens without holding the lock
+    Catalog *fresh = loadCatalog(path);
+    if (!fresh)
+        return 0;
+
+    pthread_rwlock_wrlock(&catalogLock);
+    Catalog *old = activeCatalog;
+    activeCatalog = fresh;
+    pthread_rwlock_unlock(&catalogLock);
+
+    // No reader can still see the old table once the write lock was granted
+    freeCatalog(old);
+    return 1;
+}
+
+// Number of products in the active catalog
+size_t catalogSize() {
+    pthread_rwlock_rdlock(&catalogLock);
+    size_t count = activeCatalog ? activeCatalog->count : 0;
+    pthread_rwlock_unlock(&catalogLock);
+    return count;
+}
+
+// Resolves (SKU, quantity) lines into invoice items without printing anything.
+// Unknown SKUs are skipped and flagged in `unknown`. Returns the number resolved,
+// or -1 when no catalog is loaded.
+int resolveCatalogLines(char skus[][CATALOG_MAX_SKU], const int quantities[], int count, Item items[],
+                        unsigned char unknown[]) {
+    int resolved = 0;
+
+    pthread_rwlock_rdlock(&catalogLock);
+    if (!activeCatalog) {
+        pthread_rwlock_unlock(&catalogLock);
+        return -1;
+    }
+    for (int i = 0; i < count; i++) {
+        const CatalogSlot *slot = lookupCatalog(activeCatalog, skus[i]);
+        unknown[i] = slot == NULL;
+        if (!slot)
+            continue;
+        Item *item = &items[resolved++];
+        snprintf(item->name, sizeof(item->name), "%s", activeCatalog->pool + slot->offset + slot->skuLen + 1);
+        item->quantity = quantities[i];
+        item->price = slot->price;
+        item->total = item->quantity * item->price;
+        item->taxRate = taxClassRates[slot->taxClass];
+    }
+    pthread_rwlock_unlock(&catalogLock);
+
+    return resolved;
+}
+
+// Resolves (SKU, quantity) lines for the menu, reporting unknown SKUs. Returns the number resolved.
+int resolveCatalogItems(char skus[][CATALOG_MAX_SKU], const int quantities[], int count, Item items[]) {
+    unsigned char unknown[MAX_ITEMS];
+    int resolved = resolveCatalogLines(skus, quantities, count, items, unknown);
+    if (resolved < 0) {
+        printf("No product catalog loaded.\n");
+        return 0;
+    }
+    for (int i = 0; i < count; i++) {
+        if (unknown[i])
+            printf("Unknown SKU: %s\n", skus[i]);
+    }
+    return resolved;
+}
+
+// Seconds elapsed since a CLOCK_MONOTONIC timestamp
+double secondsSince(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+// Shared state for the reader thread running during the hot-reload benchmark
+typedef struct {
+    long skus;                 // SKUs in the synthetic catalog
+    atomic_int stop;           // Set when the reload is done
+    long lookups;              // Lookups performed
+    double maxStall;           // Longest single resolve, in seconds
+} ReloadProbe;
+
+// Resolves random SKUs continuously, recording the slowest resolve
+void *reloadProbeThread(void *arg) {
+    ReloadProbe *probe = arg;
+    char sku[1][CATALOG_MAX_SKU];
+    int qty[1] = {1};
+    Item item;
+    unsigned int seed = 12345;
+
+    while (!atomic_load(&probe->stop)) {
+        snprintf(sku[0], CATALOG_MAX_SKU, "SKU%08ld", (long)(rand_r(&seed) % probe->skus));
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        unsigned char unknown[1];
+        resolveCatalogLines(sku, qty, 1, &item, unknown);
+        double elapsed = secondsSince(&start);
+        if (elapsed > probe->maxStall)
+            probe->maxStall = elapsed;
+        probe->lookups++;
+    }
+    return NULL;
+}
+
+// Benchmarks catalog load, lookup latency and hot reload on a synthetic catalog
+int runCatalogBenchmark(long skus) {
+    char path[] = "/tmp/catalog_benchXXXXXX";
+    int fd = mkstemp(path);
+    FILE *fp = fd >= 0 ? fdopen(fd, "w") : NULL;
+    if (!fp) {
+        printf("Could not create a temporary catalog file.\n");
+        return 1;
+    }
+
+    printf("Writing synthetic catalog with %ld SKUs...\n", skus);
+    fprintf(fp, "sku,name,price,tax_class\n");
+    for (long i = 0; i < skus; i++)
+        fprintf(fp, "SKU%08ld,Product %ld,%ld.%02ld,%ld\n", i, i, 1 + i % 997, i % 100, i % TAX_CLASS_COUNT);
+    fclose(fp);
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    Catalog *cat = loadCatalog(path);
+    double loadSeconds = secondsSince(&start);
+    if (!cat) {
+        unlink(path);
+        return 1;
+    }
+    printf("Load time     : %.3f s (%.0f SKUs/s)\n", loadSeconds, skus / loadSeconds);
+    printf("Products      : %zu\n", cat->count);
+    printf("Memory        : %.1f MB table + %.1f MB string pool\n",
+           (cat->mask + 1) * sizeof(CatalogSlot) / 1e6, cat->poolSize / 1e6);
+
+    // Random lookups of SKUs that exist, then of SKUs that do not. The key set is
+    // large enough that most probes miss the CPU cache, as they would in production.
+    long lookups = 10000000;
+    int keyCount = 1 << 20;
+    char (*keys)[CATALOG_MAX_SKU] = malloc(keyCount * sizeof(*keys));
+    unsigned int seed = 42;
+    for (int i = 0; i < keyCount; i++)
+        snprintf(keys[i], CATALOG_MAX_SKU, "SKU%08ld", (long)(rand_r(&seed) % skus));
+
+    double checksum = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long i = 0; i < lookups; i++) {
+        const CatalogSlot *slot = lookupCatalog(cat, keys[i & (keyCount - 1)]);
+        checksum += slot ? slot->price : 0;
+    }
+    double hitSeconds = secondsSince(&start);
+
+    for (int i = 0; i < keyCount; i++)
+        snprintf(keys[i], CATALOG_MAX_SKU, "MISS%08d", i);
+    long misses = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long i = 0; i < lookups; i++)
+        misses += lookupCatalog(cat, keys[i & (keyCount - 1)]) == NULL;
+    double missSeconds = secondsSince(&start);
+
+    printf("Lookup (hit)  : %.1f ns/lookup (checksum %.0f)\n", hitSeconds * 1e9 / lookups, checksum);
+    printf("Lookup (miss) : %.1f ns/lookup (%ld misses)\n", missSeconds * 1e9 / lookups, misses);
+    free(keys);
+
+    // Hot reload while another thread keeps resolving invoice lines
+    pthread_rwlock_wrlock(&catalogLock);
+    Catalog *old = activeCatalog;
+    activeCatalog = cat;
+    pthread_rwlock_unlock(&catalogLock);
+    freeCatalog(old);
+
+    ReloadProbe probe = {0};
+    probe.skus = skus;
+    pthread_t reader;
+    pthread_create(&reader, NULL, reloadProbeThread, &probe);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int ok = reloadCatalog(path);
+    double reloadSeconds = secondsSince(&start);
+
+    atomic_store(&probe.stop, 1);
+    pthread_join(reader, NULL);
+    printf("Hot reload    : %.3f s, %ld resolves during reload, longest resolve %.1f us\n",
+           reloadSeconds, probe.lookups, probe.maxStall * 1e6);
+
+    unlink(path);
+    return ok ? 0 : 1;
+}
+
+// ---------------------------------------------------------------------------
+// Sales reporting
+// ---------------------------------------------------------------------------
+
+// One invoice line as recorded in the sales ledger (fixed size, 104 bytes)
+typedef struct {
+    int32_t day;               // Invoice date as YYYYMMDD
+    int32_t line;              // Line number within the invoice (0 = first line)
+    int32_t quantity;          // Quantity sold
+    float amount;              // Line total before tax
+    float tax;                 // GST on this line
+    char buyer[40];            // Buyer name (truncated)
+    char item[44];             // Item name (truncated)
+} SalesRecord;
+
+// Running totals for one report key (a day, a buyer or an item)
+typedef struct {
+    char key[48];              // Empty key marks an unused slot
+    uint32_t hash;
+    long invoices;             // Invoices touching this key
+    long quantity;             // Units sold
+    double amount;             // Revenue before tax
+    double tax;                // GST collected
+} SalesTotal;
+
+// Open-addressing hash map from report key to running totals
+typedef struct {
+    SalesTotal *entries;
+    size_t mask;               // Capacity - 1 (capacity is a power of two)
+    size_t count;
+} SalesMap;
+
+// The three aggregations produced by a report
+typedef struct {
+    SalesMap byDay;
+    SalesMap byBuyer;
+    SalesMap byItem;
+    long records;              // Ledger records aggregated so far
+    uint64_t ledgerDev, ledgerIno;  // Which ledger file they came from ...
+    uint32_t firstSum, lastSum;     // ... and checksums of its first and last aggregated records
+} SalesReport;
+
+// Copies a string into a smaller fixed-size field, truncating if needed
+void copyTruncated(char *dst, const char *src, size_t size) {
+    size_t len = strnlen(src, size - 1);
+    memcpy(dst, src, len);
+    dst[len] = '\0';
+}
+
+// Invoice date as YYYYMMDD, the day key of the sales ledger
+int salesDay(time_t when) {
+    struct tm t;
+    localtime_r(&when, &t);
+    return (t.tm_year + 1900) * 10000 + (t.tm_mon + 1) * 100 + t.tm_mday;
+}
+
+// Fills one ledger record per invoice line
+void buildSalesRecords(const Item items[], int count, const Buyer *buyer, int day, SalesRecord *records) {
+    memset(records, 0, count * sizeof(SalesRecord));
+    for (int i = 0; i < count; i++) {
+        records[i].day = day;
+        records[i].line = i;
+        records[i].quantity = items[i].quantity;
+        records[i].amount = items[i].total;
+        records[i].tax = items[i].total * items[i].taxRate;
+        copyTruncated(records[i].buyer, buyer->name, sizeof(records[i].buyer));
+        copyTruncated(records[i].item, items[i].name, sizeof(records[i].item));
+    }
+}
+
+// Appends ledger records in one write. Returns 1 on success.
+int writeSalesRecords(const SalesRecord *records, size_t count) {
+    // O_APPEND keeps concurrent writers from interleaving inside a write
+    int fd = open(SALES_LEDGER, O_WRONLY | O_APPEND | O_CREAT, 0644);
+    int ok = fd >= 0 && write(fd, records, count * sizeof(SalesRecord)) == (ssize_t)(count * sizeof(SalesRecord));
+    if (fd >= 0)
+        close(fd);
+    return ok;
+}
+
+// Appends the lines of a freshly generated invoice to the sales ledger in one write
+void appendSalesRecords(Item items[], int count, Buyer buyer) {
+    if (count <= 0)
+        return;
+
+    SalesRecord *records = malloc(count * sizeof(SalesRecord));
+    if (!records)
+        return;
+    buildSalesRecords(items, count, &buyer, salesDay(time(NULL)), records);
+    if (!writeSalesRecords(records, count))
+        printf("Warning: could not update %s\n", SALES_LEDGER);
+    free(records);
+}
+
+// Allocates an empty map with room for at least `capacity` keys
+int initSalesMap(SalesMap *map, size_t capacity) {
+    size_t size = 64;
+    while (size < capacity * 2)
+        size <<= 1;
+    map->entries = calloc(size, sizeof(SalesTotal));
+    map->mask = size - 1;
+    map->count = 0;
+    return map->entries != NULL;
+}
+
+// Key that empty buyer or item names are totalled under
+#define SALES_EMPTY_KEY "(none)"
+
+// Returns the totals for a key, inserting a zeroed entry if it is new. An empty
+// key marks a free slot, so empty names are stored under SALES_EMPTY_KEY.
+SalesTotal *salesMapEntry(SalesMap *map, const char *key, size_t len) {
+    if (len == 0) {
+        key = SALES_EMPTY_KEY;
+        len = sizeof(SALES_EMPTY_KEY) - 1;
+    }
+
+    // Grow at 50% load so probe sequences stay short
+    if ((map->count + 1) * 2 > map->mask + 1) {
+        SalesMap grown;
+        if (!initSalesMap(&grown, map->mask + 1))
+            return NULL;
+        for (size_t i = 0; i <= map->mask; i++) {
+            SalesTotal *e = &map->entries[i];
+            if (!e->key[0])
+                continue;
+            size_t j = e->hash & grown.mask;
+            while (grown.entries[j].key[0])
+                j = (j + 1) & grown.mask;
+            grown.entries[j] = *e;
+        }
+        grown.count = map->count;
+        free(map->entries);
+        *map = grown;
+    }
+
+    if (len >= sizeof(map->entries[0].key))
+        len = sizeof(map->entries[0].key) - 1;
+    uint32_t hash = hashSku(key, len);
+    size_t i = hash & map->mask;
+    while (map->entries[i].key[0]) {
+        SalesTotal *e = &map->entries[i];
+        if (e->hash == hash && strncmp(e->key, key, len) == 0 && e->key[len] == '\0')
+            return e;
+        i = (i + 1) & map->mask;
+    }
+
+    SalesTotal *e = &map->entries[i];
+    memcpy(e->key, key, len);
+    e->key[len] = '\0';
+    e->hash = hash;
+    map->count++;
+    return e;
+}
+
+// Adds one ledger record to a set of totals; `newInvoice` says whether the
+// record starts an invoice not yet counted under this key
+void addSalesTotal(SalesTotal *e, const SalesRecord *r, int newInvoice) {
+    if (!e)
+        return;
+    e->invoices += newInvoice;
+    e->quantity += r->quantity;
+    e->amount += r->amount;
+    e->tax += r->tax;
+}
+
+// Adds every entry of `from` into `into`
+void mergeSalesMap(SalesMap *into, const SalesMap *from) {
+    for (size_t i = 0; i <= from->mask; i++) {
+        const SalesTotal *src = &from->entries[i];
+        if (!src->key[0])
+            continue;
+        SalesTotal *dst = salesMapEntry(into, src->key, strlen(src->key));
+        if (!dst)
+            continue;
+        dst->invoices += src->invoices;
+        dst->quantity += src->quantity;
+        dst->amount += src->amount;
+        dst->tax += src->tax;
+    }
+}
+
+int initSalesReport(SalesReport *report) {
+    memset(report, 0, sizeof(*report));
+    return initSalesMap(&report->byDay, 512) && initSalesMap(&report->byBuyer, 1024) &&
+           initSalesMap(&report->byItem, 1024);
+}
+
+void freeSalesReport(SalesReport *report) {
+    free(report->byDay.entries);
+    free(report->byBuyer.entries);
+    free(report->byItem.entries);
+}
+
+// One partition of the ledger, aggregated by its own thread into private maps
+typedef struct {
+    const SalesRecord *records;
+    long count;
+    SalesReport partial;
+    int threaded;              // Ran on its own thread (else inline) and needs joining
+} SalesPartition;
+
+// Aggregates one ledger partition
+void *aggregateSalesPartition(void *arg) {
+    SalesPartition *part = arg;
+    char dayKey[11] = "0000-00-00";
+    int lastDay = -1;
+
+    for (long i = 0; i < part->count; i++) {
+        const SalesRecord *r = &part->records[i];
+
+        // Format YYYY-MM-DD by hand, only when the day changes
+        if (r->day != lastDay) {
+            int d = r->day;
+            dayKey[9] = '0' + d % 10; d /= 10;
+            dayKey[8] = '0' + d % 10; d /= 10;
+            dayKey[6] = '0' + d % 10; d /= 10;
+            dayKey[5] = '0' + d % 10; d /= 10;
+            for (int k = 3; k >= 0; k--) {
+                dayKey[k] = '0' + d % 10;
+                d /= 10;
+            }
+            lastDay = r->day;
+        }
+
+        // An invoice counts once per day and buyer, and once per item line
+        addSalesTotal(salesMapEntry(&part->partial.byDay, dayKey, 10), r, r->line == 0);
+        addSalesTotal(salesMapEntry(&part->partial.byBuyer, r->buyer, strnlen(r->buyer, sizeof(r->buyer))), r, r->line == 0);
+        addSalesTotal(salesMapEntry(&part->partial.byItem, r->item, strnlen(r->item, sizeof(r->item))), r, 1);
+    }
+    part->partial.records = part->count;
+    return NULL;
+}
+
+// Checksum of ledger record `index`, or 0 if it cannot be read
+uint32_t salesRecordSum(int fd, long index) {
+    SalesRecord r;
+    if (pread(fd, &r, sizeof(r), (off_t)index * sizeof(r)) != (ssize_t)sizeof(r))
+        return 0;
+    return hashSku((const char *)&r, sizeof(r));
+}
+
+// Aggregates ledger records [from, end) into the report using `threads` partitions.
+// If the report came from a different ledger (replaced, truncated or rewritten
+// since), it is cleared and the whole ledger aggregated again.
+// Returns the number of new records, or -1 on error.
+long aggregateSalesLedger(const char *ledgerPath, SalesReport *report, long from, int threads) {
+    int fd = open(ledgerPath, O_RDONLY);
+    if (fd < 0)
+        return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return -1;
+    }
+    long total = st.st_size / sizeof(SalesRecord);
+    if (from > 0 && (report->ledgerDev != (uint64_t)st.st_dev || report->ledgerIno != (uint64_t)st.st_ino ||
+                     from > total || report->firstSum != salesRecordSum(fd, 0) ||
+                     report->lastSum != salesRecordSum(fd, from - 1))) {
+        freeSalesReport(report);
+        if (!initSalesReport(report)) {
+            close(fd);
+            return -1;
+        }
+        from = 0;
+    }
+    report->ledgerDev = (uint64_t)st.st_dev;
+    report->ledgerIno = (uint64_t)st.st_ino;
+    long pending = total - from;
+    if (pending == 0) {
+        close(fd);
+        return 0;
+    }
+    report->firstSum = salesRecordSum(fd, 0);
+    report->lastSum = salesRecordSum(fd, total - 1);
+
+    SalesRecord *records = mmap(NULL, total * sizeof(SalesRecord), PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (records == MAP_FAILED)
+        return -1;
+
+    if (threads < 1)
+        threads = 1;
+    if (threads > pending)
+        threads = (int)pending;
+
+    SalesPartition *parts = calloc(threads, sizeof(SalesPartition));
+    pthread_t *tids = calloc(threads, sizeof(pthread_t));
+    int ok = parts && tids, ready = 0;
+    while (ok && ready < threads)
+        ok = initSalesReport(&parts[ready++].partial);
+    if (!ok) {
+        for (int t = 0; t < ready; t++)
+            freeSalesReport(&parts[t].partial);
+        free(parts);
+        free(tids);
+        munmap(records, total * sizeof(SalesRecord));
+        return -1;
+    }
+    long offset = from;
+    for (int t = 0; t < threads; t++) {
+        parts[t].records = records + offset;
+        parts[t].count = pending / threads + (t < pending % threads ? 1 : 0);
+        offset += parts[t].count;
+        parts[t].threaded = pthread_create(&tids[t], NULL, aggregateSalesPartition, &parts[t]) == 0;
+        if (!parts[t].threaded)
+            aggregateSalesPartition(&parts[t]);   // Out of threads: do this partition here
+    }
+
+    // Merge the per-thread maps as each partition finishes
+    for (int t = 0; t < threads; t++) {
+        if (parts[t].threaded)
+            pthread_join(tids[t], NULL);
+        mergeSalesMap(&report->byDay, &parts[t].partial.byDay);
+        mergeSalesMap(&report->byBuyer, &parts[t].partial.byBuyer);
+        mergeSalesMap(&report->byItem, &parts[t].partial.byItem);
+        freeSalesReport(&parts[t].partial);
+    }
+    report->records = from + pending;
+
+    free(parts);
+    free(tids);
+    munmap(records, total * sizeof(SalesRecord));
+    return pending;
+}
+
+// Saves a report so the next incremental run can continue from it
+int saveReportState(const char *statePath, const SalesReport *report) {
+    FILE *fp = fopen(statePath, "wb");
+    if (!fp)
+        return 0;
+    const SalesMap *maps[3] = {&report->byDay, &report->byBuyer, &report->byItem};
+    fwrite(REPORT_STATE_MAGIC, 1, 8, fp);
+    fwrite(&report->ledgerDev, sizeof(report->ledgerDev), 1, fp);
+    fwrite(&report->ledgerIno, sizeof(report->ledgerIno), 1, fp);
+    fwrite(&report->firstSum, sizeof(report->firstSum), 1, fp);
+    fwrite(&report->lastSum, sizeof(report->lastSum), 1, fp);
+    fwrite(&report->records, sizeof(report->records), 1, fp);
+    for (int m = 0; m < 3; m++) {
+        fwrite(&maps[m]->count, sizeof(maps[m]->count), 1, fp);
+        for (size_t i = 0; i <= maps[m]->mask; i++) {
+            if (maps[m]->entries[i].key[0])
+                fwrite(&maps[m]->entries[i], sizeof(SalesTotal), 1, fp);
+        }
+    }
+    fclose(fp);
+    return 1;
+}
+
+// Restores a report saved by saveReportState. Returns 0 if there is no usable state.
+int loadReportState(const char *statePath, SalesReport *report) {
+    FILE *fp = fopen(statePath, "rb");
+    if (!fp)
+        return 0;
+    SalesMap *maps[3] = {&report->byDay, &report->byBuyer, &report->byItem};
+    char magic[8];
+    int ok = fread(magic, 1, 8, fp) == 8 && memcmp(magic, REPORT_STATE_MAGIC, 8) == 0 &&
+             fread(&report->ledgerDev, sizeof(report->ledgerDev), 1, fp) == 1 &&
+             fread(&report->ledgerIno, sizeof(report->ledgerIno), 1, fp) == 1 &&
+             fread(&report->firstSum, sizeof(report->firstSum), 1, fp) == 1 &&
+             fread(&report->lastSum, sizeof(report->lastSum), 1, fp) == 1 &&
+             fread(&report->records, sizeof(report->records), 1, fp) == 1;
+    for (int m = 0; ok && m < 3; m++) {
+        size_t count;
+        ok = fread(&count, sizeof(count), 1, fp) == 1;
+        for (size_t i = 0; ok && i < count; i++) {
+            SalesTotal e;
+            ok = fread(&e, sizeof(e), 1, fp) == 1;
+            if (ok) {
+                e.key[sizeof(e.key) - 1] = '\0';
+                SalesTotal *dst = salesMapEntry(maps[m], e.key, strlen(e.key));
+                if (dst)
+                    *dst = e;
+            }
+        }
+    }
+    fclose(fp);
+    return ok;
+}
+
+// Sorting helpers for printing a report
+int compareTotalsByKey(const void *a, const void *b) {
+    return strcmp(((const SalesTotal *)a)->key, ((const SalesTotal *)b)->key);
+}
+
+int compareTotalsByAmount(const void *a, const void *b) {
+    double x = ((const SalesTotal *)a)->amount, y = ((const SalesTotal *)b)->amount;
+    return (x < y) - (x > y);
+}
+
+// Prints one aggregation, sorted, showing at most `limit` rows
+void printSalesMap(const char *title, const SalesMap *map, int byAmount, size_t limit) {
+    SalesTotal *rows = malloc((map->count + 1) * sizeof(SalesTotal));
+    size_t n = 0;
+    for (size_t i = 0; i <= map->mask; i++) {
+        if (map->entries[i].key[0])
+            rows[n++] = map->entries[i];
+    }
+    qsort(rows, n, sizeof(SalesTotal), byAmount ? compareTotalsByAmount : compareTotalsByKey);
+
+    printf("\n--- %s ---\n", title);
+    printf("%-24s %-10s %-10s %-14s %-12s\n", title, "Invoices", "Qty", "Revenue", "GST");
+    for (size_t i = 0; i < n && i < limit; i++) {
+        printf("%-24s %-10ld %-10ld %-14.2f %-12.2f\n", rows[i].key, rows[i].invoices, rows[i].quantity,
+               rows[i].amount, rows[i].tax);
+    }
+    if (n > limit)
+        printf("... and %zu more\n", n - limit);
+    free(rows);
+}
+
+// Runs a sales report over the ledger. In incremental mode only records added
+// since the last saved report are scanned. Returns 0 on success.
+int runSalesReport(const char *ledgerPath, const char *statePath, int incremental, int threads, int print) {
+    SalesReport report;
+    if (!initSalesReport(&report)) {
+        printf("Out of memory for report.\n");
+        return 1;
+    }
+    if (incremental && !loadReportState(statePath, &report)) {
+        freeSalesReport(&report);
+        initSalesReport(&report);
+    }
+
+    long added = aggregateSalesLedger(ledgerPath, &report, report.records, threads);
+    if (added < 0) {
+        printf("Could not read sales ledger %s\n", ledgerPath);
+        freeSalesReport(&report);
+        return 1;
+    }
+
+    if (print) {
+        printf("\n======== SALES REPORT ========\n");
+        printf("Ledger lines: %ld (%ld new)\n", report.records, added);
+        printSalesMap("Day", &report.byDay, 0, 400);
+        printSalesMap("Buyer", &report.byBuyer, 1, 25);
+        printSalesMap("Item", &report.byItem, 1, 25);
+    }
+
+    saveReportState(statePath, &report);
+    freeSalesReport(&report);
+    return 0;
+}
+
+// Benchmarks full and incremental reports on a synthetic ledger
+int runReportBenchmark(long invoices, int threads) {
+    char ledgerPath[] = "/tmp/sales_benchXXXXXX";
+    int fd = mkstemp(ledgerPath);
+    if (fd < 0) {
+        printf("Could not create a temporary ledger.\n");
+        return 1;
+    }
+    char statePath[64];
+    snprintf(statePath, sizeof(statePath), "%s.state", ledgerPath);
+
+    // 3 lines per invoice, 365 days, 10k buyers, 1k items
+    printf("Writing synthetic ledger with %ld invoices...\n", invoices);
+    SalesRecord batch[3 * 1024];
+    unsigned int seed = 7;
+    long written = 0;
+    long extra = invoices / 100;   // Appended later for the incremental run
+    while (written < invoices + extra) {
+        int n = 0;
+        long stop = written < invoices ? invoices : invoices + extra;
+        for (; n < 3 * 1024 && written < stop; written++) {
+            int buyer = rand_r(&seed) % 10000;
+            int day = 20250101 + (int)(written * 365 / (invoices + extra)) % 28 +
+                      (int)(written * 12 / (invoices + extra)) * 100;
+            for (int line = 0; line < 3; line++, n++) {
+                SalesRecord *r = &batch[n];
+                memset(r, 0, sizeof(*r));
+                r->day = day;
+                r->line = line;
+                r->quantity = 1 + rand_r(&seed) % 5;
+                r->amount = r->quantity * (float)(1 + rand_r(&seed) % 500);
+                r->tax = r->amount * (float)TAX_RATE;
+                snprintf(r->buyer, sizeof(r->buyer), "Buyer %d", buyer);
+                snprintf(r->item, sizeof(r->item), "Item %d", rand_r(&seed) % 1000);
+            }
+        }
+        if (write(fd, batch, n * sizeof(SalesRecord)) != (ssize_t)(n * sizeof(SalesRecord))) {
+            printf("Could not write the synthetic ledger: %s\n", strerror(errno));
+            close(fd);
+            unlink(ledgerPath);
+            unlink(statePath);
+            return 1;
+        }
+        if (written == invoices) {
+            // Snapshot point for the incremental run
+            struct timespec start;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            runSalesReport(ledgerPath, statePath, 0, threads, 0);
+            double seconds = secondsSince(&start);
+            printf("Full report        : %.3f s for %ld invoices (%.1f M lines/s, %d threads)\n",
+                   seconds, invoices, invoices * 3 / seconds / 1e6, threads);
+        }
+    }
+    close(fd);
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    runSalesReport(ledgerPath, statePath, 1, threads, 0);
+    double seconds = secondsSince(&start);
+    printf("Incremental report : %.3f s for %ld new invoices\n", seconds, extra);
+
+    unlink(ledgerPath);
+    unlink(statePath);
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Compact invoice segments
+// ---------------------------------------------------------------------------
+
+// Entry tags inside a segment block
+#define SEGMENT_DEFINE 0x01    // Adds a string to the segment dictionary
+#define SEGMENT_INVOICE 0x02   // One invoice record
+// Block flag: payload is LZ-compressed
+#define SEGMENT_COMPRESSED 0x01
+
+// Appends an unsigned LEB128 varint, returning the new length
+size_t putVarint(uint8_t *buf, size_t pos, uint64_t value) {
+    while (value >= 0x80) {
+        buf[pos++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    buf[pos++] = (uint8_t)value;
+    return pos;
+}
+
+// Reads an unsigned varint; returns 0 and leaves *pos alone on truncated input
+int getVarint(const uint8_t *buf, size_t len, size_t *pos, uint64_t *value) {
+    uint64_t result = 0;
+    size_t p = *pos;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (p >= len)
+            return 0;
+        uint8_t b = buf[p++];
+        result |= (uint64_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) {
+            *pos = p;
+            *value = result;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Zigzag mapping so small negative numbers also get short varints
+uint64_t zigzag(int64_t v) { return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63); }
+int64_t unzigzag(uint64_t v) { return (int64_t)(v >> 1) ^ -(int64_t)(v & 1); }
+
+// Writes an LZ77 length continuation (runs of 255 plus a remainder)
+size_t putLzLength(uint8_t *dst, size_t op, size_t len) {
+    while (len >= 255) {
+        dst[op++] = 255;
+        len -= 255;
+    }
+    dst[op++] = (uint8_t)len;
+    return op;
+}
+
+// Compresses a block with a small LZ77 codec (LZ4-style token stream).
+// Returns the compressed size, or 0 if the output would not be smaller.
+size_t lzCompress(const uint8_t *src, size_t n, uint8_t *dst, size_t cap) {
+    uint32_t table[4096] = {0};   // Last position + 1 of each hashed 4-byte sequence
+    size_t ip = 0, anchor = 0, op = 0;
+
+    // The last 5 bytes are always literals, so every match is followed by more input
+    while (n >= 12 && ip + 5 < n - 4) {
+        uint32_t seq;
+        memcpy(&seq, src + ip, 4);
+        uint32_t h = (seq * 2654435761u) >> 20;
+        size_t ref = table[h];
+        table[h] = (uint32_t)ip + 1;
+
+        if (!ref || ip - (ref - 1) > 65535 || memcmp(src + ref - 1, src + ip, 4) != 0) {
+            ip++;
+            continue;
+        }
+        size_t match = ref - 1;
+        size_t len = 4;
+        while (ip + len < n - 5 && src[match + len] == src[ip + len])
+            len++;
+
+        // Token, literals, offset, match length
+        size_t lit = ip - anchor;
+        if (op + lit + lit / 255 + 16 > cap)
+            return 0;
+        dst[op++] = (uint8_t)((lit >= 15 ? 15 : lit) << 4 | (len - 4 >= 15 ? 15 : len - 4));
+        if (lit >= 15)
+            op = putLzLength(dst, op, lit - 15);
+        memcpy(dst + op, src + anchor, lit);
+        op += lit;
+        dst[op++] = (uint8_t)(ip - match);
+        dst[op++] = (uint8_t)((ip - match) >> 8);
+        if (len - 4 >= 15)
+            op = putLzLength(dst, op, len - 4 - 15);
+
+        ip += len;
+        anchor = ip;
+    }
+
+    // Final literal-only sequence
+    size_t lit = n - anchor;
+    if (op + lit + lit / 255 + 2 > cap)
+        return 0;
+    dst[op++] = (uint8_t)((lit >= 15 ? 15 : lit) << 4);
+    if (lit >= 15)
+        op = putLzLength(dst, op, lit - 15);
+    memcpy(dst + op, src + anchor, lit);
+    op += lit;
+    return op < n ? op : 0;
+}
+
+// Decompresses a block produced by lzCompress. Returns the size, or (size_t)-1 if corrupt.
+size_t lzDecompress(const uint8_t *src, size_t n, uint8_t *dst, size_t cap) {
+    size_t ip = 0, op = 0;
+    while (ip < n) {
+        uint8_t token = src[ip++];
+
+        size_t lit = token >> 4;
+        if (lit == 15) {
+            uint8_t b;
+            do {
+                if (ip >= n)
+                    return (size_t)-1;
+                b = src[ip++];
+                lit += b;
+            } while (b == 255);
+        }
+        if (ip + lit > n || op + lit > cap)
+            return (size_t)-1;
+        memcpy(dst + op, src + ip, lit);
+        ip += lit;
+        op += lit;
+        if (ip == n)
+            break;   // The last sequence has no match
+
+        if (ip + 2 > n)
+            return (size_t)-1;
+        size_t offset = src[ip] | (size_t)src[ip + 1] << 8;
+        ip += 2;
+        size_t len = token & 15;
+        if (len == 15) {
+            uint8_t b;
+            do {
+                if (ip >= n)
+                    return (size_t)-1;
+                b = src[ip++];
+                len += b;
+            } while (b == 255);
+        }
+        len += 4;
+        if (offset == 0 || offset > op || op + len > cap)
+            return (size_t)-1;
+        // Byte-wise copy: the match may overlap the bytes it produces
+        for (size_t k = 0; k < len; k++)
+            dst[op + k] = dst[op - offset + k];
+        op += len;
+    }
+    return op;
+}
+
+// Per-segment string dictionary (buyer details and item names), writer side
+typedef struct {
+    uint32_t *slots;           // Dictionary ID + 1 per slot, 0 = empty
+    size_t mask;
+    char **strings;            // Strings by dictionary ID
+    size_t count, cap;
+} SegmentDict;
+
+// Appends invoices to one segment file owned by this process
+typedef struct {
+    FILE *fp;
+    char path[128];
+    int compress;              // Compress blocks when it saves space
+    uint8_t *raw;              // Pending (not yet written) block
+    size_t rawLen, rawCap;
+    SegmentDict dict;
+    long invoices;             // Invoices stored in this segment
+    pthread_mutex_t lock;
+} SegmentWriter;
+
+static SegmentWriter segmentWriter = {.compress = 1, .lock = PTHREAD_MUTEX_INITIALIZER};
+// Store new invoices in segments instead of text files (INVOICE_STORAGE=segment)
+static int useInvoiceSegments;
+
+// Makes sure the pending block has room for `extra` more bytes
+int reserveSegmentBlock(SegmentWriter *w, size_t extra) {
+    if (w->rawLen + extra <= w->rawCap)
+        return 1;
+    size_t cap = w->rawCap ? w->rawCap : 4096;
+    while (cap < w->rawLen + extra)
+        cap *= 2;
+    uint8_t *grown = realloc(w->raw, cap);
+    if (!grown)
+        return 0;
+    w->raw = grown;
+    w->rawCap = cap;
+    return 1;
+}
+
+// Finds the dictionary ID of a string, emitting a DEFINE entry the first time it is
+// seen. Returns 0 (with the writer unchanged) if memory runs out.
+int internSegmentString(SegmentWriter *w, const char *str, uint64_t *id) {
+    SegmentDict *d = &w->dict;
+    size_t len = strlen(str);
+
+    // Grow at 50% load
+    if ((d->count + 1) * 2 > d->mask + 1) {
+        size_t size = d->mask ? (d->mask + 1) * 2 : 1024;
+        uint32_t *slots = calloc(size, sizeof(uint32_t));
+        if (!slots)
+            return 0;
+        for (size_t i = 0; i < d->count; i++) {
+            size_t j = hashSku(d->strings[i], strlen(d->strings[i])) & (size - 1);
+            while (slots[j])
+                j = (j + 1) & (size - 1);
+            slots[j] = (uint32_t)i + 1;
+        }
+        free(d->slots);
+        d->slots = slots;
+        d->mask = size - 1;
+    }
+
+    size_t i = hashSku(str, len) & d->mask;
+    while (d->slots[i]) {
+        const char *known = d->strings[d->slots[i] - 1];
+        if (strcmp(known, str) == 0) {
+            *id = d->slots[i] - 1;
+            return 1;
+        }
+        i = (i + 1) & d->mask;
+    }
+
+    if (d->count == d->cap) {
+        size_t cap = d->cap ? d->cap * 2 : 256;
+        char **grown = realloc(d->strings, cap * sizeof(char *));
+        if (!grown)
+            return 0;
+        d->strings = grown;
+        d->cap = cap;
+    }
+    char *copy = strdup(str);
+    if (!copy || !reserveSegmentBlock(w, len + 11)) {
+        free(copy);
+        return 0;
+    }
+    d->strings[d->count] = copy;
+    d->slots[i] = (uint32_t)d->count + 1;
+
+    w->raw[w->rawLen++] = SEGMENT_DEFINE;
+    w->rawLen = putVarint(w->raw, w->rawLen, len);
+    memcpy(w->raw + w->rawLen, str, len);
+    w->rawLen += len;
+    *id = d->count++;
+    return 1;
+}
+
+// Writes the pending block to the segment file, compressed if that saves space
+int flushSegmentBlock(SegmentWriter *w) {
+    if (!w->fp || w->rawLen == 0)
+        return 1;
+
+    uint8_t *packed = w->compress ? malloc(w->rawLen) : NULL;
+    size_t packedLen = packed ? lzCompress(w->raw, w->rawLen, packed, w->rawLen) : 0;
+
+    uint8_t header[32];
+    size_t h = 0;
+    header[h++] = packedLen ? SEGMENT_COMPRESSED : 0;
+    h = putVarint(header, h, w->rawLen);
+    h = putVarint(header, h, packedLen ? packedLen : w->rawLen);
+
+    int ok = fwrite(header, 1, h, w->fp) == h &&
+             fwrite(packedLen ? packed : w->raw, 1, packedLen ? packedLen : w->rawLen, w->fp) ==
+                 (packedLen ? packedLen : w->rawLen) &&
+             fflush(w->fp) == 0;
+    free(packed);
+    w->rawLen = 0;
+    return ok;
+}
+
+// Opens a new segment file for this process. Segments are never shared between
+// writers, so each one's dictionary can live in memory.
+int openSegmentWriter(SegmentWriter *w, const char *path) {
+    w->fp = fopen(path, "wbx");
+    if (!w->fp)
+        return 0;
+    snprintf(w->path, sizeof(w->path), "%s", path);
+    fwrite(SEGMENT_MAGIC, 1, 8, w->fp);
+    return 1;
+}
+
+// Flushes and closes a segment writer, releasing its dictionary
+void closeSegmentWriter(SegmentWriter *w) {
+    if (!w->fp)
+        return;
+    flushSegmentBlock(w);
+    fclose(w->fp);
+    w->fp = NULL;
+    for (size_t i = 0; i < w->dict.count; i++)
+        free(w->dict.strings[i]);
+    free(w->dict.strings);
+    free(w->dict.slots);
+    free(w->raw);
+    memset(&w->dict, 0, sizeof(w->dict));
+    w->raw = NULL;
+    w->rawLen = w->rawCap = 0;
+    w->invoices = 0;
+}
+
+// Encodes one invoice into the pending block. Callers hold w->lock.
+// Returns 0 if memory runs out (strings it defined stay valid for later invoices).
+int encodeSegmentInvoice(SegmentWriter *w, Item items[], int count, Buyer buyer, time_t issued,
+                         unsigned int worker, unsigned long seq) {
+    uint64_t nameId, phoneId, emailId, itemIds[MAX_ITEMS];
+    if (!internSegmentString(w, buyer.name, &nameId) || !internSegmentString(w, buyer.phone, &phoneId) ||
+        !internSegmentString(w, buyer.email, &emailId))
+        return 0;
+    for (int i = 0; i < count; i++) {
+        if (!internSegmentString(w, items[i].name, &itemIds[i]))
+            return 0;
+    }
+
+    if (!reserveSegmentBlock(w, 1 + 10 * 6 + count * 40))
+        return 0;
+    uint8_t *b = w->raw;
+    size_t p = w->rawLen;
+    b[p++] = SEGMENT_INVOICE;
+    p = putVarint(b, p, (uint64_t)issued);
+    p = putVarint(b, p, worker);
+    p = putVarint(b, p, seq);
+    p = putVarint(b, p, nameId);
+    p = putVarint(b, p, phoneId);
+    p = putVarint(b, p, emailId);
+    p = putVarint(b, p, count);
+    for (int i = 0; i < count; i++) {
+        p = putVarint(b, p, itemIds[i]);
+        p = putVarint(b, p, zigzag(items[i].quantity));
+        p = putVarint(b, p, zigzag(llroundf(items[i].price * 100)));   // Price in paise
+        p = putVarint(b, p, (uint64_t)lroundf(items[i].taxRate * 10000)); // Basis points
+    }
+    w->rawLen = p;
+    w->invoices++;
+    return 1;
+}
+
+// An invoice decoded from a segment
+typedef struct {
+    time_t issued;
+    unsigned int worker;
+    unsigned long seq;
+    Buyer buyer;
+    Item items[MAX_ITEMS];
+    int count;
+} StoredInvoice;
+
+// Rebuilds the invoice ID ("<date>_<time>_<worker>-<sequence>") of a stored invoice
+void formatStoredInvoiceId(const StoredInvoice *inv, char *idStr, int maxLen) {
+    char stamp[32];
+    struct tm t;
+    localtime_r(&inv->issued, &t);
+    strftime(stamp, sizeof(stamp), "%Y-%m-%d_%H-%M-%S", &t);
+    snprintf(idStr, maxLen, "%s_%06x-%08lu", stamp, inv->worker, inv->seq);
+}
+
+// Called for each decoded invoice; return nonzero to stop scanning
+typedef int (*StoredInvoiceVisitor)(const StoredInvoice *inv, void *ctx);
+
+// Decodes every invoice in a segment file in order. Returns the number visited, or -1 on error.
+long scanInvoiceSegment(const char *path, StoredInvoiceVisitor visit, void *ctx) {
+    FILE *fp = fopen(path, "rb");
+    if (!fp)
+        return -1;
+    char magic[8];
+    if (fread(magic, 1, 8, fp) != 8 || memcmp(magic, SEGMENT_MAGIC, 8) != 0) {
+        fclose(fp);
+        return -1;
+    }
+
+    char **dict = NULL;
+    size_t dictCount = 0, dictCap = 0;
+    uint8_t *stored = NULL, *raw = NULL;
+    size_t storedCap = 0, rawCap = 0;
+    StoredInvoice *inv = malloc(sizeof(StoredInvoice));
+    long visited = 0;
+    int stop = 0, corrupt = 0;
+
+    int flags;
+    while (!stop && !corrupt && (flags = fgetc(fp)) != EOF) {
+        // Block header: flags, raw length, stored length (varints read byte by byte)
+        uint64_t lens[2];
+        for (int k = 0; k < 2 && !corrupt; k++) {
+            uint8_t buf[10];
+            size_t n = 0, pos = 0;
+            int c;
+            do {
+                c = fgetc(fp);
+                if (c == EOF || n == sizeof(buf)) {
+                    corrupt = 1;
+                    break;
+                }
+                buf[n++] = (uint8_t)c;
+            } while (c & 0x80);
+            if (!corrupt && !getVarint(buf, n, &pos, &lens[k]))
+                corrupt = 1;
+        }
+        if (corrupt)
+            break;
+
+        // The writer never makes a block much larger than SEGMENT_BLOCK_SIZE, so
+        // anything bigger is a damaged header rather than a reason to allocate
+        uint64_t rawLen = lens[0], storedLen = lens[1];
+        if (rawLen > SEGMENT_MAX_BLOCK || storedLen > rawLen) {
+            corrupt = 1;
+            break;
+        }
+        if (storedLen > storedCap) {
+            uint8_t *grown = realloc(stored, storedLen);
+            if (!grown) {
+                corrupt = 1;
+                break;
+            }
+            stored = grown;
+            storedCap = storedLen;
+        }
+        if (rawLen > rawCap) {
+            uint8_t *grown = realloc(raw, rawLen);
+            if (!grown) {
+                corrupt = 1;
+                break;
+            }
+            raw = grown;
+            rawCap = rawLen;
+        }
+        if (fread(stored, 1, storedLen, fp) != storedLen) {
+            corrupt = 1;
+            break;
+        }
+        const uint8_t *block = stored;
+        if (flags & SEGMENT_COMPRESSED) {
+            if (lzDecompress(stored, storedLen, raw, rawLen) != rawLen) {
+                corrupt = 1;
+                break;
+            }
+            block = raw;
+        } else if (storedLen != rawLen) {
+            corrupt = 1;
+            break;
+        }
+
+        size_t p = 0;
+        while (p < rawLen && !stop && !corrupt) {
+            uint8_t tag = block[p++];
+            uint64_t v[7];
+            if (tag == SEGMENT_DEFINE) {
+                if (!getVarint(block, rawLen, &p, &v[0]) || p + v[0] > rawLen) {
+                    corrupt = 1;
+                    break;
+                }
+                if (dictCount == dictCap) {
+                    size_t cap = dictCap ? dictCap * 2 : 256;
+                    char **grown = realloc(dict, cap * sizeof(char *));
+                    if (!grown) {
+                        corrupt = 1;
+                        break;
+                    }
+                    dict = grown;
+                    dictCap = cap;
+                }
+                dict[dictCount] = malloc(v[0] + 1);
+                if (!dict[dictCount]) {
+                    corrupt = 1;
+                    break;
+                }
+                memcpy(dict[dictCount], block + p, v[0]);
+                dict[dictCount][v[0]] = '\0';
+                dictCount++;
+                p += v[0];
+            } else if (tag == SEGMENT_INVOICE) {
+                for (int k = 0; k < 7 && !corrupt; k++)
+                    corrupt = !getVarint(block, rawLen, &p, &v[k]);
+                if (corrupt || v[3] >= dictCount || v[4] >= dictCount || v[5] >= dictCount || v[6] > MAX_ITEMS) {
+                    corrupt = 1;
+                    break;
+                }
+                inv->issued = (time_t)v[0];
+                inv->worker = (unsigned int)v[1];
+                inv->seq = (unsigned long)v[2];
+                copyTruncated(inv->buyer.name, dict[v[3]], sizeof(inv->buyer.name));
+                copyTruncated(inv->buyer.phone, dict[v[4]], sizeof(inv->buyer.phone));
+                copyTruncated(inv->buyer.email, dict[v[5]], sizeof(inv->buyer.email));
+                inv->count = (int)v[6];
+                for (int i = 0; i < inv->count && !corrupt; i++) {
+                    uint64_t f[4];
+                    for (int k = 0; k < 4 && !corrupt; k++)
+                        corrupt = !getVarint(block, rawLen, &p, &f[k]);
+                    if (corrupt || f[0] >= dictCount) {
+                        corrupt = 1;
+                        break;
+                    }
+                    Item *item = &inv->items[i];
+                    copyTruncated(item->name, dict[f[0]], sizeof(item->name));
+                    item->quantity = (int)unzigzag(f[1]);
+                    item->price = unzigzag(f[2]) / 100.0f;
+                    item->total = item->quantity * item->price;
+                    item->taxRate = f[3] / 10000.0f;
+                }
+                if (!corrupt) {
+                    visited++;
+                    stop = visit(inv, ctx);
+                }
+            } else {
+                corrupt = 1;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < dictCount; i++)
+        free(dict[i]);
+    free(dict);
+    free(stored);
+    free(raw);
+    free(inv);
+    fclose(fp);
+    if (corrupt)
+        printf("Warning: %s is corrupt after %ld invoices.\n", path, visited);
+    return visited;
+}
+
+// Moves this process's sequence past every ID of its worker stored in `path`,
+// a segment left by an earlier process that had the same PID
+int noteTakenInvoiceId(const StoredInvoice *inv, void *ctx) {
+    unsigned long *next = ctx;
+    if (inv->worker == invoiceWorkerId && inv->seq >= *next)
+        *next = inv->seq + 1;
+    return 0;
+}
+
+void skipTakenInvoiceIds(const char *path) {
+    int saved = errno;
+    unsigned long next = 0;
+    scanInvoiceSegment(path, noteTakenInvoiceId, &next);
+    unsigned long seq = atomic_load(&invoiceSequence);
+    while (seq < next && !atomic_compare_exchange_weak(&invoiceSequence, &seq, next))
+        ;
+    errno = saved;
+}
+
+// Stores an invoice (sequence `seq` of this process's worker ID) in this process's
+// current segment, rolling over to a new segment file when the current one is full.
+// Returns 1 on success.
+int storeInvoiceInSegment(Item items[], int count, Buyer buyer, const char *invoiceId, time_t issued,
+                          unsigned long seq, int flush, char *segmentPath, size_t pathLen) {
+    SegmentWriter *w = &segmentWriter;
+    pthread_mutex_lock(&w->lock);
+    if (w->fp && w->invoices >= SEGMENT_MAX_INVOICES)
+        closeSegmentWriter(w);
+    if (!w->fp) {
+        char path[128];
+        snprintf(path, sizeof(path), "%s/segment_%s.seg", INVOICE_FOLDER, invoiceId);
+        if (!openSegmentWriter(w, path)) {
+            if (errno == EEXIST)
+                skipTakenInvoiceIds(path);      // saveInvoice then retries with a fresh ID
+            pthread_mutex_unlock(&w->lock);
+            return 0;
+        }
+    }
+
+    int ok = encodeSegmentInvoice(w, items, count, buyer, issued, invoiceWorkerId, seq);
+    if (ok && (flush || w->rawLen >= SEGMENT_BLOCK_SIZE))
+        ok = flushSegmentBlock(w);
+    if (segmentPath)
+        snprintf(segmentPath, pathLen, "%s", w->path);
+    pthread_mutex_unlock(&w->lock);
+    return ok;
+}
+
+// Writes out invoices stored with `flush` = 0. Returns 1 on success.
+int flushInvoiceSegment() {
+    pthread_mutex_lock(&segmentWriter.lock);
+    int ok = flushSegmentBlock(&segmentWriter);
+    pthread_mutex_unlock(&segmentWriter.lock);
+    return ok;
+}
+
+// Calls scanInvoiceSegment for every segment in the invoice folder until a visitor stops
+void scanAllInvoiceSegments(StoredInvoiceVisitor visit, void *ctx, int *stopFlag) {
+    DIR *dir = opendir(INVOICE_FOLDER);
+    if (!dir)
+        return;
+    struct dirent *entry;
+    while ((!stopFlag || !*stopFlag) && (entry = readdir(dir)) != NULL) {
+        size_t len = strlen(entry->d_name);
+        if (strncmp(entry->d_name, "segment_", 8) != 0 || len < 4 || strcmp(entry->d_name + len - 4, ".seg") != 0)
+            continue;
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s", INVOICE_FOLDER, entry->d_name);
+        scanInvoiceSegment(path, visit, ctx);
+    }
+    closedir(dir);
+}
+
+
+// Arguments for one stress-test worker thread
+typedef struct {
+    char (*ids)[MAX_INVOICE_ID];   // Where this thread stores the IDs it allocated
+    long count;                    // Number of invoices this thread generates
+} StressWorker;
+
+// Stress-test thread: allocates IDs and renders invoices into /dev/null
+void *stressWorker(void *arg) {
+    StressWorker *w = arg;
+    FILE *sink = fopen("/dev/null", "w");
+    if (!sink)
+        return NULL;
+
+    Buyer buyer = {"Stress Buyer", "0000000000", "stress@example.com"};
+    Item items[3] = {
+        {"Widget", 2, 20.0f, 40.0f, TAX_RATE},
+        {"Gadget", 4, 3.0f, 12.0f, TAX_RATE},
+        {"Gizmo", 3, 2.5f, 7.5f, TAX_RATE},
+    };
+
+    for (long i = 0; i < w->count; i++) {
+        time_t issued = allocateInvoiceId(w->ids[i], MAX_INVOICE_ID, NULL);
+        writeInvoiceBody(sink, items, 3, buyer, issued);
+    }
+    fclose(sink);
+    return NULL;
+}
+
+// Compares two invoice IDs for qsort
+int compareInvoiceIds(const void *a, const void *b) {
+    return strcmp((const char *)a, (const char *)b);
+}
+
+// Generates invoices across several threads and verifies every ID is unique
+int runStressTest(long total, int threads) {
+    char (*ids)[MAX_INVOICE_ID] = malloc(total * sizeof(*ids));
+    pthread_t *tids = malloc(threads * sizeof(pthread_t));
+    StressWorker *workers = malloc(threads * sizeof(StressWorker));
+    if (!ids || !tids || !workers) {
+        printf("Out of memory for stress test.\n");
+        return 1;
+    }
+
+    printf("Generating %ld invoices across %d threads...\n", total, threads);
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    long offset = 0;
+    for (int t = 0; t < threads; t++) {
+        workers[t].ids = ids + offset;
+        workers[t].count = total / threads + (t < total % threads ? 1 : 0);
+        offset += workers[t].count;
+        pthread_create(&tids[t], NULL, stressWorker, &workers[t]);
+    }
+    for (int t = 0; t < threads; t++)
+        pthread_join(tids[t], NULL);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    // Sort and look for adjacent duplicates
+    qsort(ids, total, sizeof(*ids), compareInvoiceIds);
+    long duplicates = 0;
+    for (long i = 1; i < total; i++) {
+        if (strcmp(ids[i - 1], ids[i]) == 0)
+            duplicates++;
+    }
+
+    printf("Elapsed     : %.3f s\n", seconds);
+    printf("Throughput  : %.0f invoices/s\n", total / seconds);
+    printf("Sample IDs  : %s .. %s\n", ids[0], ids[total - 1]);
+    printf("Duplicates  : %ld\n", duplicates);
+    printf("%s\n", duplicates == 0 ? "PASS: all invoice IDs unique" : "FAIL: duplicate invoice IDs");
+
+    free(ids);
+    free(tids);
+    free(workers);
+    return duplicates == 0 ? 0 : 1;
+}
+
+// Visitor for listPastInvoices: prints the file name each stored invoice is viewed by
+int listStoredInvoice(const StoredInvoice *inv, void *ctx) {
+    char id[MAX_INVOICE_ID];
+    formatStoredInvoiceId(inv, id, sizeof(id));
+    printf("- invoice_%s.txt (stored)\n", id);
+    (*(long *)ctx)++;
+    return 0;
+}
+
+// Lookup state for finding one stored invoice by ID
+typedef struct {
+    const char *id;
+    unsigned int worker;
+    unsigned long seq;
+    int found;
+} StoredInvoiceQuery;
+
+// Visitor for viewInvoiceByName: renders the matching invoice in today's text layout
+int renderStoredInvoice(const StoredInvoice *inv, void *ctx) {
+    StoredInvoiceQuery *q = ctx;
+    if (inv->worker != q->worker || inv->seq != q->seq)
+        return 0;
+    char id[MAX_INVOICE_ID];
+    formatStoredInvoiceId(inv, id, sizeof(id));
+    if (strcmp(id, q->id) != 0)
+        return 0;
 
-// Maximum number of items per invoice
-#define MAX_ITEMS 100
-// GST tax rate (18%)
-#define TAX_RATE 0.18
-// Folder to store invoices
-#define INVOICE_FOLDER "invoices"
+    Item items[MAX_ITEMS];
+    memcpy(items, inv->items, inv->count * sizeof(Item));
+    writeInvoiceBody(stdout, items, inv->count, inv->buyer, inv->issued);
+    q->found = 1;
+    return 1;
+}
 
-// Structure to represent an item in the invoice
+// Looks for an invoice (by file name, e.g. invoice_<id>.txt) in the segments and prints it
+int viewStoredInvoice(const char *fname) {
+    char id[MAX_INVOICE_ID];
+    const char *start = strncmp(fname, "invoice_", 8) == 0 ? fname + 8 : fname;
+    copyTruncated(id, start, sizeof(id));
+    size_t len = strlen(id);
+    if (len > 4 && strcmp(id + len - 4, ".txt") == 0)
+        id[len - 4] = '\0';
+
+    StoredInvoiceQuery q = {id, 0, 0, 0};
+    if (strlen(id) < 21 || sscanf(id + 20, "%x-%lu", &q.worker, &q.seq) != 2)
+        return 0;
+    scanAllInvoiceSegments(renderStoredInvoice, &q, &q.found);
+    return q.found;
+}
+
+// Visitor for the storage benchmark: counts invoices and their line items
+int countStoredInvoice(const StoredInvoice *inv, void *ctx) {
+    *(long *)ctx += inv->count;
+    return 0;
+}
+
+// Builds the i-th synthetic invoice used by the storage and rendering benchmarks
+void makeSyntheticInvoice(long i, unsigned int *seed, Item items[], int *count, Buyer *buyer) {
+    int b = rand_r(seed) % 10000;
+    snprintf(buyer->name, sizeof(buyer->name), "Buyer %d", b);
+    snprintf(buyer->phone, sizeof(buyer->phone), "98%08d", b * 7919 % 100000000);
+    snprintf(buyer->email, sizeof(buyer->email), "buyer%d@example.com", b);
+    *count = 2 + (int)(i % 4);
+    for (int k = 0; k < *count; k++) {
+        int product = rand_r(seed) % 1000;
+        snprintf(items[k].name, sizeof(items[k].name), "Product %d", product);
+        items[k].quantity = 1 + rand_r(seed) % 10;
+        items[k].price = (1 + product % 500) + (product % 100) / 100.0f;
+        items[k].total = items[k].quantity * items[k].price;
+        items[k].taxRate = TAX_RATE;
+    }
+}
+
+// Compares text files with compact segments (plain and compressed) on synthetic invoices
+int runStorageBenchmark(long invoices) {
+    Item items[MAX_ITEMS];
+    Buyer buyer;
+    int count;
+    struct timespec start;
+    time_t issued = time(NULL);
+
+    // Text layout: bytes written, and on-disk size with one 4 KB block per file
+    static char textBuf[16384];
+    FILE *sink = fmemopen(textBuf, sizeof(textBuf), "w");
+    if (!sink)
+        return 1;
+    unsigned int seed = 99;
+    long textBytes = 0, textDisk = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long i = 0; i < invoices; i++) {
+        makeSyntheticInvoice(i, &seed, items, &count, &buyer);
+        rewind(sink);
+        writeInvoiceBody(sink, items, count, buyer, issued);
+        long bytes = ftell(sink);
+        textBytes += bytes;
+        textDisk += (bytes + 4095) / 4096 * 4096;
+    }
+    double textSeconds = secondsSince(&start);
+    fclose(sink);
+
+    printf("Invoices            : %ld\n", invoices);
+    printf("%-20s %12s %12s %14s %14s\n", "Format", "Bytes/inv", "Disk/inv", "Encode inv/s", "Decode inv/s");
+    printf("%-20s %12.1f %12.1f %14.0f %14s\n", "Text files", (double)textBytes / invoices,
+           (double)textDisk / invoices, invoices / textSeconds, "-");
+
+    // Batched writes (the service) share 64 KB blocks; the menu flushes every
+    // invoice as its own block, so it is on disk before the next prompt
+    static const char *modes[3] = {"Segment (varint)", "Segment + LZ", "Segment, 1 inv/blk"};
+    for (int mode = 0; mode < 3; mode++) {
+        int compress = mode > 0;
+        char path[] = "/tmp/segment_benchXXXXXX";
+        int fd = mkstemp(path);
+        if (fd < 0)
+            return 1;
+        close(fd);
+        unlink(path);   // openSegmentWriter creates it exclusively
+
+        SegmentWriter w = {.compress = compress, .lock = PTHREAD_MUTEX_INITIALIZER};
+        if (!openSegmentWriter(&w, path))
+            return 1;
+        seed = 99;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (long i = 0; i < invoices; i++) {
+            makeSyntheticInvoice(i, &seed, items, &count, &buyer);
+            if (!encodeSegmentInvoice(&w, items, count, buyer, issued, 1, (unsigned long)i)) {
+                printf("Out of memory encoding segment.\n");
+                closeSegmentWriter(&w);
+                unlink(path);
+                return 1;
+            }
+            if (mode == 2 || w.rawLen >= SEGMENT_BLOCK_SIZE)
+                flushSegmentBlock(&w);
+        }
+        closeSegmentWriter(&w);
+        double encodeSeconds = secondsSince(&start);
+
+        struct stat st;
+        stat(path, &st);
+        long lines = 0;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        long decoded = scanInvoiceSegment(path, countStoredInvoice, &lines);
+        double decodeSeconds = secondsSince(&start);
+        unlink(path);
+
+        printf("%-20s %12.1f %12.1f %14.0f %14.0f\n", modes[mode],
+               (double)st.st_size / invoices, (double)st.st_size / invoices, invoices / encodeSeconds,
+               decoded / decodeSeconds);
+    }
+    return 0;
+}
+
+// File extension for each output format
+static const char *formatExtensions[FORMAT_COUNT] = {"txt", "html", "pdf"};
+
+// Renders an invoice in the given format and writes it to a new file. Returns 1 on success.
+int writeInvoiceDocument(const char *filename, InvoiceFormat format, Item items[], int count, Buyer buyer,
+                         time_t issued) {
+    OutBuf *buf = &renderScratch()->document;
+    buf->len = 0;
+    renderInvoice(format, items, count, &buyer, issued, buf);
+
+    // "x" refuses to overwrite, so a collision can never silently destroy an invoice
+    FILE *fptr = fopen(filename, "wbx");
+    if (!fptr)
+        return 0;
+    int ok = fwrite(buf->data, 1, buf->len, fptr) == buf->len;
+    return fclose(fptr) == 0 && ok;
+}
+
+// Allocates an ID for an invoice and stores it as a text, HTML or PDF file, or in a
+// compact segment (`flush` = 0 lets a batch of invoices share one segment write).
+// Fills in the ID and where it went; returns NULL on success or an error message.
+const char *saveInvoice(Item items[], int count, Buyer buyer, InvoiceFormat format, int flush,
+                        char *invoiceId, time_t *issued, char *segmentPath, char *filename, size_t pathLen) {
+    // Name the invoice after a freshly allocated ID. Files are created with "x", so an
+    // ID left behind by an earlier process with the same PID shows up as EEXIST and
+    // the invoice moves on to the next sequence number.
+    for (int attempt = 0; attempt < INVOICE_ID_ATTEMPTS; attempt++) {
+        unsigned long seq;
+        *issued = allocateInvoiceId(invoiceId, MAX_INVOICE_ID, &seq);
+        segmentPath[0] = filename[0] = '\0';
+
+        // Segments already hold the text layout; other formats still get their own file
+        errno = 0;
+        if (!useInvoiceSegments || format != FORMAT_TEXT) {
+            snprintf(filename, pathLen, "%s/invoice_%s.%s", INVOICE_FOLDER, invoiceId, formatExtensions[format]);
+            if (!writeInvoiceDocument(filename, format, items, count, buyer, *issued)) {
+                if (errno == EEXIST)
+                    continue;
+                return "Error creating invoice file.";
+            }
+        }
+        if (useInvoiceSegments &&
+            !storeInvoiceInSegment(items, count, buyer, invoiceId, *issued, seq, flush, segmentPath, pathLen)) {
+            if (errno == EEXIST) {     // The new segment's name was taken
+                if (filename[0])
+                    unlink(filename);
+                continue;
+            }
+            return "Error storing invoice in segment.";
+        }
+        return NULL;
+    }
+    return "Error creating invoice file: no free invoice ID.";
+}
+
+// Generates and saves an invoice as a text, HTML or PDF file, or in a compact segment
+void generateInvoice(Item items[], int count, Buyer buyer, InvoiceFormat format) {
+    char filename[150];
+    char segmentPath[150];
+    char invoiceId[MAX_INVOICE_ID];
+    time_t issued;
+
+    const char *error = saveInvoice(items, count, buyer, format, 1, invoiceId, &issued, segmentPath, filename,
+                                    sizeof(filename));
+    if (segmentPath[0])
+        printf("\nInvoice invoice_%s.txt stored in %s\n", invoiceId, segmentPath);
+    if (error) {
+        printf("%s\n", error);
+        return;
+    }
+    if (filename[0])
+        printf("\nInvoice saved to %s\n", filename);
+    appendSalesRecords(items, count, buyer);
+
+    // Echo the invoice to the console
+    printf("\n");
+    writeInvoiceBody(stdout, items, count, buyer, issued);
+}
+
+// Measures rendering throughput for each output format on synthetic invoices
+int runRenderBenchmark(long invoices) {
+    const char *names[FORMAT_COUNT] = {"Text", "HTML", "PDF"};
+    Item items[MAX_ITEMS];
+    Buyer buyer;
+    int count;
+    time_t issued = time(NULL);
+    OutBuf out = {0};
+
+    printf("Invoices : %ld\n", invoices);
+    printf("%-8s %14s %12s %10s\n", "Format", "Invoices/s", "Bytes/inv", "MB/s");
+    for (int f = 0; f < FORMAT_COUNT; f++) {
+        unsigned int seed = 99;
+        size_t bytes = 0;
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (long i = 0; i < invoices; i++) {
+            makeSyntheticInvoice(i, &seed, items, &count, &buyer);
+            out.len = 0;
+            renderInvoice((InvoiceFormat)f, items, count, &buyer, issued, &out);
+            bytes += out.len;
+        }
+        double seconds = secondsSince(&start);
+        printf("%-8s %14.0f %12.1f %10.1f\n", names[f], invoices / seconds, (double)bytes / invoices,
+               bytes / seconds / 1e6);
+    }
+    free(out.data);
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Invoice service (Unix domain socket)
+// ---------------------------------------------------------------------------
+
+// Jobs each worker queue holds before connections have to wait
+#define SERVICE_QUEUE_DEPTH 256
+// Most jobs a worker takes from its queue at once
+#define SERVICE_BATCH 32
+// Largest request frame accepted (bigger frames close the connection)
+#define SERVICE_MAX_FRAME 65536
+// Longest invoice response frame
+#define SERVICE_MAX_RESPONSE (4 + 4 + 1 + 1 + MAX_INVOICE_ID + 8)
+// Unsent responses at which a connection's requests stop being read
+#define SERVICE_MAX_PENDING (64 * 1024)
+// How often a reader with requests in flight checks for responses to send (ms)
+#define SERVICE_POLL_MS 20
+
+// Response status codes
+#define SERVICE_OK 0
+#define SERVICE_BAD_REQUEST 1
+#define SERVICE_UNKNOWN_SKU 2
+#define SERVICE_STORAGE_ERROR 3
+#define SERVICE_NO_CATALOG 4
+
+// A client connection; freed by whoever drops the last reference (the service's
+// list of connections, its reader thread or the worker answering its last job)
 typedef struct {
-    char name[50];     // Item name
-    int quantity;      // Quantity purchased
-    float price;       // Price per item
-    float total;       // Total price for this item (quantity * price)
-} Item;
+    int fd;
+    atomic_int refs;
+    pthread_mutex_t writeLock;     // Guards the socket's output and the pending responses
+    uint8_t *pending;              // Responses the socket had no room for; the reader sends them
+    size_t pendingLen, pendingCap;
+    pthread_t reader;
+    atomic_int readerDone;         // Reader has exited and can be joined
+} ServiceConn;
 
-// Structure to represent buyer details
+// One decoded invoice request
 typedef struct {
-    char name[100];    // Buyer's name
-    char phone[20];    // Buyer's phone number
-    char email[100];   // Buyer's email address
-} Buyer;
+    ServiceConn *conn;
+    uint32_t tag;                  // Chosen by the client, echoed in the response
+    uint8_t status;                // SERVICE_OK unless decoding already failed
+    char unknownSku[CATALOG_MAX_SKU];  // Returned with SERVICE_UNKNOWN_SKU
+    InvoiceFormat format;
+    Buyer buyer;
+    Item items[MAX_ITEMS];
+    int count;
+} ServiceJob;
 
-// Gets the current date and time as a string for filenames
-void getCurrentDateTime(char *datetimeStr, int maxLen) {
-    time_t now = time(NULL);
-    struct tm *t = localtime(&now);
-    strftime(datetimeStr, maxLen, "%Y-%m-%d_%H-%M-%S", t);
+// Bounded queue feeding one worker thread
+typedef struct {
+    ServiceJob *jobs;              // Ring of SERVICE_QUEUE_DEPTH jobs
+    unsigned long head, tail;      // Jobs taken / jobs added so far
+    pthread_mutex_t lock;
+    pthread_cond_t notEmpty, notFull;
+    int stopping;
+    pthread_t thread;
+    long invoices, batches;        // Work done, for the statistics
+    long stalls;                   // Times a reader found the queue full
+} ServiceQueue;
+
+typedef struct {
+    ServiceQueue *queues;
+    int workers;
+    atomic_uint nextQueue;         // Round-robin queue choice
+    int listenFd;
+    char path[108];
+    ServiceConn **conns;           // Open connections, so stopping can end their readers
+    int connCount, connCap;
+    pthread_mutex_t connLock;
+    atomic_int stop;
+    pthread_t acceptThread;
+} InvoiceService;
+
+static volatile sig_atomic_t serviceInterrupted;
+
+void onServiceSignal(int sig) {
+    (void)sig;
+    serviceInterrupted = 1;
 }
 
-// Prints and writes the current date/time to the invoice file
-void printDateTime(FILE *fptr) {
-    char dt[100];
-    time_t now = time(NULL);
-    struct tm *t = localtime(&now);
-    strftime(dt, sizeof(dt), "%d-%m-%Y %H:%M:%S", t);
-    fprintf(fptr, "Date: %s\n", dt);
-    printf("Date: %s\n", dt);
+uint32_t getLe32(const uint8_t *p) {
+    return p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
 }
 
-// Loads items from "items.csv" into the items array
-int loadItemsFromCSV(Item items[]) {
-    FILE *fp = fopen("items.csv", "r");
-    if (!fp) {
-        printf("Error opening items.csv\n");
+void putLe32(uint8_t *p, uint32_t v) {
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+// Reads a length-prefixed string into a fixed-size field. Returns 0 if the frame is too short.
+int getFrameString(const uint8_t *frame, size_t len, size_t *pos, char *dst, size_t size) {
+    if (*pos >= len || *pos + 1 + frame[*pos] > len)
         return 0;
+    size_t n = frame[(*pos)++];
+    size_t keep = n < size - 1 ? n : size - 1;
+    memcpy(dst, frame + *pos, keep);
+    dst[keep] = '\0';
+    *pos += n;
+    return 1;
+}
+
+// Decodes a request frame (everything after the length prefix) into a job
+void decodeServiceRequest(const uint8_t *frame, size_t len, ServiceJob *job) {
+    size_t pos = 7;
+    job->tag = len >= 4 ? getLe32(frame) : 0;
+    job->status = SERVICE_BAD_REQUEST;
+    job->count = 0;
+    job->unknownSku[0] = '\0';
+    if (len < 7)
+        return;
+    int format = frame[4], bySku = frame[5], count = frame[6];
+    if (format >= FORMAT_COUNT || bySku > 1 || count < 1 || count > MAX_ITEMS)
+        return;
+    job->format = (InvoiceFormat)format;
+    if (!getFrameString(frame, len, &pos, job->buyer.name, sizeof(job->buyer.name)) ||
+        !getFrameString(frame, len, &pos, job->buyer.phone, sizeof(job->buyer.phone)) ||
+        !getFrameString(frame, len, &pos, job->buyer.email, sizeof(job->buyer.email)))
+        return;
+
+    char skus[MAX_ITEMS][CATALOG_MAX_SKU];
+    int quantities[MAX_ITEMS];
+    for (int i = 0; i < count; i++) {
+        Item *item = &job->items[i];
+        if (!getFrameString(frame, len, &pos, bySku ? skus[i] : item->name, bySku ? CATALOG_MAX_SKU : sizeof(item->name)))
+            return;
+        if (pos + (bySku ? 4 : 8) > len)
+            return;
+        quantities[i] = (int32_t)getLe32(frame + pos);
+        pos += 4;
+        if (!bySku) {
+            item->quantity = quantities[i];
+            item->price = getLe32(frame + pos) / 100.0f;   // Paise
+            item->total = item->quantity * item->price;
+            item->taxRate = TAX_RATE;
+            pos += 4;
+        }
     }
 
-    char line[200];
-    int count = 0;
+    job->status = SERVICE_OK;
+    job->count = count;
+    if (bySku) {
+        unsigned char unknown[MAX_ITEMS];
+        job->count = resolveCatalogLines(skus, quantities, count, job->items, unknown);
+        if (job->count < 0) {
+            job->status = SERVICE_NO_CATALOG;
+        } else if (job->count != count) {
+            job->status = SERVICE_UNKNOWN_SKU;
+            for (int i = 0; i < count; i++) {
+                if (unknown[i]) {
+                    copyTruncated(job->unknownSku, skus[i], sizeof(job->unknownSku));
+                    break;
+                }
+            }
+        }
+    }
+}
 
-    // Read each line and parse item details
-    while (fgets(line, sizeof(line), fp)) {
-        sscanf(line, "%[^,],%d,%f", items[count].name, &items[count].quantity, &items[count].price);
-        items[count].total = items[count].quantity * items[count].price;
-        count++;
+// Drops a reference to a connection, closing it with the last one
+void releaseServiceConn(ServiceConn *conn) {
+    if (atomic_fetch_sub(&conn->refs, 1) == 1) {
+        close(conn->fd);
+        pthread_mutex_destroy(&conn->writeLock);
+        free(conn->pending);
+        free(conn);
     }
+}
 
-    fclose(fp);
-    return count; // Return number of items loaded
+// Writes all of a buffer to a socket. Returns 1 on success.
+int sendAll(int fd, const void *data, size_t len) {
+    const char *p = data;
+    while (len > 0) {
+        ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return 0;
+        p += n;
+        len -= n;
+    }
+    return 1;
+}
+
+// Sends as much as the socket takes without waiting. Returns the number of bytes
+// sent, or -1 if the connection is broken.
+ssize_t sendAvailable(int fd, const void *data, size_t len) {
+    size_t sent = 0;
+    while (sent < len) {
+        ssize_t n = send(fd, (const char *)data + sent, len - sent, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+        if (n <= 0)
+            return -1;
+        sent += n;
+    }
+    return (ssize_t)sent;
+}
+
+// Sends responses to a connection without ever making a worker wait for the client:
+// what the socket has no room for is queued for the connection's reader to send
+void queueServiceResponses(ServiceConn *conn, const uint8_t *data, size_t len) {
+    pthread_mutex_lock(&conn->writeLock);
+    size_t sent = 0;
+    if (conn->pendingLen == 0) {
+        ssize_t n = sendAvailable(conn->fd, data, len);
+        sent = n < 0 ? len : (size_t)n;    // Nobody left to read them
+    }
+    if (sent < len) {
+        size_t need = conn->pendingLen + len - sent;
+        if (need > conn->pendingCap) {
+            size_t cap = conn->pendingCap ? conn->pendingCap : 4096;
+            while (cap < need)
+                cap *= 2;
+            uint8_t *grown = realloc(conn->pending, cap);
+            if (!grown) {
+                shutdown(conn->fd, SHUT_RDWR);   // Responses would be lost; end the connection
+                pthread_mutex_unlock(&conn->writeLock);
+                return;
+            }
+            conn->pending = grown;
+            conn->pendingCap = cap;
+        }
+        memcpy(conn->pending + conn->pendingLen, data + sent, len - sent);
+        conn->pendingLen += len - sent;
+    }
+    pthread_mutex_unlock(&conn->writeLock);
 }
 
-// Generates and saves an invoice file
-void generateInvoice(Item items[], int count, Buyer buyer) {
-    char filename[100];
-    char timestamp[50];
+// Sends what it can of a connection's pending responses. Returns 0 if the
+// connection is broken.
+int flushPendingResponses(ServiceConn *conn) {
+    pthread_mutex_lock(&conn->writeLock);
+    ssize_t n = sendAvailable(conn->fd, conn->pending, conn->pendingLen);
+    if (n > 0) {
+        memmove(conn->pending, conn->pending + n, conn->pendingLen - n);
+        conn->pendingLen -= n;
+    }
+    pthread_mutex_unlock(&conn->writeLock);
+    return n >= 0;
+}
 
-    // Create a unique filename using the current date and time
-    getCurrentDateTime(timestamp, sizeof(timestamp));
-    sprintf(filename, "%s/invoice_%s.txt", INVOICE_FOLDER, timestamp);
+// Adds a job to a worker queue, waiting while the queue is full. The reader stops
+// reading its socket meanwhile, so a client that sends too fast is slowed down
+// by its own socket buffer filling up.
+void pushServiceJob(ServiceQueue *q, const ServiceJob *job) {
+    pthread_mutex_lock(&q->lock);
+    if (q->tail - q->head == SERVICE_QUEUE_DEPTH)
+        q->stalls++;
+    while (q->tail - q->head == SERVICE_QUEUE_DEPTH)
+        pthread_cond_wait(&q->notFull, &q->lock);
+    q->jobs[q->tail % SERVICE_QUEUE_DEPTH] = *job;
+    q->tail++;
+    pthread_cond_signal(&q->notEmpty);
+    pthread_mutex_unlock(&q->lock);
+}
 
-    FILE *fptr = fopen(filename, "w");
-    if (!fptr) {
-        printf("Error creating invoice file.\n");
-        return;
+// Encodes the response to a job: the invoice ID, or the unknown SKU. Returns its length.
+size_t encodeServiceResponse(const ServiceJob *job, uint8_t status, const char *invoiceId, uint8_t *out) {
+    if (status == SERVICE_UNKNOWN_SKU)
+        invoiceId = job->unknownSku;
+    size_t idLen = status == SERVICE_OK || status == SERVICE_UNKNOWN_SKU ? strlen(invoiceId) : 0;
+    double total = 0;
+    for (int i = 0; status == SERVICE_OK && i < job->count; i++)
+        total += job->items[i].total + job->items[i].total * job->items[i].taxRate;
+    uint64_t paise = (uint64_t)llround(total * 100);
+
+    size_t len = 4 + 1 + 1 + idLen + 8;
+    putLe32(out, len);
+    putLe32(out + 4, job->tag);
+    out[8] = status;
+    out[9] = idLen;
+    memcpy(out + 10, invoiceId, idLen);
+    putLe32(out + 10 + idLen, (uint32_t)paise);
+    putLe32(out + 14 + idLen, (uint32_t)(paise >> 32));
+    return 4 + len;
+}
+
+// Worker thread: takes batches of jobs, saves the invoices (one segment flush and
+// one ledger write per batch) and sends each connection its responses in one write
+void *serviceWorker(void *arg) {
+    ServiceQueue *q = arg;
+    ServiceJob *batch = malloc(SERVICE_BATCH * sizeof(ServiceJob));
+    uint8_t (*responses)[SERVICE_MAX_RESPONSE] = malloc(SERVICE_BATCH * sizeof(*responses));
+    size_t responseLens[SERVICE_BATCH];
+    uint8_t statuses[SERVICE_BATCH];
+    char (*invoiceIds)[MAX_INVOICE_ID] = malloc(SERVICE_BATCH * sizeof(*invoiceIds));
+    SalesRecord *records = malloc(SERVICE_BATCH * MAX_ITEMS * sizeof(SalesRecord));
+    uint8_t *out = malloc(SERVICE_BATCH * SERVICE_MAX_RESPONSE);
+    if (!batch || !responses || !invoiceIds || !records || !out) {
+        fprintf(stderr, "Out of memory starting a service worker\n");
+        exit(1);
+    }
+
+    for (;;) {
+        pthread_mutex_lock(&q->lock);
+        while (q->head == q->tail && !q->stopping)
+            pthread_cond_wait(&q->notEmpty, &q->lock);
+        if (q->head == q->tail) {
+            pthread_mutex_unlock(&q->lock);
+            break;
+        }
+        int n = 0;
+        while (q->head != q->tail && n < SERVICE_BATCH)
+            batch[n++] = q->jobs[q->head++ % SERVICE_QUEUE_DEPTH];
+        pthread_cond_broadcast(&q->notFull);
+        pthread_mutex_unlock(&q->lock);
+
+        // Save the invoices, then write the segment once for the whole batch
+        int day = salesDay(time(NULL));
+        size_t recordCount = 0;
+        for (int i = 0; i < n; i++) {
+            ServiceJob *job = &batch[i];
+            char segmentPath[150], filename[150];
+            time_t issued;
+            statuses[i] = job->status;
+            invoiceIds[i][0] = '\0';
+            if (statuses[i] == SERVICE_OK) {
+                if (saveInvoice(job->items, job->count, job->buyer, job->format, 0, invoiceIds[i], &issued,
+                                segmentPath, filename, sizeof(filename))) {
+                    statuses[i] = SERVICE_STORAGE_ERROR;
+                } else {
+                    buildSalesRecords(job->items, job->count, &job->buyer, day, records + recordCount);
+                    recordCount += job->count;
+                }
+            }
+        }
+        if (useInvoiceSegments && !flushInvoiceSegment()) {
+            // None of the batch reached the disk
+            for (int i = 0; i < n; i++) {
+                if (statuses[i] == SERVICE_OK)
+                    statuses[i] = SERVICE_STORAGE_ERROR;
+            }
+            recordCount = 0;
+        }
+        if (recordCount > 0 && !writeSalesRecords(records, recordCount))
+            fprintf(stderr, "Warning: could not update %s\n", SALES_LEDGER);
+        for (int i = 0; i < n; i++)
+            responseLens[i] = encodeServiceResponse(&batch[i], statuses[i], invoiceIds[i], responses[i]);
+
+        // Group the responses by connection
+        for (int i = 0; i < n; i++) {
+            ServiceConn *conn = batch[i].conn;
+            if (!conn)
+                continue;
+            size_t len = 0;
+            int jobs = 0;
+            for (int k = i; k < n; k++) {
+                if (batch[k].conn == conn) {
+                    memcpy(out + len, responses[k], responseLens[k]);
+                    len += responseLens[k];
+                    batch[k].conn = NULL;
+                    jobs++;
+                }
+            }
+            queueServiceResponses(conn, out, len);
+            while (jobs-- > 0)
+                releaseServiceConn(conn);
+        }
+        q->invoices += n;
+        q->batches++;
     }
 
-    float subtotal = 0, tax, grandTotal;
+    free(batch);
+    free(responses);
+    free(invoiceIds);
+    free(records);
+    free(out);
+    return NULL;
+}
+
+typedef struct {
+    InvoiceService *service;
+    ServiceConn *conn;
+} ServiceReaderArgs;
+
+// Connection thread: splits the byte stream into frames and queues them
+void *serviceReader(void *arg) {
+    ServiceReaderArgs *args = arg;
+    InvoiceService *service = args->service;
+    ServiceConn *conn = args->conn;
+    free(args);
 
-    // Print invoice header
-    printf("\n======== INVOICE ========\n");
-    fprintf(fptr, "======== INVOICE ========\n");
+    uint8_t *buf = malloc(2 * SERVICE_MAX_FRAME);
+    ServiceJob *job = malloc(sizeof(ServiceJob));
+    size_t len = 0;
+    for (;;) {
+        // Requests are only read while the client keeps up with its responses, and
+        // pending responses are sent as the socket drains. Workers queue responses
+        // without waking this thread, so it looks again every SERVICE_POLL_MS while
+        // any of its jobs are in flight (it and the connection list hold two refs).
+        pthread_mutex_lock(&conn->writeLock);
+        size_t pending = conn->pendingLen;
+        pthread_mutex_unlock(&conn->writeLock);
+        struct pollfd pfd = {conn->fd, (short)((pending < SERVICE_MAX_PENDING ? POLLIN : 0) | (pending ? POLLOUT : 0)), 0};
+        int ready = poll(&pfd, 1, atomic_load(&conn->refs) > 2 ? SERVICE_POLL_MS : -1);
+        if (ready < 0 && errno != EINTR)
+            break;
+        if (ready <= 0)
+            continue;
+        if (pfd.revents & (POLLERR | POLLNVAL))
+            break;
+        if ((pfd.revents & POLLOUT) && !flushPendingResponses(conn))
+            break;
+        if (!(pfd.revents & (POLLIN | POLLHUP)))
+            continue;
 
-    // Print and write date/time
-    printDateTime(fptr);
+        ssize_t got = recv(conn->fd, buf + len, 2 * SERVICE_MAX_FRAME - len, 0);
+        if (got < 0 && errno == EINTR)
+            continue;
+        if (got <= 0)
+            break;
+        len += got;
 
-    // Print and write buyer details
-    fprintf(fptr, "Buyer Name : %s\n", buyer.name);
-    fprintf(fptr, "Phone      : %s\n", buyer.phone);
-    fprintf(fptr, "Email      : %s\n", buyer.email);
+        size_t pos = 0;
+        while (len - pos >= 4) {
+            uint32_t frameLen = getLe32(buf + pos);
+            if (frameLen > SERVICE_MAX_FRAME)
+                goto done;
+            if (len - pos - 4 < frameLen)
+                break;
+            decodeServiceRequest(buf + pos + 4, frameLen, job);
+            job->conn = conn;
+            atomic_fetch_add(&conn->refs, 1);
+            unsigned int q = atomic_fetch_add(&service->nextQueue, 1) % service->workers;
+            pushServiceJob(&service->queues[q], job);
+            pos += 4 + frameLen;
+        }
+        memmove(buf, buf + pos, len - pos);
+        len -= pos;
+    }
+done:
+    free(buf);
+    free(job);
+    atomic_store(&conn->readerDone, 1);
+    releaseServiceConn(conn);
+    return NULL;
+}
 
-    printf("Buyer Name : %s\n", buyer.name);
-    printf("Phone      : %s\n", buyer.phone);
-    printf("Email      : %s\n", buyer.email);
+// Joins the readers of closed connections and drops them from the list
+void reapServiceReaders(InvoiceService *service) {
+    pthread_mutex_lock(&service->connLock);
+    for (int i = 0; i < service->connCount;) {
+        ServiceConn *conn = service->conns[i];
+        if (atomic_load(&conn->readerDone)) {
+            pthread_join(conn->reader, NULL);
+            service->conns[i] = service->conns[--service->connCount];
+            releaseServiceConn(conn);
+        } else {
+            i++;
+        }
+    }
+    pthread_mutex_unlock(&service->connLock);
+}
 
-    // Print and write item table header
-    printf("\n%-20s %-10s %-10s %-10s\n", "Item", "Qty", "Price", "Total");
-    fprintf(fptr, "\n%-20s %-10s %-10s %-10s\n", "Item", "Qty", "Price", "Total");
+// Accept thread: one reader thread per connection
+void *serviceAcceptor(void *arg) {
+    InvoiceService *service = arg;
+    struct pollfd pfd = {service->listenFd, POLLIN, 0};
 
-    // Print and write each item
-    for (int i = 0; i < count; i++) {
-        subtotal += items[i].total;
-        printf("%-20s %-10d %-10.2f %-10.2f\n", items[i].name, items[i].quantity, items[i].price, items[i].total);
-        fprintf(fptr, "%-20s %-10d %-10.2f %-10.2f\n", items[i].name, items[i].quantity, items[i].price, items[i].total);
+    while (!atomic_load(&service->stop)) {
+        // Wake up now and then to notice a stop request
+        reapServiceReaders(service);
+        if (poll(&pfd, 1, 100) <= 0)
+            continue;
+        int fd = accept(service->listenFd, NULL, NULL);
+        if (fd < 0)
+            continue;
+
+        ServiceConn *conn = malloc(sizeof(ServiceConn));
+        ServiceReaderArgs *args = malloc(sizeof(ServiceReaderArgs));
+        if (!conn || !args) {
+            close(fd);
+            free(conn);
+            free(args);
+            continue;
+        }
+        conn->fd = fd;
+        atomic_init(&conn->refs, 2);           // The reader and the connection list
+        atomic_init(&conn->readerDone, 0);
+        pthread_mutex_init(&conn->writeLock, NULL);
+        conn->pending = NULL;
+        conn->pendingLen = conn->pendingCap = 0;
+        args->service = service;
+        args->conn = conn;
+
+        // Readers are joinable so stopping can wait until none of them can queue jobs
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        pthread_attr_setstacksize(&attr, 256 * 1024);
+        pthread_mutex_lock(&service->connLock);
+        if (service->connCount == service->connCap) {
+            int cap = service->connCap ? service->connCap * 2 : 64;
+            ServiceConn **grown = realloc(service->conns, cap * sizeof(ServiceConn *));
+            if (grown) {
+                service->conns = grown;
+                service->connCap = cap;
+            }
+        }
+        if (service->connCount < service->connCap &&
+            pthread_create(&conn->reader, &attr, serviceReader, args) == 0) {
+            service->conns[service->connCount++] = conn;
+        } else {
+            close(fd);
+            pthread_mutex_destroy(&conn->writeLock);
+            free(conn);
+            free(args);
+        }
+        pthread_mutex_unlock(&service->connLock);
+        pthread_attr_destroy(&attr);
+    }
+    return NULL;
+}
+
+// Starts listening on `path` with `workers` worker threads. Returns 1 on success.
+int startInvoiceService(InvoiceService *service, const char *path, int workers) {
+    memset(service, 0, sizeof(*service));
+    struct sockaddr_un addr = {0};
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        printf("Socket path too long: %s\n", path);
+        return 0;
+    }
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path);
+    snprintf(service->path, sizeof(service->path), "%s", path);
+
+    unlink(path);
+    service->listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (service->listenFd < 0 || bind(service->listenFd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        listen(service->listenFd, 128) < 0) {
+        printf("Could not listen on %s: %s\n", path, strerror(errno));
+        if (service->listenFd >= 0)
+            close(service->listenFd);
+        return 0;
+    }
+
+    pthread_mutex_init(&service->connLock, NULL);
+    service->workers = workers;
+    service->queues = calloc(workers, sizeof(ServiceQueue));
+    for (int i = 0; i < workers; i++) {
+        ServiceQueue *q = &service->queues[i];
+        q->jobs = malloc(SERVICE_QUEUE_DEPTH * sizeof(ServiceJob));
+        pthread_mutex_init(&q->lock, NULL);
+        pthread_cond_init(&q->notEmpty, NULL);
+        pthread_cond_init(&q->notFull, NULL);
+        pthread_create(&q->thread, NULL, serviceWorker, q);
+    }
+    pthread_create(&service->acceptThread, NULL, serviceAcceptor, service);
+    return 1;
+}
+
+// Stops accepting, disconnects the clients, lets the workers finish their queues
+// and prints their statistics
+void stopInvoiceService(InvoiceService *service, int printStats) {
+    atomic_store(&service->stop, 1);
+    pthread_join(service->acceptThread, NULL);
+    close(service->listenFd);
+    unlink(service->path);
+
+    // End every reader while the workers still run, so a reader waiting on a full
+    // queue gets through before its recv sees the shutdown
+    pthread_mutex_lock(&service->connLock);
+    for (int i = 0; i < service->connCount; i++)
+        shutdown(service->conns[i]->fd, SHUT_RDWR);
+    for (int i = 0; i < service->connCount; i++) {
+        pthread_join(service->conns[i]->reader, NULL);
+        releaseServiceConn(service->conns[i]);
+    }
+    free(service->conns);
+    service->conns = NULL;
+    service->connCount = service->connCap = 0;
+    pthread_mutex_unlock(&service->connLock);
+    pthread_mutex_destroy(&service->connLock);
+
+    long invoices = 0, batches = 0, stalls = 0;
+    for (int i = 0; i < service->workers; i++) {
+        ServiceQueue *q = &service->queues[i];
+        pthread_mutex_lock(&q->lock);
+        q->stopping = 1;
+        pthread_cond_signal(&q->notEmpty);
+        pthread_mutex_unlock(&q->lock);
+        pthread_join(q->thread, NULL);
+        invoices += q->invoices;
+        batches += q->batches;
+        stalls += q->stalls;
+        free(q->jobs);
+    }
+    free(service->queues);
+    closeSegmentWriter(&segmentWriter);
+    if (printStats)
+        printf("Service: %ld invoices in %ld batches (%.1f per batch), %ld waits on full queues\n", invoices,
+               batches, batches ? (double)invoices / batches : 0.0, stalls);
+}
+
+// Runs the service until interrupted: --serve <socket> [workers]
+int runInvoiceService(const char *path, int workers) {
+    // Block the stop signals first: the service threads inherit the mask, and this
+    // thread only takes them inside sigsuspend, so none can slip in between the
+    // check of serviceInterrupted and the wait
+    sigset_t stopSignals, oldMask;
+    sigemptyset(&stopSignals);
+    sigaddset(&stopSignals, SIGINT);
+    sigaddset(&stopSignals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stopSignals, &oldMask);
+
+    InvoiceService service;
+    if (!startInvoiceService(&service, path, workers)) {
+        pthread_sigmask(SIG_SETMASK, &oldMask, NULL);
+        return 1;
+    }
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    signal(SIGINT, onServiceSignal);
+    signal(SIGTERM, onServiceSignal);
+    printf("Invoice service listening on %s with %d workers (Ctrl+C to stop)\n", path, workers);
+    fflush(stdout);
+    sigset_t waitMask = oldMask;
+    sigdelset(&waitMask, SIGINT);
+    sigdelset(&waitMask, SIGTERM);
+    while (!serviceInterrupted)
+        sigsuspend(&waitMask);
+    stopInvoiceService(&service, 1);
+    pthread_sigmask(SIG_SETMASK, &oldMask, NULL);
+    return 0;
+}
+
+// Arguments for one load-generator client
+typedef struct {
+    const char *path;
+    long requests;
+    double *latencies;             // Seconds per request
+    long failures;
+} LoadClient;
+
+// Encodes a synthetic request frame. Returns its total length.
+size_t encodeLoadRequest(long i, unsigned int *seed, uint8_t *frame) {
+    Item items[MAX_ITEMS];
+    Buyer buyer;
+    int count;
+    makeSyntheticInvoice(i, seed, items, &count, &buyer);
+
+    size_t pos = 4;
+    putLe32(frame + pos, (uint32_t)i);
+    frame[pos + 4] = FORMAT_TEXT;
+    frame[pos + 5] = 0;            // Named items with prices
+    frame[pos + 6] = count;
+    pos += 7;
+    const char *strings[3] = {buyer.name, buyer.phone, buyer.email};
+    for (int k = 0; k < 3; k++) {
+        frame[pos] = strlen(strings[k]);
+        memcpy(frame + pos + 1, strings[k], frame[pos]);
+        pos += 1 + frame[pos];
+    }
+    for (int k = 0; k < count; k++) {
+        frame[pos] = strlen(items[k].name);
+        memcpy(frame + pos + 1, items[k].name, frame[pos]);
+        pos += 1 + frame[pos];
+        putLe32(frame + pos, items[k].quantity);
+        putLe32(frame + pos + 4, (uint32_t)lroundf(items[k].price * 100));
+        pos += 8;
+    }
+    putLe32(frame, pos - 4);
+    return pos;
+}
+
+// Reads exactly `len` bytes. Returns 1 on success.
+int recvAll(int fd, void *data, size_t len) {
+    char *p = data;
+    while (len > 0) {
+        ssize_t n = recv(fd, p, len, 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return 0;
+        p += n;
+        len -= n;
+    }
+    return 1;
+}
+
+// Load-generator client: one request in flight at a time, timing each round trip
+void *loadClientThread(void *arg) {
+    LoadClient *c = arg;
+    struct sockaddr_un addr = {0};
+    addr.sun_family = AF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", c->path);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        c->failures = c->requests;
+        if (fd >= 0)
+            close(fd);
+        return NULL;
+    }
+
+    uint8_t frame[SERVICE_MAX_FRAME], response[SERVICE_MAX_RESPONSE];
+    unsigned int seed = (unsigned int)(uintptr_t)c;
+    for (long i = 0; i < c->requests; i++) {
+        size_t len = encodeLoadRequest(i, &seed, frame);
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        if (!sendAll(fd, frame, len) || !recvAll(fd, response, 4)) {
+            c->failures += c->requests - i;
+            break;
+        }
+        uint32_t responseLen = getLe32(response);
+        if (responseLen > SERVICE_MAX_RESPONSE - 4 || !recvAll(fd, response + 4, responseLen)) {
+            c->failures += c->requests - i;
+            break;
+        }
+        c->latencies[i] = secondsSince(&start);
+        if (response[8] != SERVICE_OK || getLe32(response + 4) != (uint32_t)i)
+            c->failures++;
     }
+    close(fd);
+    return NULL;
+}
+
+int compareDoubles(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Drives a running service with 1, 2, 4 ... maxClients concurrent clients and
+// reports throughput and latency percentiles at each level
+int runServiceLoad(const char *path, long requests, int maxClients) {
+    printf("%8s %12s %10s %10s %10s %9s\n", "Clients", "Invoices/s", "p50 us", "p99 us", "max us", "Failures");
+    double *latencies = malloc(requests * sizeof(double));
+    LoadClient *clients = malloc(maxClients * sizeof(LoadClient));
+    pthread_t *threads = malloc(maxClients * sizeof(pthread_t));
+    long totalFailures = 0;
+
+    for (int n = 1; n <= maxClients; n = n * 2 > maxClients && n < maxClients ? maxClients : n * 2) {
+        long offset = 0;
+        memset(latencies, 0, requests * sizeof(double));
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int t = 0; t < n; t++) {
+            clients[t].path = path;
+            clients[t].requests = requests / n + (t < requests % n ? 1 : 0);
+            clients[t].latencies = latencies + offset;
+            clients[t].failures = 0;
+            offset += clients[t].requests;
+            pthread_create(&threads[t], NULL, loadClientThread, &clients[t]);
+        }
+        long failures = 0;
+        for (int t = 0; t < n; t++) {
+            pthread_join(threads[t], NULL);
+            failures += clients[t].failures;
+        }
+        double seconds = secondsSince(&start);
 
-    // Calculate tax and grand total
-    tax = subtotal * TAX_RATE;
-    grandTotal = subtotal + tax;
+        qsort(latencies, requests, sizeof(double), compareDoubles);
+        printf("%8d %12.0f %10.1f %10.1f %10.1f %9ld\n", n, requests / seconds, latencies[requests / 2] * 1e6,
+               latencies[(long)(requests * 0.99)] * 1e6, latencies[requests - 1] * 1e6, failures);
+        totalFailures += failures;
+    }
 
-    // Print and write totals
-    printf("\nSubtotal: %.2f\n", subtotal);
-    printf("GST (%.0f%%): %.2f\n", TAX_RATE * 100, tax);
-    printf("Grand Total: %.2f\n", grandTotal);
+    free(latencies);
+    free(clients);
+    free(threads);
+    return totalFailures == 0 ? 0 : 1;
+}
 
-    fprintf(fptr, "\nSubtotal: %.2f\n", subtotal);
-    fprintf(fptr, "GST (%.0f%%): %.2f\n", TAX_RATE * 100, tax);
-    fprintf(fptr, "Grand Total: %.2f\n", grandTotal);
+// Removes a directory and everything below it. Returns 1 on success.
+int removeTree(const char *path) {
+    DIR *dir = opendir(path);
+    if (!dir)
+        return remove(path) == 0;
+    struct dirent *entry;
+    int ok = 1;
+    while ((entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+            continue;
+        char child[4096];
+        snprintf(child, sizeof(child), "%s/%s", path, entry->d_name);
+        struct stat st;
+        if (lstat(child, &st) == 0 && S_ISDIR(st.st_mode))
+            ok = removeTree(child) && ok;
+        else
+            ok = unlink(child) == 0 && ok;
+    }
+    closedir(dir);
+    return rmdir(path) == 0 && ok;
+}
 
-    fclose(fptr);
+// Starts the service in a scratch directory, runs the load generator against it
+// and removes everything afterwards: --bench-service [requests] [clients] [workers]
+int runServiceBenchmark(long requests, int maxClients, int workers) {
+    char dir[] = "/tmp/invoice_serviceXXXXXX";
+    char home[4096];
+    if (!getcwd(home, sizeof(home)) || !mkdtemp(dir)) {
+        printf("Could not create a scratch directory.\n");
+        return 1;
+    }
+    int result = 1;
+    if (chdir(dir) != 0 || mkdir(INVOICE_FOLDER, 0755) != 0) {
+        printf("Could not set up the scratch directory %s.\n", dir);
+    } else {
+        char path[128];
+        snprintf(path, sizeof(path), "%s/invoice.sock", dir);
+        InvoiceService service;
+        if (startInvoiceService(&service, path, workers)) {
+            printf("Requests per level: %ld, workers: %d, storage: %s\n", requests, workers,
+                   useInvoiceSegments ? "segment" : "text files");
+            result = runServiceLoad(path, requests, maxClients);
+            stopInvoiceService(&service, 1);
+        }
+    }
 
-    printf("\nInvoice saved to %s\n", filename);
+    if (chdir(home) != 0 || !removeTree(dir))
+        printf("Could not remove the scratch directory %s.\n", dir);
+    return result;
 }
 
 // Lists all invoice files in the "invoices" directory
@@ -189,6 +3432,10 @@ void listPastInvoices() {
         }
     }
     closedir(dir);
+
+    // Then the invoices kept in compact segments
+    long stored = 0;
+    scanAllInvoiceSegments(listStoredInvoice, &stored, NULL);
 }
 
 // Displays the contents of a selected invoice file
@@ -201,7 +3448,9 @@ void viewInvoiceByName() {
     sprintf(path, "%s/%s", INVOICE_FOLDER, fname);
     FILE *fp = fopen(path, "r");
     if (!fp) {
-        printf("File not found!\n");
+        // Not a text file: render it from the segments if it is stored there
+        if (!viewStoredInvoice(fname))
+            printf("File not found!\n");
         return;
     }
 
@@ -213,10 +3462,112 @@ void viewInvoiceByName() {
 }
 
 // Main program loop
-int main() {
+int main(int argc, char *argv[]) {
+    initInvoiceIdAllocator();
+    const char *storage = getenv("INVOICE_STORAGE");
+    useInvoiceSegments = storage && strcmp(storage, "segment") == 0;
+
+    // Non-interactive rendering benchmark: --bench-render [invoices]
+    if (argc > 1 && strcmp(argv[1], "--bench-render") == 0) {
+        long invoices = argc > 2 ? atol(argv[2]) : 1000000;
+        if (invoices < 1) {
+            printf("Usage: %s --bench-render [invoices]\n", argv[0]);
+            return 1;
+        }
+        return runRenderBenchmark(invoices);
+    }
+
+    // Non-interactive storage benchmark: --bench-storage [invoices]
+    if (argc > 1 && strcmp(argv[1], "--bench-storage") == 0) {
+        long invoices = argc > 2 ? atol(argv[2]) : 1000000;
+        if (invoices < 1) {
+            printf("Usage: %s --bench-storage [invoices]\n", argv[0]);
+            return 1;
+        }
+        return runStorageBenchmark(invoices);
+    }
+
+    // Non-interactive sales reports: --report / --report-incremental [threads]
+    if (argc > 1 && (strcmp(argv[1], "--report") == 0 || strcmp(argv[1], "--report-incremental") == 0)) {
+        int threads = argc > 2 ? atoi(argv[2]) : (int)sysconf(_SC_NPROCESSORS_ONLN);
+        return runSalesReport(SALES_LEDGER, REPORT_STATE, argv[1][8] == '-', threads, 1);
+    }
+
+    // Non-interactive report benchmark: --bench-report [invoices] [threads]
+    if (argc > 1 && strcmp(argv[1], "--bench-report") == 0) {
+        long invoices = argc > 2 ? atol(argv[2]) : 1000000;
+        int threads = argc > 3 ? atoi(argv[3]) : (int)sysconf(_SC_NPROCESSORS_ONLN);
+        if (invoices < 1 || threads < 1) {
+            printf("Usage: %s --bench-report [invoices] [threads]\n", argv[0]);
+            return 1;
+        }
+        return runReportBenchmark(invoices, threads);
+    }
+
+    // Non-interactive catalog benchmark: --bench-catalog [skus]
+    if (argc > 1 && strcmp(argv[1], "--bench-catalog") == 0) {
+        long skus = argc > 2 ? atol(argv[2]) : 10000000;
+        if (skus < 1) {
+            printf("Usage: %s --bench-catalog [skus]\n", argv[0]);
+            return 1;
+        }
+        return runCatalogBenchmark(skus);
+    }
+
+    // Non-interactive stress test: --stress [invoices] [threads]
+    if (argc > 1 && strcmp(argv[1], "--stress") == 0) {
+        long total = argc > 2 ? atol(argv[2]) : 1000000;
+        int threads = argc > 3 ? atoi(argv[3]) : 16;
+        if (total < 1 || threads < 1) {
+            printf("Usage: %s --stress [invoices] [threads]\n", argv[0]);
+            return 1;
+        }
+        return runStressTest(total, threads);
+    }
+
+    // Load generator against a running service: --load-test <socket> [requests] [clients]
+    if (argc > 2 && strcmp(argv[1], "--load-test") == 0) {
+        long requests = argc > 3 ? atol(argv[3]) : 100000;
+        int clients = argc > 4 ? atoi(argv[4]) : 64;
+        if (requests < 1 || clients < 1) {
+            printf("Usage: %s --load-test <socket> [requests] [clients]\n", argv[0]);
+            return 1;
+        }
+        return runServiceLoad(argv[2], requests, clients);
+    }
+
+    // Service benchmark in a scratch directory: --bench-service [requests] [clients] [workers]
+    if (argc > 1 && strcmp(argv[1], "--bench-service") == 0) {
+        long requests = argc > 2 ? atol(argv[2]) : 20000;
+        int clients = argc > 3 ? atoi(argv[3]) : 64;
+        int workers = argc > 4 ? atoi(argv[4]) : (int)sysconf(_SC_NPROCESSORS_ONLN);
+        if (requests < 1 || clients < 1 || workers < 1) {
+            printf("Usage: %s --bench-service [requests] [clients] [workers]\n", argv[0]);
+            return 1;
+        }
+        return runServiceBenchmark(requests, clients, workers);
+    }
+
     // Create the invoices directory if it doesn't exist (works on Linux/Mac; for Windows, use mkdir invoices)
     system("mkdir -p " INVOICE_FOLDER);
 
+    // Load the product catalog if there is one
+    FILE *catalogProbe = fopen(CATALOG_FILE, "r");
+    if (catalogProbe) {
+        fclose(catalogProbe);
+        reloadCatalog(CATALOG_FILE);
+    }
+
+    // Long-running service instead of the menu: --serve <socket> [workers]
+    if (argc > 2 && strcmp(argv[1], "--serve") == 0) {
+        int workers = argc > 3 ? atoi(argv[3]) : (int)sysconf(_SC_NPROCESSORS_ONLN);
+        if (workers < 1) {
+            printf("Usage: %s --serve <socket> [workers]\n", argv[0]);
+            return 1;
+        }
+        return runInvoiceService(argv[2], workers);
+    }
+
     int choice;
     do {
         // Display main menu
@@ -225,6 +3576,8 @@ int main() {
         printf("1. Generate New Invoice\n");
         printf("2. List Past Invoices\n");
         printf("3. View Specific Invoice\n");
+        printf("4. Reload Product Catalog\n");
+        printf("5. Sales Report\n");
         printf("0. Exit\n");
         printf("=========================\n");
         printf("Enter choice: ");
@@ -254,6 +3607,7 @@ int main() {
             printf("\nItem Entry Method:\n");
             printf("1. Load items from CSV (items.csv)\n");
             printf("2. Enter items manually\n");
+            printf("3. Enter items by SKU (catalog.csv)\n");
             printf("Enter your choice: ");
             scanf("%d", &inputChoice);
             getchar();
@@ -284,24 +3638,72 @@ int main() {
                     getchar();
 
                     items[i].total = items[i].quantity * items[i].price;
+                    items[i].taxRate = TAX_RATE;
+                }
+            } else if (inputChoice == 3) {
+                // Items by SKU, priced from the product catalog
+                char skus[MAX_ITEMS][CATALOG_MAX_SKU];
+                int quantities[MAX_ITEMS];
+                int lineCount = 0, badLine = 0;
+
+                printf("Enter number of lines: ");
+                if (scanf("%d", &lineCount) != 1 || lineCount < 1 || lineCount > MAX_ITEMS) {
+                    printf("Number of lines must be between 1 and %d.\n", MAX_ITEMS);
+                    scanf("%*[^\n]");
+                    continue;
+                }
+                for (int i = 0; i < lineCount && !badLine; i++) {
+                    printf("Line %d (SKU Quantity): ", i + 1);
+                    badLine = scanf("%31s %d", skus[i], &quantities[i]) != 2;
+                }
+                scanf("%*[^\n]");
+                getchar();
+                if (badLine) {
+                    printf("Each line needs a SKU and a quantity. Aborting invoice.\n");
+                    continue;
+                }
+
+                itemCount = resolveCatalogItems(skus, quantities, lineCount, items);
+                if (itemCount == 0) {
+                    printf("No catalog items resolved. Aborting invoice.\n");
+                    continue;
                 }
             } else {
                 printf("Invalid input method. Try again.\n");
                 continue;
             }
 
+            // Choose the output format
+            int formatChoice;
+            printf("\nOutput Format:\n");
+            printf("1. Text\n");
+            printf("2. HTML\n");
+            printf("3. PDF\n");
+            printf("Enter your choice: ");
+            if (scanf("%d", &formatChoice) != 1 || formatChoice < 1 || formatChoice > 3)
+                formatChoice = 1;
+            getchar();
+
             // Generate and save the invoice
-            generateInvoice(items, itemCount, buyer);
+            generateInvoice(items, itemCount, buyer, (InvoiceFormat)(formatChoice - 1));
         } else if (choice == 2) {
             // List all past invoices
             listPastInvoices();
         } else if (choice == 3) {
             // View a specific invoice by filename
             viewInvoiceByName();
+        } else if (choice == 4) {
+            // Swap in a freshly loaded catalog
+            if (reloadCatalog(CATALOG_FILE))
+                printf("Catalog reloaded: %zu products.\n", catalogSize());
+        } else if (choice == 5) {
+            // Totals by day, buyer and item over all invoices
+            runSalesReport(SALES_LEDGER, REPORT_STATE, 0, (int)sysconf(_SC_NPROCESSORS_ONLN), 1);
         }
 
     } while (choice != 0);
 
+    closeSegmentWriter(&segmentWriter);
     printf("Exiting Invoice Generator. Goodbye!\n");
     return 0;
 }
@@ -3,6 +3,14 @@
 #include <math.h>
 #include <string.h>
 #include <time.h>
+#include <pthread.h>
+
+#ifndef _WIN32
+#include <unistd.h> // For sysconf
+#endif
+
+// Most worker threads --stats and --bench-stats accept
+#define STATS_MAX_THREADS 256
 
 // Function declarations
 void showMenu();
@@ -10,11 +18,40 @@ void performOperation(int choice);
 void logHistory(char *operation);
 void clearHistory();
 void viewHistory();
+void runStatistics(const char *path, int threads);
+int runStatsBenchmark(long long count, int threads);
+int cpuCount();
 
 // Main function
-int main()
+int main(int argc, char *argv[])
 {
     int choice;
+
+    // --stats [file] [threads]: statistics of the numbers in a file or piped on stdin
+    if (argc > 1 && strcmp(argv[1], "--stats") == 0)
+    {
+        int threads = argc > 3 ? atoi(argv[3]) : cpuCount();
+        if (threads < 1 || threads > STATS_MAX_THREADS)
+        {
+            printf("Usage: %s --stats [file] [threads, 1 to %d]\n", argv[0], STATS_MAX_THREADS);
+            return 1;
+        }
+        runStatistics(argc > 2 ? argv[2] : "-", threads);
+        return 0;
+    }
+    // --bench-stats [count] [threads]: throughput and accuracy against a naive loop
+    if (argc > 1 && strcmp(argv[1], "--bench-stats") == 0)
+    {
+        long long count = argc > 2 ? atoll(argv[2]) : 10000000;
+        int threads = argc > 3 ? atoi(argv[3]) : cpuCount();
+        if (count < 4 || threads < 1 || threads > STATS_MAX_THREADS)
+        {
+            printf("Usage: %s --bench-stats [count, at least 4] [threads, 1 to %d]\n", argv[0], STATS_MAX_THREADS);
+            return 1;
+        }
+        return runStatsBenchmark(count, threads);
+    }
+
     do
     {
         showMenu();
@@ -32,6 +69,13 @@ int main()
         {
             viewHistory();
         }
+        else if (choice == 10)
+        {
+            char path[256];
+            printf("Enter file with numbers: ");
+            if (scanf("%255s", path) == 1)
+                runStatistics(path, cpuCount());
+        }
         else if (choice != 0)
         {
             performOperation(choice);
@@ -55,6 +99,7 @@ void showMenu()
     printf("7. Power (x^y)\n");
     printf("8. Clear History\n");
     printf("9. View History\n");
+    printf("10. Statistics of Numbers in a File\n");
     printf("0. Exit\n");
     printf("============================\n");
 }
@@ -207,3 +252,721 @@ void clearHistory()
     fclose(log);
     printf("History cleared successfully.\n");
 }
+
+// ---------------------------------------------------------------------------
+// Statistics mode
+// ---------------------------------------------------------------------------
+
+// Numbers are read in large chunks and spread over worker threads. Each worker
+// keeps a partial StatsState; partial states merge exactly (Chan et al. for the
+// variance, compensated addition for the sum, bucket-wise for the sketch), so
+// the result does not depend on how the input was split.
+#define STATS_CHUNK_SIZE (4 << 20)   // Bytes of text per work item
+#define STATS_BLOCK 1024             // Values summed pairwise before merging
+#define STATS_QUEUE_DEPTH 4          // Chunks waiting per worker (backpressure on the reader)
+
+// Quantile sketch: logarithmic buckets with 1% relative accuracy, clamped to a
+// fixed range so memory stays bounded whatever the input size. The bucket of x
+// comes from its binary exponent plus a linear approximation of log2 of the
+// mantissa (no log call); the multiplier is scaled by 1/ln 2 so the coarsest
+// bucket is still within SKETCH_GAMMA.
+#define SKETCH_ACCURACY 0.01
+#define SKETCH_GAMMA ((1 + SKETCH_ACCURACY) / (1 - SKETCH_ACCURACY))
+#define SKETCH_MAX_INDEX 8192        // |values| from about 1e-49 to 1e49 keep full accuracy
+#define SKETCH_BUCKETS (2 * SKETCH_MAX_INDEX + 1)
+
+typedef struct
+{
+    long long positive[SKETCH_BUCKETS];
+    long long negative[SKETCH_BUCKETS];
+    long long zeros;
+} QuantileSketch;
+
+typedef struct
+{
+    long long count;
+    double mean, m2;        // Running mean and sum of squared deviations
+    double sum, sumError;   // Compensated (Kahan-Babuska) sum
+    double min, max;
+    long long skipped;      // Tokens that were not numbers
+    QuantileSketch sketch;
+} StatsState;
+
+// Buckets per unit of approximate log2
+double sketchMultiplier()
+{
+    static double multiplier = 0;
+    if (multiplier == 0)
+        multiplier = 1 / log(SKETCH_GAMMA);
+    return multiplier;
+}
+
+// Bucket of |x| (x > 0)
+int sketchIndex(double x)
+{
+    unsigned long long bits;
+    memcpy(&bits, &x, sizeof(bits));
+    int exponent = (int)(bits >> 52 & 0x7ff) - 1023;
+    double fraction = (double)(bits & ((1ULL << 52) - 1)) * (1.0 / (1ULL << 52));
+    double v = (exponent + fraction) * sketchMultiplier();
+    long long i = (long long)v;
+    if (i < v)
+        i++;         // ceil without a library call
+    if (i > SKETCH_MAX_INDEX)
+        i = SKETCH_MAX_INDEX;
+    if (i < -SKETCH_MAX_INDEX)
+        i = -SKETCH_MAX_INDEX;
+    return (int)i + SKETCH_MAX_INDEX;
+}
+
+// Inverse of the approximate log2 used by sketchIndex
+double sketchBound(double v)
+{
+    double exponent = floor(v);
+    return ldexp(1 + (v - exponent), (int)exponent);
+}
+
+// Representative value of a bucket: the harmonic mean of its bounds is within
+// SKETCH_ACCURACY of everything in it
+double sketchValue(int bucket)
+{
+    double i = bucket - SKETCH_MAX_INDEX;
+    double low = sketchBound((i - 1) / sketchMultiplier()), high = sketchBound(i / sketchMultiplier());
+    return 2 * low * high / (low + high);
+}
+
+void sketchAdd(QuantileSketch *s, double x)
+{
+    if (x > 0)
+        s->positive[sketchIndex(x)]++;
+    else if (x < 0)
+        s->negative[sketchIndex(-x)]++;
+    else
+        s->zeros++;
+}
+
+void sketchMerge(QuantileSketch *into, const QuantileSketch *from)
+{
+    for (int i = 0; i < SKETCH_BUCKETS; i++)
+    {
+        into->positive[i] += from->positive[i];
+        into->negative[i] += from->negative[i];
+    }
+    into->zeros += from->zeros;
+}
+
+// Value at quantile q (0..1) of `count` values
+double sketchQuantile(const QuantileSketch *s, long long count, double q)
+{
+    long long rank = (long long)(q * (count - 1)), seen = 0;
+    for (int i = SKETCH_BUCKETS - 1; i >= 0; i--)    // Most negative first
+    {
+        seen += s->negative[i];
+        if (seen > rank)
+            return -sketchValue(i);
+    }
+    seen += s->zeros;
+    if (seen > rank)
+        return 0;
+    for (int i = 0; i < SKETCH_BUCKETS; i++)
+    {
+        seen += s->positive[i];
+        if (seen > rank)
+            return sketchValue(i);
+    }
+    return 0;
+}
+
+void statsInit(StatsState *s)
+{
+    memset(s, 0, sizeof(*s));
+    s->min = INFINITY;
+    s->max = -INFINITY;
+}
+
+// Compensated addition: sum + sumError holds the exact running total far better than a plain double
+void addCompensated(double *sum, double *error, double x)
+{
+    double t = *sum + x;
+    if (fabs(*sum) >= fabs(x))
+        *error += (*sum - t) + x;
+    else
+        *error += (x - t) + *sum;
+    *sum = t;
+}
+
+// Merges a partial result (count, mean, m2) into a state (Chan et al.)
+void mergeMoments(StatsState *s, long long count, double mean, double m2)
+{
+    if (count == 0)
+        return;
+    long long total = s->count + count;
+    double delta = mean - s->mean;
+    s->mean += delta * count / total;
+    s->m2 += m2 + delta * delta * ((double)s->count * count / total);
+    s->count = total;
+}
+
+// Pairwise sum of x[0..n)
+double pairwiseSum(const double *x, int n)
+{
+    if (n <= 16)
+    {
+        double sum = 0;
+        for (int i = 0; i < n; i++)
+            sum += x[i];
+        return sum;
+    }
+    return pairwiseSum(x, n / 2) + pairwiseSum(x + n / 2, n - n / 2);
+}
+
+// Adds a block of values: pairwise sum and a second pass over the block for its
+// squared deviations (the block is in cache), then one merge into the state
+void statsAddBlock(StatsState *s, const double *x, int n)
+{
+    if (n == 0)
+        return;
+    double blockSum = pairwiseSum(x, n);
+    double blockMean = blockSum / n, m2 = 0, correction = 0;
+    for (int i = 0; i < n; i++)
+    {
+        double d = x[i] - blockMean;
+        m2 += d * d;
+        correction += d;
+        if (x[i] < s->min)
+            s->min = x[i];
+        if (x[i] > s->max)
+            s->max = x[i];
+        sketchAdd(&s->sketch, x[i]);
+    }
+    m2 -= correction * correction / n;   // Removes the rounding error of blockMean
+    addCompensated(&s->sum, &s->sumError, blockSum);
+    mergeMoments(s, n, blockMean, m2);
+}
+
+// Combines two partial states
+void statsMerge(StatsState *into, const StatsState *from)
+{
+    addCompensated(&into->sum, &into->sumError, from->sum);
+    into->sumError += from->sumError;
+    mergeMoments(into, from->count, from->mean, from->m2);
+    if (from->min < into->min)
+        into->min = from->min;
+    if (from->max > into->max)
+        into->max = from->max;
+    into->skipped += from->skipped;
+    sketchMerge(&into->sketch, &from->sketch);
+}
+
+// Parses one decimal number. Plain decimals of up to 19 digits with a small
+// exponent are converted exactly (an exact integer times or divided by an exact
+// power of ten); anything else goes to strtod, except tokens too long for its
+// buffer, which are not numbers. Returns the end of the token.
+const char *parseValue(const char *p, const char *end, double *value, int *ok)
+{
+    static const double powersOfTen[23] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    const char *start = p;
+    int negative = 0;
+    if (p < end && (*p == '-' || *p == '+'))
+        negative = *p++ == '-';
+
+    unsigned long long mantissa = 0;
+    int digits = 0, exponent = 0;
+    while (p < end && *p >= '0' && *p <= '9')
+    {
+        mantissa = mantissa * 10 + (*p++ - '0');
+        digits++;
+    }
+    if (p < end && *p == '.')
+    {
+        for (p++; p < end && *p >= '0' && *p <= '9'; p++)
+        {
+            mantissa = mantissa * 10 + (*p - '0');
+            digits++;
+            exponent--;
+        }
+    }
+    if (p < end && (*p == 'e' || *p == 'E'))
+    {
+        int expNegative = 0, e = 0, expDigits = 0;
+        p++;
+        if (p < end && (*p == '-' || *p == '+'))
+            expNegative = *p++ == '-';
+        while (p < end && *p >= '0' && *p <= '9' && e < 100000)
+        {
+            e = e * 10 + (*p++ - '0');
+            expDigits++;
+        }
+        if (expDigits == 0)
+            digits = 0; // "1e" or "1e+" is not a number; leave it to strtod
+        exponent += expNegative ? -e : e;
+    }
+
+    int tokenEnds = p == end || *p == ' ' || *p == '\n' || *p == '\t' || *p == '\r' || *p == ',';
+    if (digits > 0 && digits <= 19 && tokenEnds && mantissa < (1ULL << 53) && exponent >= -22 && exponent <= 22)
+    {
+        double v = (double)mantissa;
+        v = exponent < 0 ? v / powersOfTen[-exponent] : v * powersOfTen[exponent];
+        *value = negative ? -v : v;
+        *ok = 1;
+        return p;
+    }
+
+    // Slow path: copy the token and let strtod decide
+    while (p < end && *p != ' ' && *p != '\n' && *p != '\t' && *p != '\r' && *p != ',')
+        p++;
+    char token[64];
+    size_t len = p - start;
+    if (len >= sizeof(token))
+    {
+        *ok = 0;
+        return p;
+    }
+    memcpy(token, start, len);
+    token[len] = '\0';
+    char *tokenEnd;
+    *value = strtod(token, &tokenEnd);
+    *ok = len > 0 && *tokenEnd == '\0' && !isnan(*value);
+    return p;
+}
+
+// Parses every number in a chunk of text into a state
+void statsParseChunk(StatsState *s, const char *p, const char *end)
+{
+    double block[STATS_BLOCK];
+    int n = 0;
+    while (p < end)
+    {
+        if (*p == ' ' || *p == '\n' || *p == '\t' || *p == '\r' || *p == ',')
+        {
+            p++;
+            continue;
+        }
+        int ok;
+        p = parseValue(p, end, &block[n], &ok);
+        if (!ok)
+            s->skipped++;
+        else if (++n == STATS_BLOCK)
+        {
+            statsAddBlock(s, block, n);
+            n = 0;
+        }
+    }
+    statsAddBlock(s, block, n);
+}
+
+// Work queue between the reader and the workers
+typedef struct
+{
+    char *data;
+    size_t len;
+} StatsChunk;
+
+typedef struct
+{
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    StatsChunk *items;
+    int capacity, head, count, done;
+} StatsQueue;
+
+typedef struct
+{
+    StatsQueue *queue;
+    StatsState state;
+} StatsWorker;
+
+void *statsWorkerMain(void *arg)
+{
+    StatsWorker *w = arg;
+    StatsQueue *q = w->queue;
+    while (1)
+    {
+        pthread_mutex_lock(&q->lock);
+        while (q->count == 0 && !q->done)
+            pthread_cond_wait(&q->changed, &q->lock);
+        if (q->count == 0)
+        {
+            pthread_mutex_unlock(&q->lock);
+            return NULL;
+        }
+        StatsChunk chunk = q->items[q->head];
+        q->head = (q->head + 1) % q->capacity;
+        q->count--;
+        pthread_cond_broadcast(&q->changed);
+        pthread_mutex_unlock(&q->lock);
+
+        statsParseChunk(&w->state, chunk.data, chunk.data + chunk.len);
+        free(chunk.data);
+    }
+}
+
+// Number of processors to use by default
+int cpuCount()
+{
+#ifdef _WIN32
+    return 4;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n < 1 ? 1 : n > STATS_MAX_THREADS ? STATS_MAX_THREADS : (int)n;
+#endif
+}
+
+// Reads numbers from fp with `threads` workers and returns the merged state, or
+// NULL when memory runs out
+StatsState *computeStats(FILE *fp, int threads)
+{
+    StatsQueue queue;
+    queue.capacity = threads * STATS_QUEUE_DEPTH;
+    queue.items = malloc(queue.capacity * sizeof(StatsChunk));
+    queue.head = queue.count = queue.done = 0;
+    StatsWorker *workers = malloc(threads * sizeof(StatsWorker));
+    pthread_t *ids = malloc(threads * sizeof(pthread_t));
+    StatsState *total = malloc(sizeof(StatsState));
+    if (!queue.items || !workers || !ids || !total)
+    {
+        free(queue.items);
+        free(workers);
+        free(ids);
+        free(total);
+        return NULL;
+    }
+    pthread_mutex_init(&queue.lock, NULL);
+    pthread_cond_init(&queue.changed, NULL);
+
+    // Go on with the workers that started; the queue only needs one
+    int started = 0;
+    while (started < threads)
+    {
+        workers[started].queue = &queue;
+        statsInit(&workers[started].state);
+        if (pthread_create(&ids[started], NULL, statsWorkerMain, &workers[started]) != 0)
+            break;
+        started++;
+    }
+    if (started < threads)
+        fprintf(stderr, "Warning: started %d of %d threads\n", started, threads);
+
+    // Read chunks, cutting each after its last separator; the rest starts the next chunk
+    char *carry = NULL;
+    size_t carryLen = 0;
+    int failed = started == 0;
+    while (!failed)
+    {
+        char *data = malloc(STATS_CHUNK_SIZE + carryLen);
+        if (!data)
+        {
+            failed = 1;
+            break;
+        }
+        if (carryLen)
+            memcpy(data, carry, carryLen);
+        free(carry);
+        carry = NULL;
+        size_t len = carryLen + fread(data + carryLen, 1, STATS_CHUNK_SIZE, fp);
+        int last = len == carryLen;
+        size_t cut = len;
+        if (!last)
+        {
+            while (cut > 0 && data[cut - 1] != '\n' && data[cut - 1] != ' ' && data[cut - 1] != '\t' && data[cut - 1] != ',')
+                cut--;
+            if (cut == 0)
+                cut = len;   // One enormous token: let the parser reject it
+        }
+        carryLen = len - cut;
+        if (carryLen)
+        {
+            carry = malloc(carryLen);
+            if (!carry)
+            {
+                free(data);
+                failed = 1;
+                break;
+            }
+            memcpy(carry, data + cut, carryLen);
+        }
+
+        pthread_mutex_lock(&queue.lock);
+        while (queue.count == queue.capacity)
+            pthread_cond_wait(&queue.changed, &queue.lock);
+        queue.items[(queue.head + queue.count) % queue.capacity] = (StatsChunk){data, cut};
+        queue.count++;
+        if (last)
+            queue.done = 1;
+        pthread_cond_broadcast(&queue.changed);
+        pthread_mutex_unlock(&queue.lock);
+        if (last)
+            break;
+    }
+
+    // On failure the workers still finish what was queued before they stop
+    if (failed)
+    {
+        pthread_mutex_lock(&queue.lock);
+        queue.done = 1;
+        pthread_cond_broadcast(&queue.changed);
+        pthread_mutex_unlock(&queue.lock);
+    }
+    statsInit(total);
+    for (int i = 0; i < started; i++)
+    {
+        pthread_join(ids[i], NULL);
+        statsMerge(total, &workers[i].state);
+    }
+    free(ids);
+    free(workers);
+    free(queue.items);
+    pthread_mutex_destroy(&queue.lock);
+    pthread_cond_destroy(&queue.changed);
+    if (failed)
+    {
+        free(total);
+        return NULL;
+    }
+    return total;
+}
+
+// Prints a summary of the numbers read from path ("-" for stdin) and logs it
+void runStatistics(const char *path, int threads)
+{
+    FILE *fp = strcmp(path, "-") == 0 ? stdin : fopen(path, "rb");
+    if (fp == NULL)
+    {
+        printf("Error: Could not open %s\n", path);
+        return;
+    }
+    StatsState *s = computeStats(fp, threads);
+    if (fp != stdin)
+        fclose(fp);
+    if (s == NULL)
+    {
+        printf("Error: Out of memory\n");
+        return;
+    }
+
+    if (s->count == 0)
+    {
+        printf("No numbers found.\n");
+        free(s);
+        return;
+    }
+    double variance = s->count > 1 ? s->m2 / (s->count - 1) : 0;
+    printf("\n------ Statistics ------\n");
+    printf("Count     : %lld\n", s->count);
+    if (s->skipped)
+        printf("Skipped   : %lld (not numbers)\n", s->skipped);
+    printf("Sum       : %.17g\n", s->sum + s->sumError);
+    printf("Mean      : %.17g\n", s->mean);
+    printf("Variance  : %.17g (sample)\n", variance);
+    printf("Std dev   : %.17g\n", sqrt(variance));
+    printf("Min       : %.17g\n", s->min);
+    printf("Max       : %.17g\n", s->max);
+    printf("p50       : %.6g\n", sketchQuantile(&s->sketch, s->count, 0.50));
+    printf("p90       : %.6g\n", sketchQuantile(&s->sketch, s->count, 0.90));
+    printf("p99       : %.6g\n", sketchQuantile(&s->sketch, s->count, 0.99));
+    printf("p99.9     : %.6g  (percentiles within %.0f%%)\n", sketchQuantile(&s->sketch, s->count, 0.999), SKETCH_ACCURACY * 100);
+    printf("------------------------\n");
+
+    char operation[200];
+    sprintf(operation, "Statistics: n = %lld, mean = %.6g, std dev = %.6g, min = %.6g, max = %.6g",
+            s->count, s->mean, sqrt(variance), s->min, s->max);
+    logHistory(operation);
+    free(s);
+}
+
+// Benchmark: partitioned reduction over an in-memory slice
+typedef struct
+{
+    const double *values;
+    long long count;
+    StatsState state;
+} StatsSlice;
+
+void *statsSliceMain(void *arg)
+{
+    StatsSlice *slice = arg;
+    for (long long i = 0; i < slice->count; i += STATS_BLOCK)
+    {
+        long long n = slice->count - i < STATS_BLOCK ? slice->count - i : STATS_BLOCK;
+        statsAddBlock(&slice->state, slice->values + i, (int)n);
+    }
+    return NULL;
+}
+
+// Statistics of values[0..count) split over `threads` threads. A slice whose
+// thread cannot be started is done by the caller. Returns 0 when out of memory.
+int statsOverArray(StatsState *total, const double *values, long long count, int threads)
+{
+    StatsSlice *slices = malloc(threads * sizeof(StatsSlice));
+    pthread_t *ids = malloc(threads * sizeof(pthread_t));
+    char *threaded = malloc(threads);
+    if (!slices || !ids || !threaded)
+    {
+        free(slices);
+        free(ids);
+        free(threaded);
+        return 0;
+    }
+    for (int t = 0; t < threads; t++)
+    {
+        long long from = count * t / threads, to = count * (t + 1) / threads;
+        slices[t].values = values + from;
+        slices[t].count = to - from;
+        statsInit(&slices[t].state);
+        threaded[t] = pthread_create(&ids[t], NULL, statsSliceMain, &slices[t]) == 0;
+    }
+    statsInit(total);
+    for (int t = 0; t < threads; t++)
+    {
+        if (threaded[t])
+            pthread_join(ids[t], NULL);
+        else
+            statsSliceMain(&slices[t]);
+        statsMerge(total, &slices[t].state);
+    }
+    free(threaded);
+    free(ids);
+    free(slices);
+    return 1;
+}
+
+// Wall-clock seconds
+double nowSeconds()
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int compareDoubles(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+double relativeError(double value, double reference)
+{
+    return reference == 0 ? fabs(value) : fabs((value - reference) / reference);
+}
+
+// Throughput and accuracy of the statistics code against a naive double loop,
+// on values with a large offset (1e9 + noise) where naive variance breaks down
+// and a skewed latency-like set for the percentiles
+int runStatsBenchmark(long long count, int threads)
+{
+    double *values = malloc(count * sizeof(double));
+    StatsState *single = malloc(sizeof(StatsState)), *parallel = malloc(sizeof(StatsState));
+    StatsState *skewed = malloc(sizeof(StatsState)), *parsed = malloc(sizeof(StatsState));
+    size_t textSize = (size_t)(count < 2000000 ? count : 2000000) * 24;
+    char *text = malloc(textSize);
+    if (!values || !single || !parallel || !skewed || !parsed || !text)
+    {
+        printf("Error: Out of memory\n");
+        free(text);
+        free(parsed);
+        free(skewed);
+        free(parallel);
+        free(single);
+        free(values);
+        return 1;
+    }
+    srand(41);
+    for (long long i = 0; i < count; i++)
+    {
+        double noise = ((double)rand() + rand() + rand() - 1.5 * RAND_MAX) / RAND_MAX;   // Roughly normal
+        values[i] = i < count / 2 ? 1e9 + noise : exp(3 + noise * 1.5);         // Offset and skewed halves
+    }
+    long long half = count / 2;
+
+    // Reference: two passes in long double with compensated summation
+    long double refSum = 0, c = 0;
+    for (long long i = 0; i < half; i++)
+    {
+        long double y = values[i] - c, t = refSum + y;
+        c = (t - refSum) - y;
+        refSum = t;
+    }
+    long double refMean = refSum / half, refM2 = 0;
+    for (long long i = 0; i < half; i++)
+        refM2 += (values[i] - refMean) * (values[i] - refMean);
+    double refVariance = (double)(refM2 / (half - 1));
+
+    // Naive single loop
+    double start = nowSeconds();
+    double sum = 0, sumSquares = 0, min = INFINITY, max = -INFINITY;
+    for (long long i = 0; i < half; i++)
+    {
+        sum += values[i];
+        sumSquares += values[i] * values[i];
+        if (values[i] < min)
+            min = values[i];
+        if (values[i] > max)
+            max = values[i];
+    }
+    double naiveSeconds = nowSeconds() - start;
+    double naiveVariance = (sumSquares - sum * sum / half) / (half - 1);
+
+    start = nowSeconds();
+    int ok = statsOverArray(single, values, half, 1);
+    double singleSeconds = nowSeconds() - start;
+    start = nowSeconds();
+    ok = ok && statsOverArray(parallel, values, half, threads);
+    double parallelSeconds = nowSeconds() - start;
+    ok = ok && statsOverArray(skewed, values + half, count - half, threads);
+    if (!ok)
+    {
+        printf("Error: Out of memory\n");
+        free(text);
+        free(parsed);
+        free(skewed);
+        free(parallel);
+        free(single);
+        free(values);
+        return 1;
+    }
+
+    printf("Values: %lld around 1e9 (accuracy), %lld skewed (percentiles)\n\n", half, count - half);
+    printf("%-24s %12s %12s %12s\n", "", "M values/s", "sum error", "var error");
+    printf("%-24s %12.1f %12.2e %12.2e\n", "naive loop", half / naiveSeconds / 1e6,
+           relativeError(sum, (double)refSum), relativeError(naiveVariance, refVariance));
+    printf("%-24s %12.1f %12.2e %12.2e\n", "stable + sketch, 1 thr", half / singleSeconds / 1e6,
+           relativeError(single->sum + single->sumError, (double)refSum),
+           relativeError(single->m2 / (half - 1), refVariance));
+    printf("stable + sketch, %-2d thr  %12.1f %12.2e %12.2e\n", threads, half / parallelSeconds / 1e6,
+           relativeError(parallel->sum + parallel->sumError, (double)refSum),
+           relativeError(parallel->m2 / (half - 1), refVariance));
+
+    // Percentiles of the skewed half: sketch against sorting
+    qsort(values + half, count - half, sizeof(double), compareDoubles);
+    printf("\n%-8s %14s %14s %10s\n", "quantile", "exact", "sketch", "rel error");
+    static const double quantiles[] = {0.5, 0.9, 0.99, 0.999};
+    for (int i = 0; i < 4; i++)
+    {
+        double exact = values[half + (long long)(quantiles[i] * (count - half - 1))];
+        double estimate = sketchQuantile(&skewed->sketch, skewed->count, quantiles[i]);
+        printf("p%-7g %14.6g %14.6g %10.2e\n", quantiles[i] * 100, exact, estimate, relativeError(estimate, exact));
+    }
+    printf("Sketch memory: %zu KB per thread, whatever the input size\n", sizeof(QuantileSketch) / 1024);
+
+    // Text parsing, the cost that dominates piped input
+    size_t len = 0;
+    long long lines = 0;
+    for (long long i = 0; len + 32 < textSize; i++, lines++)
+        len += sprintf(text + len, "%.10g\n", values[i % count]);
+    statsInit(parsed);
+    start = nowSeconds();
+    statsParseChunk(parsed, text, text + len);
+    double parseSeconds = nowSeconds() - start;
+    printf("\nText parsing: %.1f M values/s (%.0f MB/s) on one thread\n",
+           lines / parseSeconds / 1e6, len / parseSeconds / 1e6);
+
+    free(text);
+    free(parsed);
+    free(skewed);
+    free(single);
+    free(parallel);
+    free(values);
+    return 0;
+}
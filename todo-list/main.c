@@ -1,50 +1,373 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
-#define MAX_TASKS 100
 #define MAX_LEN 256
 #define FILENAME "tasks.txt"
+#define MAX_NAME 32
 
+// The task list is a persistent vector: an implicit treap (ordered by position,
+// balanced by random priorities) whose nodes are never modified once built.
+// A change copies only the O(log n) nodes on its path and shares the rest, so
+// every version of the list stays intact. Undo and redo just pick another
+// version's root, and a snapshot is a named root.
 typedef struct
 {
-    char description[MAX_LEN];
+    int left, right;        // Children (0 = none)
+    int size;               // Tasks in this subtree
+    unsigned int priority;  // Heap order of the treap
+    int id;                 // Stable task identity, used by diffs
+    int description;        // Offset of the text in the text pool
     int completed;
-} Task;
+} Node;
 
-Task tasks[MAX_TASKS];
-int task_count = 0;
+Node *nodes = NULL;         // Node 0 is the empty tree
+int node_count = 1;
+int node_capacity = 0;
 
-// Load tasks from file
-void load_tasks()
+char *text_pool = NULL;     // Task descriptions, each stored once
+long text_used = 0;
+long text_capacity = 0;
+
+int next_task_id = 1;
+
+typedef struct
 {
-    FILE *file = fopen(FILENAME, "r");
-    if (file == NULL)
+    int root;
+    char action[MAX_LEN + 32];  // What produced this version, for undo/redo messages
+} Version;
+
+Version *versions = NULL;
+int version_count = 0;
+int version_capacity = 0;
+int current_version = 0;
+
+typedef struct
+{
+    char name[MAX_NAME];
+    int root;
+} Snapshot;
+
+Snapshot *snapshots = NULL;
+int snapshot_count = 0;
+int snapshot_capacity = 0;
+
+// Grows a dynamic array so it can hold `needed` elements
+void reserve(void **array, int *capacity, int needed, size_t element_size)
+{
+    if (needed <= *capacity)
         return;
+    int new_capacity = *capacity ? *capacity : 16;
+    while (new_capacity < needed)
+        new_capacity *= 2;
+    void *grown = realloc(*array, (size_t)new_capacity * element_size);
+    if (grown == NULL)
+    {
+        printf("Out of memory!\n");
+        exit(1);
+    }
+    *array = grown;
+    *capacity = new_capacity;
+}
+
+// Stores a description in the text pool and returns its offset
+int store_text(const char *text)
+{
+    long len = (long)strlen(text) + 1;
+    if (text_used + len > text_capacity)
+    {
+        long new_capacity = text_capacity ? text_capacity : 4096;
+        while (new_capacity < text_used + len)
+            new_capacity *= 2;
+        text_pool = realloc(text_pool, new_capacity);
+        if (text_pool == NULL)
+        {
+            printf("Out of memory!\n");
+            exit(1);
+        }
+        text_capacity = new_capacity;
+    }
+    memcpy(text_pool + text_used, text, len);
+    text_used += len;
+    return (int)(text_used - len);
+}
+
+const char *task_text(int node)
+{
+    return text_pool + nodes[node].description;
+}
+
+// Treap priorities: a hash of the task id, so they are random but repeatable
+unsigned int priority_for(int id)
+{
+    unsigned int x = (unsigned int)id * 2654435761u;
+    x ^= x >> 16;
+    x *= 0x45d9f3bu;
+    x ^= x >> 16;
+    return x;
+}
+
+int new_node(int id, int description, int completed)
+{
+    reserve((void **)&nodes, &node_capacity, node_count + 1, sizeof(Node));
+    if (node_count == 1)
+        memset(&nodes[0], 0, sizeof(Node));
+    Node *n = &nodes[node_count];
+    n->left = n->right = 0;
+    n->size = 1;
+    n->priority = priority_for(id);
+    n->id = id;
+    n->description = description;
+    n->completed = completed;
+    return node_count++;
+}
+
+// Copies a node so the copy can be changed without touching older versions
+int copy_node(int node)
+{
+    reserve((void **)&nodes, &node_capacity, node_count + 1, sizeof(Node));
+    nodes[node_count] = nodes[node];
+    return node_count++;
+}
+
+int tree_size(int node)
+{
+    return nodes[node].size;
+}
+
+void update_size(int node)
+{
+    nodes[node].size = 1 + nodes[nodes[node].left].size + nodes[nodes[node].right].size;
+}
+
+// Joins two trees (all of a before all of b), copying the nodes it changes
+int merge(int a, int b)
+{
+    if (!a)
+        return b;
+    if (!b)
+        return a;
+    if (nodes[a].priority > nodes[b].priority)
+    {
+        int right = merge(nodes[a].right, b);
+        int copy = copy_node(a);
+        nodes[copy].right = right;
+        update_size(copy);
+        return copy;
+    }
+    int left = merge(a, nodes[b].left);
+    int copy = copy_node(b);
+    nodes[copy].left = left;
+    update_size(copy);
+    return copy;
+}
+
+// Splits a tree into its first k tasks and the rest, copying the nodes on the path
+void split(int tree, int k, int *first, int *rest)
+{
+    if (!tree)
+    {
+        *first = *rest = 0;
+        return;
+    }
+    int left_size = tree_size(nodes[tree].left);
+    int a, b;
+    if (k <= left_size)
+    {
+        split(nodes[tree].left, k, &a, &b);
+        int copy = copy_node(tree);
+        nodes[copy].left = b;
+        update_size(copy);
+        *first = a;
+        *rest = copy;
+    }
+    else
+    {
+        split(nodes[tree].right, k - left_size - 1, &a, &b);
+        int copy = copy_node(tree);
+        nodes[copy].right = a;
+        update_size(copy);
+        *first = copy;
+        *rest = b;
+    }
+}
 
-    while (fgets(tasks[task_count].description, MAX_LEN, file) != NULL)
+// Node holding the task at position index (0-based)
+int task_at(int tree, int index)
+{
+    while (tree)
     {
-        size_t len = strlen(tasks[task_count].description);
-        if (len > 0 && tasks[task_count].description[len - 1] == '\n')
+        int left_size = tree_size(nodes[tree].left);
+        if (index < left_size)
+            tree = nodes[tree].left;
+        else if (index == left_size)
+            return tree;
+        else
         {
-            tasks[task_count].description[len - 1] = '\0';
+            index -= left_size + 1;
+            tree = nodes[tree].right;
         }
+    }
+    return 0;
+}
+
+// New version with a task appended
+int vector_append(int tree, const char *description, int completed)
+{
+    int id = next_task_id++;
+    return merge(tree, new_node(id, store_text(description), completed));
+}
+
+// New version with the task at index marked as done (copies one path)
+int vector_mark_done(int tree, int index)
+{
+    int copy = copy_node(tree);
+    int left_size = tree_size(nodes[tree].left);
+    if (index < left_size)
+    {
+        int left = vector_mark_done(nodes[tree].left, index);
+        nodes[copy].left = left;
+    }
+    else if (index > left_size)
+    {
+        int right = vector_mark_done(nodes[tree].right, index - left_size - 1);
+        nodes[copy].right = right;
+    }
+    else
+        nodes[copy].completed = 1;
+    return copy;
+}
+
+// New version without the task at index: copies the path down to it and
+// puts the merge of its two subtrees in its place
+int vector_remove(int tree, int index)
+{
+    int left_size = tree_size(nodes[tree].left);
+    if (index == left_size)
+        return merge(nodes[tree].left, nodes[tree].right);
+
+    int copy = copy_node(tree);
+    if (index < left_size)
+    {
+        int left = vector_remove(nodes[tree].left, index);
+        nodes[copy].left = left;
+    }
+    else
+    {
+        int right = vector_remove(nodes[tree].right, index - left_size - 1);
+        nodes[copy].right = right;
+    }
+    nodes[copy].size--;
+    return copy;
+}
 
-        // Check for [x] at start to mark as done
-        if (strncmp(tasks[task_count].description, "[x] ", 4) == 0)
+// Builds a tree from tasks in order in O(n) (Cartesian tree construction)
+// instead of n separate appends, so loading copies nothing
+int build_tree(const int *new_nodes, int count)
+{
+    int *stack = malloc((count + 1) * sizeof(int));
+    int depth = 0;
+    for (int i = 0; i < count; i++)
+    {
+        int node = new_nodes[i], last = 0;
+        while (depth > 0 && nodes[stack[depth - 1]].priority < nodes[node].priority)
         {
-            tasks[task_count].completed = 1;
-            memmove(tasks[task_count].description, tasks[task_count].description + 4, strlen(tasks[task_count].description) - 3);
+            last = stack[--depth];
+            update_size(last);
         }
-        else
+        nodes[node].left = last;
+        if (depth > 0)
+            nodes[stack[depth - 1]].right = node;
+        stack[depth++] = node;
+    }
+    while (depth > 1)
+        update_size(stack[--depth]);
+    int root = count > 0 ? stack[0] : 0;
+    if (root)
+        update_size(root);
+    free(stack);
+    return root;
+}
+
+// Calls visit for every task in order
+void for_each_task(int tree, void (*visit)(int node, int position, void *context), void *context)
+{
+    int *stack = malloc((tree_size(tree) + 1) * sizeof(int));
+    int depth = 0, position = 0;
+    while (tree || depth > 0)
+    {
+        while (tree)
         {
-            tasks[task_count].completed = 0;
+            stack[depth++] = tree;
+            tree = nodes[tree].left;
         }
+        tree = stack[--depth];
+        visit(tree, position++, context);
+        tree = nodes[tree].right;
+    }
+    free(stack);
+}
+
+// Root of the version being shown
+int current_root()
+{
+    return versions[current_version].root;
+}
+
+// Records a new version; anything that could have been redone is dropped
+void commit_version(int root, const char *action)
+{
+    version_count = current_version + 1;
+    reserve((void **)&versions, &version_capacity, version_count + 1, sizeof(Version));
+    versions[version_count].root = root;
+    snprintf(versions[version_count].action, sizeof(versions[version_count].action), "%s", action);
+    current_version = version_count++;
+}
 
-        task_count++;
+// Load tasks from file
+void load_tasks()
+{
+    char line[MAX_LEN];
+    int *loaded = NULL, count = 0, capacity = 0;
+    FILE *file = fopen(FILENAME, "r");
+
+    if (file != NULL)
+    {
+        while (fgets(line, MAX_LEN, file) != NULL)
+        {
+            size_t len = strlen(line);
+            if (len > 0 && line[len - 1] == '\n')
+            {
+                line[len - 1] = '\0';
+            }
+
+            // Check for [x] at start to mark as done
+            int completed = strncmp(line, "[x] ", 4) == 0;
+            reserve((void **)&loaded, &capacity, count + 1, sizeof(int));
+            int id = next_task_id++;
+            loaded[count++] = new_node(id, store_text(completed ? line + 4 : line), completed);
+        }
+        fclose(file);
     }
 
-    fclose(file);
+    versions = NULL;
+    version_count = current_version = 0;
+    reserve((void **)&versions, &version_capacity, 1, sizeof(Version));
+    versions[0].root = build_tree(loaded, count);
+    strcpy(versions[0].action, "Loaded tasks");
+    version_count = 1;
+    free(loaded);
+}
+
+void write_task(int node, int position, void *context)
+{
+    (void)position;
+    FILE *file = context;
+    if (nodes[node].completed)
+        fprintf(file, "[x] %s\n", task_text(node));
+    else
+        fprintf(file, "%s\n", task_text(node));
 }
 
 // Save tasks to file
@@ -57,56 +380,49 @@ void save_tasks()
         return;
     }
 
-    for (int i = 0; i < task_count; i++)
-    {
-        if (tasks[i].completed)
-            fprintf(file, "[x] %s\n", tasks[i].description);
-        else
-            fprintf(file, "%s\n", tasks[i].description);
-    }
-
+    for_each_task(current_root(), write_task, file);
     fclose(file);
 }
 
+void print_task(int node, int position, void *context)
+{
+    (void)context;
+    printf("%d. [%c] %s\n", position + 1, nodes[node].completed ? 'x' : ' ', task_text(node));
+}
+
 // Display task list
 void list_tasks()
 {
-    if (task_count == 0)
+    if (tree_size(current_root()) == 0)
     {
         printf("\nNo tasks found.\n");
         return;
     }
 
     printf("\n--- TO-DO LIST ---\n");
-    for (int i = 0; i < task_count; i++)
-    {
-        printf("%d. [%c] %s\n", i + 1, tasks[i].completed ? 'x' : ' ', tasks[i].description);
-    }
+    for_each_task(current_root(), print_task, NULL);
 }
 
 // Add a task
 void add_task()
 {
-    if (task_count >= MAX_TASKS)
-    {
-        printf("Task list full!\n");
-        return;
-    }
+    char description[MAX_LEN];
+    char action[MAX_LEN + 32];
 
     printf("Enter new task: ");
     getchar(); // Consume leftover newline
-    fgets(tasks[task_count].description, MAX_LEN, stdin);
+    if (fgets(description, MAX_LEN, stdin) == NULL)
+        return;
 
     // Remove trailing newline
-    size_t len = strlen(tasks[task_count].description);
-    if (len > 0 && tasks[task_count].description[len - 1] == '\n')
+    size_t len = strlen(description);
+    if (len > 0 && description[len - 1] == '\n')
     {
-        tasks[task_count].description[len - 1] = '\0';
+        description[len - 1] = '\0';
     }
 
-    tasks[task_count].completed = 0;
-    task_count++;
-
+    snprintf(action, sizeof(action), "add \"%s\"", description);
+    commit_version(vector_append(current_root(), description, 0), action);
     printf("Task added!\n");
 }
 
@@ -114,17 +430,19 @@ void add_task()
 void mark_done()
 {
     int index;
+    char action[MAX_LEN + 32];
     list_tasks();
     printf("\nEnter task number to mark as done: ");
     scanf("%d", &index);
 
-    if (index < 1 || index > task_count)
+    if (index < 1 || index > tree_size(current_root()))
     {
         printf("Invalid task number!\n");
         return;
     }
 
-    tasks[index - 1].completed = 1;
+    snprintf(action, sizeof(action), "mark \"%s\" as done", task_text(task_at(current_root(), index - 1)));
+    commit_version(vector_mark_done(current_root(), index - 1), action);
     printf("Task marked as completed!\n");
 }
 
@@ -132,23 +450,259 @@ void mark_done()
 void remove_task()
 {
     int index;
+    char action[MAX_LEN + 32];
     list_tasks();
     printf("\nEnter task number to remove: ");
     scanf("%d", &index);
 
-    if (index < 1 || index > task_count)
+    if (index < 1 || index > tree_size(current_root()))
     {
         printf("Invalid task number!\n");
         return;
     }
 
-    for (int i = index - 1; i < task_count - 1; i++)
+    snprintf(action, sizeof(action), "remove \"%s\"", task_text(task_at(current_root(), index - 1)));
+    commit_version(vector_remove(current_root(), index - 1), action);
+    printf("Task removed.\n");
+}
+
+// Step back one version
+void undo()
+{
+    if (current_version == 0)
+    {
+        printf("Nothing to undo.\n");
+        return;
+    }
+    printf("Undone: %s\n", versions[current_version].action);
+    current_version--;
+}
+
+// Step forward again after an undo
+void redo()
+{
+    if (current_version + 1 >= version_count)
     {
-        tasks[i] = tasks[i + 1];
+        printf("Nothing to redo.\n");
+        return;
     }
+    current_version++;
+    printf("Redone: %s\n", versions[current_version].action);
+}
 
-    task_count--;
-    printf("Task removed.\n");
+// Reads a snapshot name from the user
+void read_name(char *name)
+{
+    printf("Snapshot name: ");
+    if (scanf("%31s", name) != 1)
+        name[0] = '\0';
+}
+
+Snapshot *find_snapshot(const char *name)
+{
+    for (int i = 0; i < snapshot_count; i++)
+    {
+        if (strcmp(snapshots[i].name, name) == 0)
+            return &snapshots[i];
+    }
+    return NULL;
+}
+
+// Names the current version (O(1): it shares every node)
+void save_snapshot()
+{
+    char name[MAX_NAME];
+    read_name(name);
+    if (name[0] == '\0')
+        return;
+
+    Snapshot *snapshot = find_snapshot(name);
+    if (snapshot == NULL)
+    {
+        reserve((void **)&snapshots, &snapshot_capacity, snapshot_count + 1, sizeof(Snapshot));
+        snapshot = &snapshots[snapshot_count++];
+        strcpy(snapshot->name, name);
+    }
+    snapshot->root = current_root();
+    printf("Snapshot \"%s\" saved (%d tasks).\n", name, tree_size(snapshot->root));
+}
+
+void list_snapshots()
+{
+    if (snapshot_count == 0)
+    {
+        printf("\nNo snapshots yet.\n");
+        return;
+    }
+    printf("\n--- SNAPSHOTS ---\n");
+    for (int i = 0; i < snapshot_count; i++)
+        printf("%s (%d tasks)\n", snapshots[i].name, tree_size(snapshots[i].root));
+}
+
+// Collects the nodes of a tree in order
+void collect_node(int node, int position, void *context)
+{
+    ((int *)context)[position] = node;
+}
+
+int *tree_nodes(int tree)
+{
+    int *list = malloc((tree_size(tree) + 1) * sizeof(int));
+    for_each_task(tree, collect_node, list);
+    return list;
+}
+
+// Prints what changed from one version to another. Tasks keep their id and
+// list order is id order (new tasks go to the end), so one merge pass suffices.
+int diff_versions(int from, int to, int print)
+{
+    int *a = tree_nodes(from), *b = tree_nodes(to);
+    int na = tree_size(from), nb = tree_size(to), i = 0, j = 0, changes = 0;
+    while (i < na || j < nb)
+    {
+        if (j == nb || (i < na && nodes[a[i]].id < nodes[b[j]].id))
+        {
+            if (print)
+                printf("- %s\n", task_text(a[i]));
+            i++;
+            changes++;
+        }
+        else if (i == na || nodes[b[j]].id < nodes[a[i]].id)
+        {
+            if (print)
+                printf("+ %s\n", task_text(b[j]));
+            j++;
+            changes++;
+        }
+        else
+        {
+            // Same task: identical nodes are unchanged without looking further
+            if (a[i] != b[j] && nodes[a[i]].completed != nodes[b[j]].completed)
+            {
+                if (print)
+                    printf("%c %s\n", nodes[b[j]].completed ? 'x' : ' ', task_text(b[j]));
+                changes++;
+            }
+            i++;
+            j++;
+        }
+    }
+    free(a);
+    free(b);
+    return changes;
+}
+
+// Shows how the current list differs from a snapshot
+void diff_snapshot()
+{
+    char name[MAX_NAME];
+    read_name(name);
+    Snapshot *snapshot = find_snapshot(name);
+    if (snapshot == NULL)
+    {
+        printf("No snapshot named \"%s\".\n", name);
+        return;
+    }
+    printf("\n--- CHANGES SINCE \"%s\" ---\n", name);
+    if (diff_versions(snapshot->root, current_root(), 1) == 0)
+        printf("No changes.\n");
+}
+
+// Makes a snapshot the current list again (as a new version, so it can be undone)
+void restore_snapshot()
+{
+    char name[MAX_NAME];
+    char action[MAX_NAME + 32];
+    read_name(name);
+    Snapshot *snapshot = find_snapshot(name);
+    if (snapshot == NULL)
+    {
+        printf("No snapshot named \"%s\".\n", name);
+        return;
+    }
+    snprintf(action, sizeof(action), "restore \"%s\"", name);
+    commit_version(snapshot->root, action);
+    printf("Snapshot \"%s\" restored.\n", name);
+}
+
+// Seconds since an earlier clock() reading
+double seconds_since(clock_t start)
+{
+    return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+// Random position in a list of `size` tasks (rand() alone may stop at 32767)
+int random_index(int size)
+{
+    return (int)(((unsigned long long)rand() * ((unsigned long long)RAND_MAX + 1) + rand()) % size);
+}
+
+// Mutation cost and memory per version on a list of `count` tasks
+int run_benchmark(int count)
+{
+    const int operations = 100000;
+    char description[64];
+    int *loaded = malloc(count * sizeof(int));
+
+    clock_t start = clock();
+    for (int i = 0; i < count; i++)
+    {
+        snprintf(description, sizeof(description), "Task number %d", i + 1);
+        loaded[i] = new_node(next_task_id++, store_text(description), 0);
+    }
+    reserve((void **)&versions, &version_capacity, 1, sizeof(Version));
+    versions[0].root = build_tree(loaded, count);
+    version_count = 1;
+    free(loaded);
+    printf("Built %d tasks in %.1f ms (%zu bytes per node)\n", count, seconds_since(start) * 1e3, sizeof(Node));
+    int base = current_root();
+
+    static const char *names[] = {"add_task", "mark_done", "remove_task"};
+    srand(42);
+    for (int kind = 0; kind < 3; kind++)
+    {
+        int nodes_before = node_count;
+        start = clock();
+        for (int i = 0; i < operations; i++)
+        {
+            int root = current_root(), size = tree_size(root);
+            if (kind == 0)
+                root = vector_append(root, "New task", 0);
+            else if (kind == 1)
+                root = vector_mark_done(root, random_index(size));
+            else
+                root = vector_remove(root, random_index(size));
+            commit_version(root, names[kind]);
+        }
+        double seconds = seconds_since(start);
+        double per_version = (double)(node_count - nodes_before) * sizeof(Node) / operations;
+        printf("%-12s %8.0f ns/op %8.1f bytes/version (%.1f nodes)\n", names[kind],
+               seconds * 1e9 / operations, per_version, per_version / sizeof(Node));
+    }
+
+    // Undo and redo only move between roots; the sizes are read so every step is real
+    long checksum = 0;
+    start = clock();
+    while (current_version > 0)
+    {
+        current_version--;
+        checksum += tree_size(current_root());
+    }
+    while (current_version + 1 < version_count)
+    {
+        current_version++;
+        checksum += tree_size(current_root());
+    }
+    printf("%-12s %8.1f ns/op (undo + redo through %d versions, checksum %ld)\n", "undo/redo",
+           seconds_since(start) * 1e9 / (2.0 * (version_count - 1)), version_count - 1, checksum);
+
+    start = clock();
+    int changes = diff_versions(base, current_root(), 0);
+    printf("%-12s %8.1f ms for %d changes between first and last version\n", "diff", seconds_since(start) * 1e3, changes);
+
+    printf("Total: %d versions in %.1f MB of nodes; a copy of the whole list per version would take %.1f MB each\n",
+           version_count, (double)node_count * sizeof(Node) / 1e6, (double)count * (MAX_LEN + sizeof(int)) / 1e6);
+    return 0;
 }
 
 // Show menu
@@ -160,20 +714,31 @@ void show_menu()
     printf("3. Mark Task as Done\n");
     printf("4. Remove Task\n");
     printf("5. Save & Exit\n");
+    printf("6. Undo\n");
+    printf("7. Redo\n");
+    printf("8. Save Snapshot\n");
+    printf("9. List Snapshots\n");
+    printf("10. Diff Against Snapshot\n");
+    printf("11. Restore Snapshot\n");
     printf("------------------------\n");
     printf("Enter your choice: ");
 }
 
-int main()
+int main(int argc, char *argv[])
 {
     int choice;
 
+    // --bench [tasks]: mutation cost and memory per version
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0)
+        return run_benchmark(argc > 2 ? atoi(argv[2]) : 1000000);
+
     load_tasks();
 
     while (1)
     {
         show_menu();
-        scanf("%d", &choice);
+        if (scanf("%d", &choice) != 1)
+            break;
 
         switch (choice)
         {
@@ -193,6 +758,24 @@ int main()
             save_tasks();
             printf("Tasks saved. Goodbye!\n");
             exit(0);
+        case 6:
+            undo();
+            break;
+        case 7:
+            redo();
+            break;
+        case 8:
+            save_snapshot();
+            break;
+        case 9:
+            list_snapshots();
+            break;
+        case 10:
+            diff_snapshot();
+            break;
+        case 11:
+            restore_snapshot();
+            break;
         default:
             printf("Invalid choice. Try again.\n");
         }